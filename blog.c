@@ -0,0 +1,181 @@
+/**
+ * @brief Deferred binary logging, see blog.h.
+ *
+ * A record on the wire is
+ *
+ *   0xFE, length, entry offset (16 bit little endian), delta, arguments
+ *
+ * where length counts the bytes after itself, delta is the tick count since
+ * the previous record and delta and arguments are LEB128 varints, so small
+ * values take one byte. The first record after boot carries the tick count
+ * itself. 0xFE never occurs in UTF-8 text and a record that does not match
+ * its entry is read as text, so the decoder finds its way back after text
+ * or a lost byte. Records that do not fit in the ring are counted, the next
+ * record that fits is preceded by one with offset BLOG_ID_DROPPED and the
+ * count as its argument.
+ *
+ * Producers are serialised with interrupts masked while a record is copied
+ * into the ring, the arguments are encoded before that.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "blog.h"
+
+#if ESWGPIO_LOG_BINARY
+
+#include "cmsis_os2.h"
+#include "em_core.h"
+
+#define BLOG_MASK       (BLOG_SIZE - 1)
+#define BLOG_MARK       0xFE
+#define BLOG_ID_DROPPED 0xFFFF
+#define BLOG_ARGS_MAX   (5 * BLOG_MAX_ARGS)     // Encoded arguments, bytes
+#define BLOG_RECORD_MAX (4 + 5 + BLOG_ARGS_MAX) // Whole record, bytes
+#define BLOG_DROP_MAX   (4 + 1 + 5)             // Dropped record, bytes
+
+// Linker generated start of the entries
+extern const char __start_blog_fmt[];
+
+static uint8_t m_ring[BLOG_SIZE];
+static volatile uint32_t m_head;
+static volatile uint32_t m_tail;
+static volatile uint32_t m_dropped;
+static uint32_t m_gap;        // Dropped since the last dropped record
+static uint32_t m_last_ticks; // Tick count of the last record
+static uint16_t m_flags;
+
+void blog_init(uint16_t flags)
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    m_head = 0;
+    m_tail = 0;
+    m_dropped = 0;
+    m_gap = 0;
+    m_last_ticks = 0;
+    m_flags = flags;
+    CORE_EXIT_ATOMIC();
+}
+
+static uint32_t blog_varint(uint8_t *out, uint32_t value)
+{
+    uint32_t len = 0;
+
+    while (value >= 0x80)
+    {
+        out[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[len++] = (uint8_t)value;
+    return len;
+}
+
+static uint32_t blog_put(uint32_t head, const uint8_t *bytes, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        m_ring[head++ & BLOG_MASK] = bytes[i];
+    }
+    return head;
+}
+
+// Header and delta of a record with len argument bytes.
+static uint32_t blog_header(uint8_t *out, uint16_t id, uint32_t delta, uint32_t len)
+{
+    uint32_t n = 4;
+
+    n += blog_varint(&out[4], delta);
+    out[0] = BLOG_MARK;
+    out[1] = (uint8_t)(n - 2 + len);
+    out[2] = (uint8_t)id;
+    out[3] = (uint8_t)(id >> 8);
+    return n;
+}
+
+void blog_write(uint16_t level, const char *entry, uint32_t count, const uint32_t *args)
+{
+    uint8_t encoded[BLOG_ARGS_MAX];
+    uint8_t header[9];
+    uint32_t len = 0;
+    uint16_t id = (uint16_t)(entry - __start_blog_fmt);
+
+    if (0 == (m_flags & level))
+    {
+        return;
+    }
+    for (uint32_t i = 0; (i < count) && (i < BLOG_MAX_ARGS); i++)
+    {
+        len += blog_varint(&encoded[len], args[i]);
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+
+    uint32_t head = m_head;
+    uint32_t ticks = osKernelGetTickCount();
+    uint32_t needed = BLOG_RECORD_MAX + ((0 != m_gap) ? BLOG_DROP_MAX : 0);
+
+    if (BLOG_SIZE - (head - m_tail) < needed)
+    {
+        m_dropped++;
+        m_gap++;
+    }
+    else
+    {
+        if (0 != m_gap)
+        {
+            uint8_t gap[5];
+            uint32_t gap_len = blog_varint(gap, m_gap);
+
+            head = blog_put(head, header, blog_header(header, BLOG_ID_DROPPED, 0, gap_len));
+            head = blog_put(head, gap, gap_len);
+            m_gap = 0;
+        }
+        head = blog_put(head, header, blog_header(header, id, ticks - m_last_ticks, len));
+        head = blog_put(head, encoded, len);
+        m_last_ticks = ticks;
+
+        // The record must be complete before the drain can see the new head
+        __DMB();
+        m_head = head;
+    }
+
+    CORE_EXIT_ATOMIC();
+}
+
+uint32_t blog_drain(blog_output_f output)
+{
+    uint32_t tail = m_tail;
+    uint32_t count = m_head - tail;
+    uint32_t first = BLOG_SIZE - (tail & BLOG_MASK);
+
+    if (0 == count)
+    {
+        return 0;
+    }
+
+    // Bytes up to head are complete once head has been read
+    __DMB();
+    if (count <= first)
+    {
+        output((const char *)&m_ring[tail & BLOG_MASK], count);
+    }
+    else
+    {
+        output((const char *)&m_ring[tail & BLOG_MASK], first);
+        output((const char *)m_ring, count - first);
+    }
+
+    // Space is only handed back after it has been written out
+    __DMB();
+    m_tail = tail + count;
+    return count;
+}
+
+uint32_t blog_dropped(void)
+{
+    return m_dropped;
+}
+
+#endif//ESWGPIO_LOG_BINARY
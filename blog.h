@@ -0,0 +1,76 @@
+/**
+ * @brief Deferred binary logging, lll calls reduced to a message ID and the
+ * raw argument values.
+ *
+ * With LOG_BINARY=1 this header replaces debug1, info1, warn1 and err1 in
+ * every file that includes it after log.h. Each call site puts its level,
+ * module, line and format string into the blog_fmt section of the ELF and
+ * at run time writes only the offset of that entry, the ticks since the
+ * previous record and the arguments into a byte ring, no formatting. A low
+ * priority thread drains the ring to the serial port with blog_drain and
+ * tools/blogdec.py turns the stream back into lll lines with the entries
+ * read from the same ELF. Text written by others in between, like the pin
+ * recorder VCD, passes through the decoder unchanged.
+ *
+ * Arguments are converted to uint32_t, at most BLOG_MAX_ARGS of them. %s
+ * and floating point conversions are not supported, a call that needs them
+ * belongs in a file that keeps the text macros.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef BLOG_H_
+#define BLOG_H_
+
+#include <stdint.h>
+
+#define BLOG_SIZE     1024 // Ring bytes, power of two
+#define BLOG_MAX_ARGS 6
+
+typedef int (*blog_output_f)(const char *ptr, int len);
+
+#if ESWGPIO_LOG_BINARY
+
+// Record the levels in flags, like the mask of log_init. Before the first call.
+void blog_init(uint16_t flags);
+
+// Queue one record, entry is the blog_fmt entry of the call site. Safe in interrupt context.
+void blog_write(uint16_t level, const char *entry, uint32_t count, const uint32_t *args);
+
+// Pass the queued bytes to output, returns the number of bytes. Single consumer.
+uint32_t blog_drain(blog_output_f output);
+
+// Records lost because the ring was full.
+uint32_t blog_dropped(void);
+
+#define BLOG_STR_(x) #x
+#define BLOG_STR(x)  BLOG_STR_(x)
+
+// Number of arguments after the format, 0 to BLOG_MAX_ARGS
+#define BLOG_NARGS(fmt, ...) BLOG_NARGS_(fmt, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define BLOG_NARGS_(fmt, a1, a2, a3, a4, a5, a6, n, ...) n
+
+#define __BLOG_LINE(lvl, letter, fmt, ...) do { if ((__LOG_LEVEL__) & (lvl)) { \
+    static const char blog_entry[] __attribute__((section("blog_fmt"), used)) = \
+        letter "|" __MODUUL__ "|" BLOG_STR(__LINE__) "|" fmt; \
+    const uint32_t blog_args[] = {0, ##__VA_ARGS__}; \
+    blog_write(lvl, blog_entry, BLOG_NARGS(fmt, ##__VA_ARGS__), &blog_args[1]); } } while (0)
+
+#undef debug1
+#undef info1
+#undef warn1
+#undef err1
+
+#define debug1(fmt, ...) __BLOG_LINE(LOG_DEBUG1, "D", fmt, ##__VA_ARGS__)
+#define info1(fmt, ...)  __BLOG_LINE(LOG_INFO1, "I", fmt, ##__VA_ARGS__)
+#define warn1(fmt, ...)  __BLOG_LINE(LOG_WARN1, "W", fmt, ##__VA_ARGS__)
+#define err1(fmt, ...)   __BLOG_LINE(LOG_ERR1, "E", fmt, ##__VA_ARGS__)
+
+#else
+
+static inline void blog_init(uint16_t flags) {}
+static inline uint32_t blog_drain(blog_output_f output) { return 0; }
+
+#endif//ESWGPIO_LOG_BINARY
+
+#endif//BLOG_H_
@@ -0,0 +1,18 @@
+/**
+ * @brief Button timings of the application, shared by main.c and the host
+ * tools that check it against the debouncer and the gesture recognizer.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef BUTTON_TIMING_H_
+#define BUTTON_TIMING_H_
+
+#define ESWGPIO_DEBOUNCE_MS 20 // Button contact bounce lockout, ms
+
+#define ESWGPIO_CLICK_GAP_MS 300   // Longest release between clicks of a multi-click, ms
+#define ESWGPIO_LONG_PRESS_MS 800  // Hold time of a long press, ms
+#define ESWGPIO_HOLD_REPEAT_MS 500 // Repeat interval while held after a long press, ms
+#define ESWGPIO_MAX_CLICKS 3       // Triple click is reported without waiting for the gap
+
+#endif//BUTTON_TIMING_H_
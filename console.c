@@ -0,0 +1,137 @@
+/**
+ * @brief Line based command console on the serial port, see console.h.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "console.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "retargetserial.h"
+
+#define CONSOLE_REPLY_MAX 128
+
+typedef struct console_entry
+{
+    const char *name;
+    const char *help;
+    console_command_f command;
+} console_entry_t;
+
+static console_entry_t m_commands[CONSOLE_COMMANDS];
+static uint8_t m_count;
+static console_output_f m_output;
+
+static char m_line[CONSOLE_LINE_MAX];
+static uint32_t m_len;
+static bool m_overflow; // Input line too long, skipped up to its end
+
+static void console_help(int argc, char **argv)
+{
+    for (uint8_t i = 0; i < m_count; i++)
+    {
+        console_printf("%-8s %s", m_commands[i].name, m_commands[i].help);
+    }
+}
+
+void console_init(console_output_f output)
+{
+    m_output = output;
+    m_count = 0;
+    m_len = 0;
+    m_overflow = false;
+    console_register("help", console_help, "list the commands");
+}
+
+bool console_register(const char *name, console_command_f command, const char *help)
+{
+    if ((m_count >= CONSOLE_COMMANDS) || (NULL == command))
+    {
+        return false;
+    }
+    m_commands[m_count].name = name;
+    m_commands[m_count].help = help;
+    m_commands[m_count].command = command;
+    m_count++;
+    return true;
+}
+
+void console_printf(const char *fmt, ...)
+{
+    char line[CONSOLE_REPLY_MAX];
+    va_list args;
+    int len;
+
+    va_start(args, fmt);
+    len = vsnprintf(line, sizeof(line) - 1, fmt, args);
+    va_end(args);
+
+    if (len > (int)sizeof(line) - 2)
+    {
+        len = sizeof(line) - 2;
+    }
+    line[len++] = '\n';
+    m_output(line, len);
+}
+
+static void console_execute(char *line)
+{
+    char *argv[CONSOLE_ARGS_MAX];
+    int argc = 0;
+
+    for (char *word = strtok(line, " \t"); (NULL != word) && (argc < CONSOLE_ARGS_MAX); word = strtok(NULL, " \t"))
+    {
+        argv[argc++] = word;
+    }
+    if (0 == argc)
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < m_count; i++)
+    {
+        if (0 == strcmp(argv[0], m_commands[i].name))
+        {
+            m_commands[i].command(argc, argv);
+            return;
+        }
+    }
+    console_printf("%s: unknown command, try help", argv[0]);
+}
+
+bool console_poll(void)
+{
+    bool input = false;
+    int c;
+
+    while ((c = RETARGET_ReadChar()) >= 0)
+    {
+        input = true;
+        if (('\r' == c) || ('\n' == c))
+        {
+            m_line[m_len] = '\0';
+            if (m_overflow)
+            {
+                console_printf("line too long, at most %u characters", CONSOLE_LINE_MAX - 1);
+            }
+            else
+            {
+                console_execute(m_line);
+            }
+            m_len = 0;
+            m_overflow = false;
+        }
+        else if (m_len < CONSOLE_LINE_MAX - 1)
+        {
+            m_line[m_len++] = (char)c;
+        }
+        else
+        {
+            m_overflow = true;
+        }
+    }
+    return input;
+}
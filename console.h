@@ -0,0 +1,38 @@
+/**
+ * @brief Line based command console on the serial port.
+ *
+ * Characters are read with RETARGET_ReadChar by console_poll, a complete
+ * line is split at spaces and the first word selects the command. Modules
+ * add their commands with console_register, "help" lists them. Replies go
+ * to the output function given to console_init, the same one the logs use.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef CONSOLE_H_
+#define CONSOLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CONSOLE_COMMANDS 8  // Registered commands
+#define CONSOLE_LINE_MAX 64 // Longest input line
+#define CONSOLE_ARGS_MAX 6  // Words per line, the command included
+
+typedef int (*console_output_f)(const char *ptr, int len);
+
+// Called in the console thread, argv[0] is the command.
+typedef void (*console_command_f)(int argc, char **argv);
+
+void console_init(console_output_f output);
+
+// Add command name, false if the table is full. name and help must stay valid.
+bool console_register(const char *name, console_command_f command, const char *help);
+
+// Read what has arrived and run the complete lines, true if anything arrived.
+bool console_poll(void);
+
+// Formatted reply line, a newline is added.
+void console_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#endif//CONSOLE_H_
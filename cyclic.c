@@ -0,0 +1,137 @@
+/**
+ * @brief Table-driven cyclic executive, see cyclic.h.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "cyclic.h"
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+    while (0 != b)
+    {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Arm the timer for the release due at c->due, at once when that has passed.
+static bool cyclic_arm(cyclic_t *c)
+{
+    int32_t ticks = (int32_t)(c->due - osKernelGetTickCount());
+
+    return osOK == osTimerStart(c->timer, (ticks > 0) ? (uint32_t)ticks : 1);
+}
+
+static void cyclic_timer_cb(void *argument)
+{
+    cyclic_t *c = (cyclic_t *)argument;
+    const cyclic_release_t *r = &c->releases[c->release];
+    uint32_t frames;
+
+    // The last release ends the hyperperiod, the first one comes next
+    if (++c->release >= c->release_count)
+    {
+        c->release = 0;
+        frames = c->frame_count - r->offset + c->releases[0].offset;
+    }
+    else
+    {
+        frames = c->releases[c->release].offset - r->offset;
+    }
+    c->due += frames * c->minor_ticks;
+    cyclic_arm(c);
+
+    c->action(r->mask, c->user);
+}
+
+int cyclic_build(cyclic_t *c, const uint32_t periods[], uint8_t count,
+                 cyclic_action_f action, void *user)
+{
+    uint64_t next[CYCLIC_MAX_TASKS];
+    uint32_t minor = 0;
+    uint64_t hyper = 1;
+    uint16_t n = 0;
+
+    if ((0 == count) || (count > CYCLIC_MAX_TASKS) || (NULL == action))
+    {
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (0 == periods[i])
+        {
+            return -1;
+        }
+        minor = gcd(minor, periods[i]);
+        hyper = hyper / gcd((uint32_t)(hyper % periods[i]), periods[i]) * periods[i];
+        if (hyper > UINT32_MAX)
+        {
+            return -1;
+        }
+        next[i] = periods[i];
+    }
+
+    // Merge the release times of all tasks up to the hyperperiod, where all of them meet
+    for (uint64_t t = 0; t < hyper; n++)
+    {
+        uint8_t mask = 0;
+
+        if (n == CYCLIC_MAX_RELEASES)
+        {
+            return -1;
+        }
+
+        t = hyper;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            t = (next[i] < t) ? next[i] : t;
+        }
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (next[i] == t)
+            {
+                mask |= (uint8_t)(1U << i);
+                next[i] += periods[i];
+            }
+        }
+
+        // Frame f ends at (f + 1) * minor ticks
+        c->releases[n] = (cyclic_release_t){.offset = (uint32_t)(t / minor - 1), .mask = mask};
+    }
+
+    c->release_count = n;
+    c->release = 0;
+    c->minor_ticks = minor;
+    c->hyperperiod = (uint32_t)hyper;
+    c->frame_count = (uint32_t)(hyper / minor);
+    c->action = action;
+    c->user = user;
+
+    if (NULL == c->timer)
+    {
+        const osTimerAttr_t attr = {.name = "cyclic", .cb_mem = &c->timer_cb, .cb_size = sizeof(c->timer_cb)};
+        c->timer = osTimerNew(cyclic_timer_cb, osTimerOnce, c, &attr);
+        if (NULL == c->timer)
+        {
+            return -1;
+        }
+    }
+    return c->release_count;
+}
+
+bool cyclic_start(cyclic_t *c)
+{
+    osTimerStop(c->timer);
+    c->release = 0;
+    c->due = osKernelGetTickCount() + (c->releases[0].offset + 1) * c->minor_ticks;
+    return cyclic_arm(c);
+}
+
+void cyclic_stop(cyclic_t *c)
+{
+    osTimerStop(c->timer);
+}
@@ -0,0 +1,74 @@
+/**
+ * @brief Table-driven cyclic executive for periodic pin actions.
+ *
+ * A set of task periods (in kernel ticks) is merged into one schedule
+ * covering the hyperperiod (LCM of all periods). The schedule is split
+ * into minor frames of GCD ticks. Only the frames that release tasks are
+ * stored, as the frame offset in the hyperperiod and the bitmask of the
+ * tasks released at the end of it. A single one-shot osTimer is armed for
+ * the next release only, empty frames cost no wake-up, so any number of
+ * periodic tasks cost one timer and no thread stacks. Each release is
+ * timed from the tick the previous one was due, so a late timer service
+ * does not shift the pattern, which repeats exactly every hyperperiod.
+ *
+ * The table limits the releases in one hyperperiod, not its length: 70
+ * and 40 ticks have 28 frames and 10 releases, 30, 40 and 70 ticks have
+ * 84 frames and 48 releases. 997 and 1000 ticks have 1996 releases, more
+ * than the table holds, and a period set that does not fit fails to build.
+ * Every release takes 8 bytes, a build that needs more of them can raise
+ * CYCLIC_MAX_RELEASES.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef CYCLIC_H_
+#define CYCLIC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cmsis_os2.h"
+#include "FreeRTOS.h"
+
+#define CYCLIC_MAX_TASKS 8 // One bit per task in a frame mask
+
+#ifndef CYCLIC_MAX_RELEASES
+#define CYCLIC_MAX_RELEASES 64 // Frames with work in one hyperperiod
+#endif
+
+// Called from the timer service for every frame with a non-zero mask.
+typedef void (*cyclic_action_f)(uint32_t mask, void *user);
+
+typedef struct cyclic_release
+{
+    uint32_t offset; // Minor frame in the hyperperiod
+    uint8_t mask;    // Tasks released at its end
+} cyclic_release_t;
+
+typedef struct cyclic
+{
+    cyclic_release_t releases[CYCLIC_MAX_RELEASES];
+    uint16_t release_count;
+    uint16_t release;     // Next one due
+    uint32_t frame_count; // Minor frames in the hyperperiod
+    uint32_t due;         // Kernel tick of the next release
+    uint32_t minor_ticks;
+    uint32_t hyperperiod;
+    cyclic_action_f action;
+    void *user;
+    osTimerId_t timer;
+    StaticTimer_t timer_cb; // Control block of timer, no heap
+} cyclic_t;
+
+// Build the schedule for count periods, returns the number of releases or -1.
+// The structure must be zeroed before the first build, static storage is fine.
+int cyclic_build(cyclic_t *c, const uint32_t periods[], uint8_t count,
+                 cyclic_action_f action, void *user);
+
+// Start from frame 0 now, the first release happens at the end of its frame.
+bool cyclic_start(cyclic_t *c);
+
+// Stop the timer, pending releases are discarded.
+void cyclic_stop(cyclic_t *c);
+
+#endif//CYCLIC_H_
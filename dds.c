@@ -0,0 +1,255 @@
+/**
+ * @brief Fixed-point direct digital synthesis, see dds.h.
+ *
+ * The exponential sweep factor is the samples-th root of to/from. It is
+ * computed once in dds_sweep with libm in thread context, the per-sample
+ * render path only does integer adds and 32x32 multiplies. A linear sweep
+ * adds the rounded down slope every sample and the remainder Bresenham
+ * style, so neither shape drifts off the end frequency on long sweeps.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "dds.h"
+
+#include <string.h>
+#include <math.h>
+
+#include "em_core.h"
+
+#include "playback.h"
+
+#define DDS_Q30 (1UL << 30)
+
+void dds_init(dds_t *d, uint32_t sample_rate)
+{
+    memset(d, 0, sizeof(dds_t));
+    d->sample_rate = sample_rate;
+}
+
+uint32_t dds_increment(const dds_t *d, uint32_t freq_mhz)
+{
+    return (uint32_t)(((uint64_t)freq_mhz << 32) / ((uint64_t)d->sample_rate * 1000));
+}
+
+// Per-sample factor so that start * ratio ^ samples == end, Q2.30.
+static uint32_t dds_ratio(uint32_t start, uint32_t end, uint32_t samples)
+{
+    double ratio = pow((double)end / (double)start, 1.0 / (double)samples);
+
+    return (uint32_t)(ratio * DDS_Q30 + 0.5);
+}
+
+// Below half the sample rate, anything from there on aliases to a lower tone.
+static bool dds_below_nyquist(const dds_t *d, uint32_t freq_mhz)
+{
+    return 2 * (uint64_t)freq_mhz < (uint64_t)d->sample_rate * 1000;
+}
+
+// The increments low to high swung depth either way by the vibrato stay above 0 and below
+// Nyquist, 2^31, which is where dds_below_nyquist puts a frequency too.
+static bool dds_swing_fits(uint32_t low, uint32_t high, uint32_t depth)
+{
+    return (0 == depth) || ((low > depth) && ((uint64_t)high + depth < (1UL << 31)));
+}
+
+bool dds_set_frequency(dds_t *d, uint8_t voice, uint32_t freq_mhz)
+{
+    if ((voice >= DDS_MAX_VOICES) || !dds_below_nyquist(d, freq_mhz))
+    {
+        return false;
+    }
+
+    uint32_t inc = dds_increment(d, freq_mhz);
+    dds_voice_t *v = &d->voices[voice];
+
+    // The depth is only written in thread context, no need to hold off the refill for it
+    if (!dds_swing_fits(inc, inc, v->lfo_depth))
+    {
+        return false;
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    v->inc = inc;
+    v->sweep = DDS_SWEEP_NONE;
+    v->active = true;
+    CORE_EXIT_ATOMIC();
+    return true;
+}
+
+bool dds_sweep(dds_t *d, uint8_t voice, uint32_t from_mhz, uint32_t to_mhz,
+               uint32_t samples, dds_sweep_t shape, bool repeat)
+{
+    if ((voice >= DDS_MAX_VOICES) || (0 == samples) || (0 == from_mhz) || (0 == to_mhz)
+        || !dds_below_nyquist(d, from_mhz) || !dds_below_nyquist(d, to_mhz))
+    {
+        return false;
+    }
+
+    uint32_t start = dds_increment(d, from_mhz);
+    uint32_t end = dds_increment(d, to_mhz);
+    int32_t slope = 0;
+    uint32_t slope_rem = 0;
+    uint32_t ratio = DDS_Q30;
+
+    if (DDS_SWEEP_LINEAR == shape)
+    {
+        // Rounded down, the remainder is spread over the sweep so it ends where it should
+        int64_t diff = (int64_t)end - (int64_t)start;
+        int64_t floor = diff / (int64_t)samples - ((diff % (int64_t)samples < 0) ? 1 : 0);
+
+        slope = (int32_t)floor;
+        slope_rem = (uint32_t)(diff - floor * (int64_t)samples);
+    }
+    else if (DDS_SWEEP_EXPONENTIAL == shape)
+    {
+        ratio = dds_ratio(start, end, samples);
+    }
+    else
+    {
+        return false;
+    }
+
+    dds_voice_t *v = &d->voices[voice];
+
+    if (!dds_swing_fits((start < end) ? start : end, (start < end) ? end : start, v->lfo_depth))
+    {
+        return false;
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    v->inc = start;
+    v->inc_start = start;
+    v->inc_end = end;
+    v->slope = slope;
+    v->slope_rem = slope_rem;
+    v->slope_err = 0;
+    v->ratio = ratio;
+    v->length = samples;
+    v->remaining = samples;
+    v->repeat = repeat;
+    v->sweep = shape;
+    v->active = true;
+    CORE_EXIT_ATOMIC();
+    return true;
+}
+
+bool dds_vibrato(dds_t *d, uint8_t voice, uint32_t rate_mhz, uint32_t depth_mhz)
+{
+    if ((voice >= DDS_MAX_VOICES) || ((0 != rate_mhz) && !dds_below_nyquist(d, depth_mhz)))
+    {
+        return false;
+    }
+
+    uint32_t lfo_inc = dds_increment(d, rate_mhz);
+    uint32_t depth = (0 == rate_mhz) ? 0 : dds_increment(d, depth_mhz);
+    dds_voice_t *v = &d->voices[voice];
+    bool fits;
+
+    // A sweep moves inc between its ends in the refill, the ends stay put
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    if (!v->active)
+    {
+        fits = true; // Checked against the carrier when one is set
+    }
+    else if (DDS_SWEEP_NONE != v->sweep)
+    {
+        fits = dds_swing_fits((v->inc_start < v->inc_end) ? v->inc_start : v->inc_end,
+                              (v->inc_start < v->inc_end) ? v->inc_end : v->inc_start, depth);
+    }
+    else
+    {
+        fits = dds_swing_fits(v->inc, v->inc, depth);
+    }
+    if (fits)
+    {
+        v->lfo_inc = lfo_inc;
+        v->lfo_depth = depth;
+    }
+    CORE_EXIT_ATOMIC();
+    return fits;
+}
+
+void dds_stop_voice(dds_t *d, uint8_t voice)
+{
+    if (voice < DDS_MAX_VOICES)
+    {
+        CORE_DECLARE_IRQ_STATE;
+        CORE_ENTER_ATOMIC();
+        memset(&d->voices[voice], 0, sizeof(dds_voice_t));
+        CORE_EXIT_ATOMIC();
+    }
+}
+
+// Advance the voice one sample and return its output level.
+static inline uint32_t dds_voice_step(dds_voice_t *v)
+{
+    uint32_t inc = v->inc;
+
+    if (0 != v->lfo_depth)
+    {
+        uint32_t p = v->lfo_phase;
+        // Fold the LFO phase into a triangle in -2^30 .. 2^30
+        uint32_t fold = (p & 0x80000000UL) ? ~p : p;
+        int32_t tri = (int32_t)fold - (int32_t)DDS_Q30;
+
+        inc += (uint32_t)(((int64_t)v->lfo_depth * tri) >> 30);
+        v->lfo_phase = p + v->lfo_inc;
+    }
+
+    v->phase += inc;
+
+    if (DDS_SWEEP_NONE != v->sweep)
+    {
+        if (0 == --v->remaining)
+        {
+            if (v->repeat)
+            {
+                v->inc = v->inc_start;
+                v->remaining = v->length;
+            }
+            else
+            {
+                v->inc = v->inc_end;
+                v->sweep = DDS_SWEEP_NONE;
+            }
+        }
+        else if (DDS_SWEEP_LINEAR == v->sweep)
+        {
+            v->inc += (uint32_t)v->slope;
+            v->slope_err += v->slope_rem;
+            if (v->slope_err >= v->length)
+            {
+                v->slope_err -= v->length;
+                v->inc++;
+            }
+        }
+        else
+        {
+            // Rounded, truncating would pull every step down and the sweep short of its end
+            v->inc = (uint32_t)(((uint64_t)v->inc * v->ratio + (DDS_Q30 >> 1)) >> 30);
+        }
+    }
+    return v->phase >> 31;
+}
+
+void dds_render_toggles(dds_t *d, uint32_t *buf, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        uint8_t level = 0;
+
+        for (uint8_t n = 0; n < DDS_MAX_VOICES; n++)
+        {
+            if (d->voices[n].active)
+            {
+                level ^= dds_voice_step(&d->voices[n]);
+            }
+        }
+        buf[i] = (level != d->out) ? PLAYBACK_TOGGLE : 0;
+        d->out = level;
+    }
+}
@@ -0,0 +1,83 @@
+/**
+ * @brief Fixed-point direct digital synthesis for the buzzer output stream.
+ *
+ * Every voice has a 32-bit phase accumulator that advances by its phase
+ * increment each sample, the voice output is the accumulator MSB. The
+ * increment can follow a linear or exponential sweep and be modulated by
+ * a triangle LFO for vibrato. Voices are mixed with XOR and rendered as
+ * PA0 toggle words for a playback.h refill.
+ *
+ * Rendering is integer-only and meant for interrupt context. Parameter
+ * changes from threads are applied between two samples and never touch
+ * the phase, so frequency changes are continuous and glitch-free.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef DDS_H_
+#define DDS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DDS_MAX_VOICES 4
+
+typedef enum dds_sweep
+{
+    DDS_SWEEP_NONE,
+    DDS_SWEEP_LINEAR,     // Constant Hz per sample
+    DDS_SWEEP_EXPONENTIAL // Constant ratio per sample, constant octaves per second
+} dds_sweep_t;
+
+typedef struct dds_voice
+{
+    uint32_t phase;
+    uint32_t inc;        // Current phase increment, without vibrato
+    uint32_t inc_start;  // Sweep start, restored when repeating
+    uint32_t inc_end;    // Sweep end
+    int32_t slope;       // Linear sweep, added per sample
+    uint32_t slope_rem;  // and the remainder of length, one more whenever it adds up
+    uint32_t slope_err;
+    uint32_t ratio;      // Exponential sweep, Q2.30 factor per sample
+    uint32_t length;     // Sweep length in samples
+    uint32_t remaining;  // Samples left in the current sweep
+    uint32_t lfo_phase;
+    uint32_t lfo_inc;
+    uint32_t lfo_depth;  // Peak increment deviation
+    uint8_t sweep;
+    bool repeat;
+    bool active;
+} dds_voice_t;
+
+typedef struct dds
+{
+    dds_voice_t voices[DDS_MAX_VOICES];
+    uint32_t sample_rate;
+    uint8_t out; // XOR level last rendered to the pin
+} dds_t;
+
+void dds_init(dds_t *d, uint32_t sample_rate);
+
+// Phase increment for freq_mhz (milli-Hz) at the configured sample rate.
+uint32_t dds_increment(const dds_t *d, uint32_t freq_mhz);
+
+// Play a constant frequency, cancels any sweep but keeps vibrato and phase.
+// False from half the sample rate up, like a sweep that reaches it, and
+// when the vibrato of the voice would swing it to 0 or half the sample rate.
+bool dds_set_frequency(dds_t *d, uint8_t voice, uint32_t freq_mhz);
+
+// Sweep from_mhz to to_mhz in samples, optionally restarting at the end.
+bool dds_sweep(dds_t *d, uint8_t voice, uint32_t from_mhz, uint32_t to_mhz,
+               uint32_t samples, dds_sweep_t shape, bool repeat);
+
+// Triangle vibrato at rate_mhz with a peak deviation of depth_mhz, 0 disables.
+// False when the carrier, or any frequency of a sweep, minus depth_mhz is not
+// above 0 or plus depth_mhz not below half the sample rate, keeping the old one.
+bool dds_vibrato(dds_t *d, uint8_t voice, uint32_t rate_mhz, uint32_t depth_mhz);
+
+void dds_stop_voice(dds_t *d, uint8_t voice);
+
+// Render len samples as PA0 toggle words, for use in a playback refill.
+void dds_render_toggles(dds_t *d, uint32_t *buf, uint32_t len);
+
+#endif//DDS_H_
@@ -0,0 +1,57 @@
+/**
+ * @brief Timestamp-based contact debouncing, see debounce.h.
+ *
+ * Timestamps are free-running and compared by unsigned difference, so a
+ * counter wrap between two edges is harmless as long as the edges are less
+ * than half the counter range apart.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "debounce.h"
+
+void debounce_init(debounce_t *d, uint32_t window, uint8_t level, uint32_t now)
+{
+    d->window = window;
+    d->last_change = now - window; // The first edge is not locked out
+    d->level = level;
+    d->raw = level;
+    d->accepted = 0;
+    d->rejected = 0;
+}
+
+bool debounce_edge(debounce_t *d, uint32_t timestamp, uint8_t level)
+{
+    d->raw = level;
+
+    if ((level == d->level) || (timestamp - d->last_change < d->window))
+    {
+        d->rejected++;
+        return false;
+    }
+
+    d->level = level;
+    d->last_change = timestamp;
+    d->accepted++;
+    return true;
+}
+
+bool debounce_settling(debounce_t *d)
+{
+    return d->raw != d->level;
+}
+
+bool debounce_poll(debounce_t *d, uint32_t now, uint8_t level)
+{
+    d->raw = level;
+
+    if ((level == d->level) || (now - d->last_change < d->window))
+    {
+        return false;
+    }
+
+    d->level = level;
+    d->last_change = now;
+    d->accepted++;
+    return true;
+}
@@ -0,0 +1,45 @@
+/**
+ * @brief Timestamp-based contact debouncing for edge interrupts.
+ *
+ * The first edge that changes the debounced level is accepted at once and
+ * opens a lockout window, edges inside the window are rejected with a
+ * compare and a subtraction. This keeps bounces in the interrupt handler
+ * and only confirmed changes wake a thread.
+ *
+ * A pulse shorter than the window leaves the raw level different from the
+ * debounced one with no further edge to fix it. debounce_settling reports
+ * that case and debounce_poll resolves it after the window, called from
+ * the consuming thread with the current pin level.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef DEBOUNCE_H_
+#define DEBOUNCE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct debounce
+{
+    uint32_t window;      // Lockout after a change, timestamp units
+    uint32_t last_change; // Timestamp of the last accepted change
+    uint8_t level;        // Debounced level
+    uint8_t raw;          // Level of the last edge seen
+    uint32_t accepted;
+    uint32_t rejected;
+} debounce_t;
+
+void debounce_init(debounce_t *d, uint32_t window, uint8_t level, uint32_t now);
+
+// Feed one edge, true if it is a confirmed change of the debounced level.
+bool debounce_edge(debounce_t *d, uint32_t timestamp, uint8_t level);
+
+// True if a rejected edge left the raw level different from the debounced one.
+bool debounce_settling(debounce_t *d);
+
+// Re-check a settling input after the window, true if level is a confirmed change.
+// Must not race with debounce_edge, call it with the interrupt masked.
+bool debounce_poll(debounce_t *d, uint32_t now, uint8_t level);
+
+#endif//DEBOUNCE_H_
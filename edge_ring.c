@@ -0,0 +1,75 @@
+/**
+ * @brief Lock-free SPSC ring of GPIO edges, see edge_ring.h.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "edge_ring.h"
+
+#include <string.h>
+
+#include "em_device.h"
+
+#define EDGE_RING_MASK (EDGE_RING_SIZE - 1)
+
+void edge_ring_init(edge_ring_t *r)
+{
+    memset(r, 0, sizeof(edge_ring_t));
+}
+
+bool edge_ring_push(edge_ring_t *r, uint32_t timestamp, uint8_t port, uint8_t pin, uint8_t level)
+{
+    uint32_t head = r->head;
+    uint32_t used = head - r->tail;
+
+    if (used >= EDGE_RING_SIZE)
+    {
+        r->dropped++;
+        return false;
+    }
+
+    edge_event_t *e = &r->events[head & EDGE_RING_MASK];
+    e->timestamp = timestamp;
+    e->port = port;
+    e->pin = pin;
+    e->level = level;
+
+    // The record must be complete before the consumer can see the new head
+    __DMB();
+    r->head = head + 1;
+    r->pushed++;
+
+    if (used + 1 > r->high_water)
+    {
+        r->high_water = used + 1;
+    }
+    return true;
+}
+
+uint32_t edge_ring_pop(edge_ring_t *r, edge_event_t *out, uint32_t max)
+{
+    uint32_t tail = r->tail;
+    uint32_t count = r->head - tail;
+
+    if (count > max)
+    {
+        count = max;
+    }
+
+    // Records up to head are complete once head has been read
+    __DMB();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        out[i] = r->events[(tail + i) & EDGE_RING_MASK];
+    }
+
+    // Slots are only handed back after they have been copied out
+    __DMB();
+    r->tail = tail + count;
+    return count;
+}
+
+uint32_t edge_ring_count(edge_ring_t *r)
+{
+    return r->head - r->tail;
+}
@@ -0,0 +1,52 @@
+/**
+ * @brief Lock-free single-producer single-consumer ring of GPIO edges.
+ *
+ * The interrupt handler pushes one record per edge and the consuming
+ * thread drains them in batches, so edges that arrive while the thread is
+ * busy are queued with their timestamps instead of being merged into one
+ * thread flag. Only the producer writes head and only the consumer writes
+ * tail, which is all the synchronisation a single core needs besides the
+ * barriers that order the record against the index update.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef EDGE_RING_H_
+#define EDGE_RING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EDGE_RING_SIZE 32 // Power of two
+
+typedef struct edge_event
+{
+    uint32_t timestamp; // osKernelGetSysTimerCount at the edge
+    uint8_t port;
+    uint8_t pin;
+    uint8_t level;      // Pin level after the edge
+    uint8_t reserved;
+} edge_event_t;
+
+typedef struct edge_ring
+{
+    edge_event_t events[EDGE_RING_SIZE];
+    volatile uint32_t head;    // Free-running, producer only
+    volatile uint32_t tail;    // Free-running, consumer only
+    volatile uint32_t pushed;  // Records accepted
+    volatile uint32_t dropped; // Records lost because the ring was full
+    uint32_t high_water;       // Largest fill level seen by the producer
+} edge_ring_t;
+
+void edge_ring_init(edge_ring_t *r);
+
+// Producer side, safe in interrupt context. False if the record was dropped.
+bool edge_ring_push(edge_ring_t *r, uint32_t timestamp, uint8_t port, uint8_t pin, uint8_t level);
+
+// Consumer side, copy out up to max records, returns the number copied.
+uint32_t edge_ring_pop(edge_ring_t *r, edge_event_t *out, uint32_t max);
+
+// Number of records waiting for the consumer.
+uint32_t edge_ring_count(edge_ring_t *r);
+
+#endif//EDGE_RING_H_
@@ -0,0 +1,114 @@
+/**
+ * @brief Dispatch table for the GPIO external interrupt lines, see exti.h.
+ *
+ * Flags are cleared before the handlers run, an edge that arrives while a
+ * handler is running raises the interrupt again instead of being lost.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "exti.h"
+#include "latency.h"
+#include "pinrec.h"
+
+#include "em_core.h"
+#include "em_gpio.h"
+
+typedef struct exti_entry
+{
+    exti_handler_f handler;
+    void *context;
+} exti_entry_t;
+
+static exti_entry_t m_table[EXTI_LINES];
+static volatile uint32_t m_spurious;
+
+bool exti_register(uint8_t line, exti_handler_f handler, void *context)
+{
+    bool ok = false;
+
+    if ((line >= EXTI_LINES) || (NULL == handler))
+    {
+        return false;
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    if (NULL == m_table[line].handler)
+    {
+        m_table[line].context = context;
+        m_table[line].handler = handler;
+        ok = true;
+    }
+    CORE_EXIT_ATOMIC();
+
+    if (ok)
+    {
+        IRQn_Type irq = (line & 1) ? GPIO_ODD_IRQn : GPIO_EVEN_IRQn;
+
+        NVIC_SetPriority(irq, EXTI_IRQ_PRIORITY);
+        NVIC_EnableIRQ(irq);
+    }
+    return ok;
+}
+
+void exti_unregister(uint8_t line)
+{
+    if (line < EXTI_LINES)
+    {
+        GPIO_IntDisable(1UL << line);
+
+        CORE_DECLARE_IRQ_STATE;
+        CORE_ENTER_ATOMIC();
+        m_table[line].handler = NULL;
+        m_table[line].context = NULL;
+        CORE_EXIT_ATOMIC();
+    }
+}
+
+void exti_dispatch(uint32_t pending)
+{
+    while (0 != pending)
+    {
+        uint8_t line = 31 - __CLZ(pending);
+        exti_entry_t *e = &m_table[line];
+
+        pending &= ~(1UL << line);
+        pinrec_exti(line);
+        if (NULL != e->handler)
+        {
+            e->handler(line, e->context);
+        }
+        else
+        {
+            m_spurious++;
+        }
+    }
+}
+
+uint32_t exti_spurious(void)
+{
+    return m_spurious;
+}
+
+void GPIO_EVEN_IRQHandler(void)
+{
+    latency_irq_entry();
+
+    // Get all pending and enabled interrupts of the even lines.
+    uint32_t pending = GPIO_IntGetEnabled() & EXTI_EVEN_MASK;
+
+    GPIO_IntClear(pending);
+    exti_dispatch(pending);
+}
+
+void GPIO_ODD_IRQHandler(void)
+{
+    latency_irq_entry();
+
+    // Get all pending and enabled interrupts of the odd lines.
+    uint32_t pending = GPIO_IntGetEnabled() & EXTI_ODD_MASK;
+
+    GPIO_IntClear(pending);
+    exti_dispatch(pending);
+}
@@ -0,0 +1,41 @@
+/**
+ * @brief Dispatch table for the 16 GPIO external interrupt lines.
+ *
+ * Even lines are served by GPIO_EVEN_IRQHandler and odd lines by
+ * GPIO_ODD_IRQHandler, both defined here. The pending mask is walked with
+ * count-leading-zeros, so a dispatch costs one step per line that is
+ * actually pending no matter how many lines are registered.
+ *
+ * Pin configuration (GPIO_ExtIntConfig) and the per-line GPIO_IntEnable
+ * stay with the owner of the line, registering only installs the handler
+ * and enables the NVIC interrupt of its half.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef EXTI_H_
+#define EXTI_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EXTI_LINES        16
+#define EXTI_EVEN_MASK    0x5555UL
+#define EXTI_ODD_MASK     0xAAAAUL
+#define EXTI_IRQ_PRIORITY 3
+
+// Called in interrupt context with the line flag already cleared.
+typedef void (*exti_handler_f)(uint8_t line, void *context);
+
+// Install handler for line and enable its NVIC interrupt, false if taken.
+bool exti_register(uint8_t line, exti_handler_f handler, void *context);
+
+void exti_unregister(uint8_t line);
+
+// Call the handlers of all lines in pending, highest line first.
+void exti_dispatch(uint32_t pending);
+
+// Pending lines that had no handler installed.
+uint32_t exti_spurious(void);
+
+#endif//EXTI_H_
@@ -0,0 +1,183 @@
+/**
+ * @brief Start and stop gate for periodic producer threads, see gate.h.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "gate.h"
+
+#include <stddef.h>
+
+#define GATE_OPEN      0x80000000U // Producers may run
+#define GATE_STARTED   0x40000000U // Origin stamped for this generation, producers may enter
+#define GATE_STARTING  0x20000000U // Someone is stamping the origin and setting the flag
+#define GATE_GEN_ONE   0x00010000U
+#define GATE_GEN_MASK  0x1FFF0000U
+#define GATE_IN_MASK   0x0000FFFFU // Producers entered and not out yet
+#define GATE_RUN_MASK  (GATE_OPEN | GATE_GEN_MASK) // What a ticket holds, STARTING comes and goes under it
+
+#define GATE_FLAG_STARTED 0x00000001U // Mirrors GATE_STARTED for the producers waiting
+
+static uint32_t gate_load(gate_t *g)
+{
+    return __atomic_load_n(&g->state, __ATOMIC_ACQUIRE);
+}
+
+static bool gate_swap(gate_t *g, uint32_t *expected, uint32_t desired)
+{
+    return __atomic_compare_exchange_n(&g->state, expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+// Open, not started and nobody in, whoever sees it first claims the start
+static bool gate_startable(uint32_t s)
+{
+    return (GATE_OPEN == (s & (GATE_OPEN | GATE_STARTED | GATE_STARTING))) && (0 == (s & GATE_IN_MASK));
+}
+
+// Holder of GATE_STARTING only. The origin is stamped while nobody is in, the flag
+// follows the state, and the claim is handed on only once nothing is left to start.
+static void gate_start(gate_t *g)
+{
+    for (;;)
+    {
+        uint32_t s;
+
+        __atomic_store_n(&g->origin, osKernelGetTickCount(), __ATOMIC_RELAXED);
+        s = gate_load(g);
+        while ((s & GATE_OPEN) && !gate_swap(g, &s, s | GATE_STARTED))
+        {
+        }
+        if (s & GATE_OPEN)
+        {
+            osEventFlagsSet(g->flags, GATE_FLAG_STARTED);
+        }
+
+        // A close since then, or a close and open with everyone out, is seen here
+        s = gate_load(g);
+        while (!gate_startable(s & ~GATE_STARTING))
+        {
+            if (0 == (s & GATE_STARTED))
+            {
+                osEventFlagsClear(g->flags, GATE_FLAG_STARTED);
+            }
+            if (gate_swap(g, &s, s & ~GATE_STARTING))
+            {
+                return;
+            }
+        }
+    }
+}
+
+bool gate_init(gate_t *g, const char *name, gate_idle_f idle, void *user)
+{
+    const osEventFlagsAttr_t attr = {.name = name, .cb_mem = &g->flags_cb, .cb_size = sizeof(g->flags_cb)};
+
+    g->state = 0;
+    g->origin = 0;
+    g->idle = idle;
+    g->user = user;
+    g->flags = osEventFlagsNew(&attr);
+    return NULL != g->flags;
+}
+
+void gate_open(gate_t *g)
+{
+    uint32_t s = gate_load(g);
+    uint32_t next;
+
+    do
+    {
+        if (s & GATE_OPEN)
+        {
+            return;
+        }
+        next = (s & ~(GATE_STARTED | GATE_GEN_MASK)) | GATE_OPEN | ((s + GATE_GEN_ONE) & GATE_GEN_MASK);
+        if (gate_startable(next))
+        {
+            next |= GATE_STARTING;
+        }
+    } while (!gate_swap(g, &s, next));
+
+    // With producers still in, the last of them starts on its way out
+    if (next & GATE_STARTING)
+    {
+        gate_start(g);
+    }
+}
+
+void gate_close(gate_t *g)
+{
+    uint32_t s = gate_load(g);
+
+    while (!gate_swap(g, &s, s & ~(GATE_OPEN | GATE_STARTED)))
+    {
+    }
+    osEventFlagsClear(g->flags, GATE_FLAG_STARTED);
+}
+
+uint32_t gate_enter(gate_t *g, uint32_t *ticket)
+{
+    uint32_t s = gate_load(g);
+
+    for (;;)
+    {
+        if (s & GATE_STARTED)
+        {
+            if (gate_swap(g, &s, s + 1))
+            {
+                break;
+            }
+            continue;
+        }
+
+        osEventFlagsWait(g->flags, GATE_FLAG_STARTED, osFlagsWaitAny | osFlagsNoClear, osWaitForever);
+        s = gate_load(g);
+        if (0 == (s & GATE_STARTED))
+        {
+            // Woken by the flag of a start closed right after, it is cleared in a moment
+            osDelay(1);
+            s = gate_load(g);
+        }
+    }
+
+    *ticket = s & GATE_RUN_MASK;
+    return __atomic_load_n(&g->origin, __ATOMIC_RELAXED);
+}
+
+bool gate_pass(gate_t *g, uint32_t ticket)
+{
+    uint32_t s = gate_load(g);
+    uint32_t next;
+    bool idle = false;
+
+    if ((s & GATE_RUN_MASK) == ticket)
+    {
+        return true;
+    }
+
+    // Out of the gate, the last one leaves the output idle before anyone can start again
+    do
+    {
+        if (!idle && (1 == (s & GATE_IN_MASK)) && (NULL != g->idle))
+        {
+            g->idle(g->user);
+            idle = true;
+        }
+        next = s - 1;
+        if (gate_startable(next))
+        {
+            next |= GATE_STARTING;
+        }
+    } while (!gate_swap(g, &s, next));
+
+    if (next & GATE_STARTING)
+    {
+        gate_start(g);
+    }
+    return false;
+}
+
+bool gate_is_open(gate_t *g)
+{
+    return 0 != (gate_load(g) & GATE_OPEN);
+}
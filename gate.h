@@ -0,0 +1,84 @@
+/**
+ * @brief Start and stop gate for periodic producer threads, glitch free and
+ * phase aligned, without suspending any thread.
+ *
+ * A producer enters the gate, which blocks on an event flag until the gate
+ * is open and returns the common origin tick. It then sleeps to absolute
+ * deadlines from that origin and asks the gate at every period boundary
+ * whether to go on:
+ *
+ *   for (;;)
+ *   {
+ *       uint32_t ticket;
+ *       uint32_t next = gate_enter(&gate, &ticket);
+ *
+ *       for (;;)
+ *       {
+ *           next += PERIOD;
+ *           osDelayUntil(next);
+ *           if (!gate_pass(&gate, ticket))
+ *           {
+ *               break;
+ *           }
+ *           GPIO_PinOutToggle(gpioPortA, 0);
+ *       }
+ *   }
+ *
+ * Closing the gate only flips its state, every producer finishes the
+ * period it is in and leaves at the boundary without acting. The last one
+ * out calls the idle action, driving the pin to its idle level, after
+ * which no producer can touch it until the next start. Opening the gate
+ * waits for every producer to be out, then stamps the origin and sets the
+ * event flag, so all of them restart on the same time base however long
+ * the gate was closed and however quickly it was reopened.
+ *
+ * The state is one atomic word: open, started and a start in progress,
+ * a generation counted up by every open and the number of producers in.
+ * gate_pass is a single load compared against the ticket from gate_enter.
+ * Open and close come from one controller thread, enter and pass from any
+ * number of producer threads, none of them from interrupts.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef GATE_H_
+#define GATE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cmsis_os2.h"
+#include "FreeRTOS.h" // StaticEventGroup_t
+
+// Drive the output to its idle level, called by the last producer to leave.
+typedef void (*gate_idle_f)(void *user);
+
+typedef struct gate
+{
+    uint32_t state;  // Only through the __atomic builtins
+    uint32_t origin; // Kernel tick of the last start
+    gate_idle_f idle;
+    void *user;
+    osEventFlagsId_t flags;
+    StaticEventGroup_t flags_cb;
+} gate_t;
+
+// Set up a closed gate, name is that of its event flags.
+bool gate_init(gate_t *g, const char *name, gate_idle_f idle, void *user);
+
+// Start the producers, once all of them are out of the gate.
+void gate_open(gate_t *g);
+
+// Stop the producers at their next period boundary.
+void gate_close(gate_t *g);
+
+// Wait until the gate is open, the ticket goes to gate_pass. Returns the origin tick.
+uint32_t gate_enter(gate_t *g, uint32_t *ticket);
+
+// At a period boundary, true to go on. False when the gate has been closed or
+// reopened since the ticket was taken, the producer is out and enters again.
+bool gate_pass(gate_t *g, uint32_t ticket);
+
+bool gate_is_open(gate_t *g);
+
+#endif//GATE_H_
@@ -0,0 +1,194 @@
+/**
+ * @brief Button gesture recognizer, see gesture.h.
+ *
+ * Per button states:
+ *   IDLE     - released, nothing pending
+ *   PRESSED  - down, deadline is the long press
+ *   RELEASED - up after clicks, deadline ends the N-click
+ *   HELD     - down past the long press, deadline is the next repeat
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "gesture.h"
+
+#include <string.h>
+
+enum
+{
+    GESTURE_IDLE,
+    GESTURE_PRESSED,
+    GESTURE_RELEASED,
+    GESTURE_HELD
+};
+
+static void gesture_emit(gesture_t *g, uint8_t button, uint8_t type, uint8_t count, uint32_t timestamp)
+{
+    gesture_event_t event = {.timestamp = timestamp, .button = button, .type = type, .count = count};
+
+    for (uint8_t i = 0; i < GESTURE_MAX_SUBSCRIBERS; i++)
+    {
+        gesture_subscriber_t *s = &g->subscribers[i];
+
+        if ((NULL != s->handler) && (s->mask & GESTURE_MASK(type)))
+        {
+            s->handler(&event, s->user);
+        }
+    }
+}
+
+// Held buttons only have a deadline if hold repeats are enabled.
+static bool gesture_pending(gesture_t *g, gesture_button_t *b)
+{
+    return (GESTURE_IDLE != b->state) && ((GESTURE_HELD != b->state) || (0 != g->config.repeat));
+}
+
+void gesture_init(gesture_t *g, const gesture_config_t *config)
+{
+    memset(g, 0, sizeof(gesture_t));
+    g->config = *config;
+}
+
+bool gesture_subscribe(gesture_t *g, gesture_handler_f handler, void *user, uint32_t mask)
+{
+    for (uint8_t i = 0; i < GESTURE_MAX_SUBSCRIBERS; i++)
+    {
+        gesture_subscriber_t *s = &g->subscribers[i];
+
+        if (NULL == s->handler)
+        {
+            s->user = user;
+            s->mask = mask;
+            s->handler = handler;
+            return true;
+        }
+    }
+    return false;
+}
+
+// The deadline of button i if it passed at now, wrap-safe, false if there is none.
+static bool gesture_expire(gesture_t *g, uint8_t i, uint32_t now)
+{
+    gesture_button_t *b = &g->buttons[i];
+
+    if (!gesture_pending(g, b) || ((int32_t)(now - b->deadline) < 0))
+    {
+        return false;
+    }
+
+    switch (b->state)
+    {
+        case GESTURE_RELEASED:
+            b->state = GESTURE_IDLE;
+            gesture_emit(g, i, GESTURE_CLICK, b->clicks, b->deadline);
+            break;
+
+        case GESTURE_PRESSED:
+            // Clicks before the long press are reported on their own
+            if (0 != b->clicks)
+            {
+                gesture_emit(g, i, GESTURE_CLICK, b->clicks, b->deadline);
+            }
+            b->state = GESTURE_HELD;
+            b->repeats = 0;
+            gesture_emit(g, i, GESTURE_LONG_PRESS, 1, b->deadline);
+            b->deadline += g->config.repeat;
+            break;
+
+        case GESTURE_HELD:
+            b->repeats++;
+            gesture_emit(g, i, GESTURE_HOLD_REPEAT, b->repeats, b->deadline);
+            b->deadline += g->config.repeat;
+            break;
+    }
+    return true;
+}
+
+void gesture_edge(gesture_t *g, uint8_t button, uint32_t timestamp, bool pressed)
+{
+    if (button >= GESTURE_MAX_BUTTONS)
+    {
+        return;
+    }
+
+    gesture_button_t *b = &g->buttons[button];
+
+    // Edges may be drained late, what was due before this one happened first
+    while (gesture_expire(g, button, timestamp))
+    {
+    }
+
+    switch (b->state)
+    {
+        case GESTURE_IDLE:
+        case GESTURE_RELEASED:
+            if (pressed)
+            {
+                if (GESTURE_IDLE == b->state)
+                {
+                    b->clicks = 0;
+                }
+                b->state = GESTURE_PRESSED;
+                b->deadline = timestamp + g->config.long_press;
+            }
+            break;
+
+        case GESTURE_PRESSED:
+            if (!pressed)
+            {
+                if (++b->clicks >= g->config.max_clicks)
+                {
+                    b->state = GESTURE_IDLE;
+                    gesture_emit(g, button, GESTURE_CLICK, b->clicks, timestamp);
+                }
+                else
+                {
+                    b->state = GESTURE_RELEASED;
+                    b->deadline = timestamp + g->config.click_gap;
+                }
+            }
+            break;
+
+        case GESTURE_HELD:
+            if (!pressed)
+            {
+                b->state = GESTURE_IDLE;
+                gesture_emit(g, button, GESTURE_HOLD_END, b->repeats, timestamp);
+            }
+            break;
+    }
+}
+
+void gesture_timeout(gesture_t *g, uint32_t now)
+{
+    for (uint8_t i = 0; i < GESTURE_MAX_BUTTONS; i++)
+    {
+        gesture_expire(g, i, now);
+    }
+}
+
+bool gesture_next_deadline(gesture_t *g, uint32_t now, uint32_t *remaining)
+{
+    bool pending = false;
+    uint32_t earliest = UINT32_MAX;
+
+    for (uint8_t i = 0; i < GESTURE_MAX_BUTTONS; i++)
+    {
+        gesture_button_t *b = &g->buttons[i];
+
+        if (gesture_pending(g, b))
+        {
+            int32_t left = (int32_t)(b->deadline - now);
+            uint32_t r = (left > 0) ? (uint32_t)left : 0;
+
+            if (r < earliest)
+            {
+                earliest = r;
+            }
+            pending = true;
+        }
+    }
+
+    *remaining = earliest;
+    return pending;
+}
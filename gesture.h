@@ -0,0 +1,96 @@
+/**
+ * @brief Button gesture recognizer on top of debounced, timestamped edges.
+ *
+ * Each button runs a small state machine that classifies clicks, N-clicks,
+ * long presses and press-and-hold repeats. Edges are processed in O(1)
+ * with no allocation, so gesture_edge can be called at interrupt rate for
+ * several buttons. Time-based decisions (click gap over, long press
+ * reached, next repeat) use one deadline per button instead of polling,
+ * the owner sleeps until gesture_next_deadline and then calls
+ * gesture_timeout. Recognized gestures are delivered to subscribers.
+ *
+ * Edges can be fed late, in a batch after the deadlines they came after.
+ * Every deadline at or before the timestamp of an edge is handled before
+ * the edge, so the gestures only depend on the timestamps.
+ *
+ * All times are in the unit of the edge timestamps, usually the kernel
+ * system timer, and compared by unsigned difference.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef GESTURE_H_
+#define GESTURE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GESTURE_MAX_BUTTONS     4
+#define GESTURE_MAX_SUBSCRIBERS 4
+
+typedef enum gesture_type
+{
+    GESTURE_CLICK,       // count is 1 for single, 2 for double click ...
+    GESTURE_LONG_PRESS,  // Held for long_press
+    GESTURE_HOLD_REPEAT, // Every repeat interval while still held, count increments
+    GESTURE_HOLD_END     // Released after a long press
+} gesture_type_t;
+
+#define GESTURE_MASK(type) (1U << (type))
+#define GESTURE_MASK_ALL   0x0FU
+
+typedef struct gesture_event
+{
+    uint32_t timestamp;
+    uint8_t button;
+    uint8_t type;  // gesture_type_t
+    uint8_t count;
+} gesture_event_t;
+
+typedef void (*gesture_handler_f)(const gesture_event_t *event, void *user);
+
+typedef struct gesture_config
+{
+    uint32_t click_gap;  // Longest release between clicks of one N-click
+    uint32_t long_press; // Hold time for a long press
+    uint32_t repeat;     // Hold repeat interval after the long press, 0 disables
+    uint8_t max_clicks;  // Report at once when this many clicks are reached
+} gesture_config_t;
+
+typedef struct gesture_button
+{
+    uint32_t deadline;
+    uint8_t state;
+    uint8_t clicks;
+    uint8_t repeats;
+} gesture_button_t;
+
+typedef struct gesture_subscriber
+{
+    gesture_handler_f handler;
+    void *user;
+    uint32_t mask;
+} gesture_subscriber_t;
+
+typedef struct gesture
+{
+    gesture_config_t config;
+    gesture_button_t buttons[GESTURE_MAX_BUTTONS];
+    gesture_subscriber_t subscribers[GESTURE_MAX_SUBSCRIBERS];
+} gesture_t;
+
+void gesture_init(gesture_t *g, const gesture_config_t *config);
+
+// Deliver the gesture types in mask to handler, false if the table is full.
+bool gesture_subscribe(gesture_t *g, gesture_handler_f handler, void *user, uint32_t mask);
+
+// Feed a debounced edge of button, pressed is the new state.
+void gesture_edge(gesture_t *g, uint8_t button, uint32_t timestamp, bool pressed);
+
+// Handle all deadlines that have passed at now.
+void gesture_timeout(gesture_t *g, uint32_t now);
+
+// Time from now until the earliest deadline, false if nothing is pending.
+bool gesture_next_deadline(gesture_t *g, uint32_t now, uint32_t *remaining);
+
+#endif//GESTURE_H_
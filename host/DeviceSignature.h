@@ -0,0 +1,10 @@
+/**
+ * @brief Placeholder for the device signature, the host has none.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef DEVICESIGNATURE_H_
+#define DEVICESIGNATURE_H_
+
+#endif//DEVICESIGNATURE_H_
@@ -0,0 +1,45 @@
+/**
+ * @brief FreeRTOS base, tick and static allocation types for the host build.
+ *
+ * Control blocks given as cb_mem hold the thread, timer and event flags
+ * records of host/os.c, so the sizes are the host ones, not those of the
+ * target.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef FREERTOS_H_
+#define FREERTOS_H_
+
+#include <stdint.h>
+
+typedef uint32_t StackType_t; // Stack depths count these, like on the Cortex-M
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFUL)
+
+#define configSTACK_DEPTH_TYPE uint16_t
+
+typedef struct
+{
+    uint64_t reserved[24];
+} StaticTask_t;
+
+typedef struct
+{
+    uint64_t reserved[8];
+} StaticTimer_t;
+
+typedef struct
+{
+    uint64_t reserved[4];
+} StaticEventGroup_t;
+
+typedef struct
+{
+    uint64_t reserved[4];
+} StaticSemaphore_t;
+
+#endif//FREERTOS_H_
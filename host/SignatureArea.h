@@ -0,0 +1,10 @@
+/**
+ * @brief Placeholder for the device signature area, the host has none.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef SIGNATUREAREA_H_
+#define SIGNATUREAREA_H_
+
+#endif//SIGNATUREAREA_H_
@@ -0,0 +1,40 @@
+/**
+ * @brief Cycle counter for the host microbenchmarks.
+ *
+ * The TSC on x86, which counts at the nominal clock whatever the core
+ * runs at, and nanoseconds elsewhere. BENCH_COUNTER names it in the
+ * reports. Either way it measures the host, not the device, so only the
+ * ratios between runs carry over.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+#define BENCH_COUNTER "tsc"
+
+static inline uint64_t bench_cycles(void)
+{
+    return __rdtsc();
+}
+#else
+#include <time.h>
+
+#define BENCH_COUNTER "ns"
+
+static inline uint64_t bench_cycles(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+#endif
+
+#endif//BENCH_H_
@@ -0,0 +1,228 @@
+/**
+ * @brief DDS test, the frequencies rendered by dds.c against the ones asked
+ * for, and the limits of dds_set_frequency and dds_sweep.
+ *
+ *   esw-gpio-ddstest [-v]
+ *
+ * Each constant tone is rendered for TEST_SECONDS at the DDS rate of
+ * main.c and its frequency taken from the pin toggles, two per period.
+ * It must be within TEST_TOLERANCE_MHZ of the one asked for, the toggles
+ * can be one off at either end. A sweep must be on the exact increment
+ * one step before its end, without drifting away on the way. Frequencies from half
+ * the sample rate up must be refused, and so must a vibrato that would swing
+ * the carrier or a sweep to 0 or half the sample rate, whichever of the two
+ * is set first. -v prints every case. Exits 1 on any mismatch.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../dds.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define TEST_RATE          32000 // ESWGPIO_DDS_RATE of main.c, Hz
+#define TEST_SECONDS       10
+#define TEST_BLOCK         256
+#define TEST_TOLERANCE_MHZ 100   // One toggle over TEST_SECONDS is 50 mHz
+#define TEST_SWEEP_PPM     200   // Increment before the last sweep step against the exact one
+
+// Constant tones, mHz
+static const uint32_t TEST_TONES[] = {20000, 440000, 1000000, 2093005, 3000000, 12345678, 15999000};
+
+typedef struct test_sweep
+{
+    const char *name;
+    uint32_t from_mhz;
+    uint32_t to_mhz;
+    uint32_t ms;
+    dds_sweep_t shape;
+} test_sweep_t;
+
+static const test_sweep_t TEST_SWEEPS[] = {
+    {"siren up", 1000000, 3000000, 700, DDS_SWEEP_EXPONENTIAL},
+    {"siren down", 3000000, 1000000, 700, DDS_SWEEP_EXPONENTIAL},
+    {"five octaves", 100000, 3200000, 5000, DDS_SWEEP_EXPONENTIAL},
+    {"linear up", 200000, 8000000, 2000, DDS_SWEEP_LINEAR},
+    {"linear down", 8000000, 200000, 2000, DDS_SWEEP_LINEAR},
+};
+
+static dds_t m_dds;
+static uint32_t m_block[TEST_BLOCK];
+static bool m_verbose;
+
+static bool test_report(bool ok, const char *fmt, const char *name, int64_t got, int64_t expected)
+{
+    if (!ok || m_verbose)
+    {
+        fprintf(ok ? stdout : stderr, "%s %s: ", ok ? "ok" : "FAIL", name);
+        fprintf(ok ? stdout : stderr, fmt, got, expected);
+        fputc('\n', ok ? stdout : stderr);
+    }
+    return ok;
+}
+
+static bool test_taken(const char *name, bool taken, bool expected)
+{
+    return test_report(taken == expected, "taken %" PRId64 ", expected %" PRId64, name, taken, expected);
+}
+
+static bool test_tone(uint32_t freq_mhz)
+{
+    char name[32];
+    uint64_t toggles = 0;
+    int64_t got;
+
+    snprintf(name, sizeof(name), "tone %" PRIu32 " mHz", freq_mhz);
+    dds_init(&m_dds, TEST_RATE);
+    if (!dds_set_frequency(&m_dds, 0, freq_mhz))
+    {
+        return test_taken(name, false, true);
+    }
+    for (uint32_t b = 0; b < TEST_SECONDS * TEST_RATE / TEST_BLOCK; b++)
+    {
+        dds_render_toggles(&m_dds, m_block, TEST_BLOCK);
+        for (uint32_t i = 0; i < TEST_BLOCK; i++)
+        {
+            toggles += (0 != m_block[i]) ? 1 : 0;
+        }
+    }
+
+    got = (int64_t)(toggles * 1000 / 2 / TEST_SECONDS);
+    return test_report(llabs(got - (int64_t)freq_mhz) <= TEST_TOLERANCE_MHZ, "%" PRId64 " mHz, expected %" PRId64,
+                       name, got, freq_mhz);
+}
+
+static bool test_sweep(const test_sweep_t *s)
+{
+    uint32_t samples = (uint64_t)TEST_RATE * s->ms / 1000;
+    double start;
+    double end;
+    double exact;
+    int64_t ppm;
+
+    dds_init(&m_dds, TEST_RATE);
+    start = dds_increment(&m_dds, s->from_mhz);
+    end = dds_increment(&m_dds, s->to_mhz);
+
+    // One step short of the end
+    if (DDS_SWEEP_LINEAR == s->shape)
+    {
+        exact = end - (end - start) / samples;
+    }
+    else
+    {
+        exact = end / pow(end / start, 1.0 / samples);
+    }
+
+    if (!dds_sweep(&m_dds, 0, s->from_mhz, s->to_mhz, samples, s->shape, false))
+    {
+        return test_taken(s->name, false, true);
+    }
+
+    // Up to the last step, it then snaps to the end increment
+    for (uint32_t left = samples - 1; 0 != left;)
+    {
+        uint32_t n = (left < TEST_BLOCK) ? left : TEST_BLOCK;
+
+        dds_render_toggles(&m_dds, m_block, n);
+        left -= n;
+    }
+
+    ppm = (int64_t)llround((m_dds.voices[0].inc - exact) * 1000000 / exact);
+    return test_report(llabs(ppm) <= TEST_SWEEP_PPM, "%" PRId64 " ppm off the exact increment, at most %" PRId64,
+                       s->name, ppm, TEST_SWEEP_PPM);
+}
+
+static bool test_limits(void)
+{
+    const uint32_t nyquist = TEST_RATE * 1000 / 2;
+    bool ok = true;
+
+    dds_init(&m_dds, TEST_RATE);
+    ok &= test_taken("just below nyquist", dds_set_frequency(&m_dds, 0, nyquist - 1), true);
+    ok &= test_taken("nyquist", dds_set_frequency(&m_dds, 0, nyquist), false);
+    ok &= test_taken("above nyquist", dds_set_frequency(&m_dds, 0, 3 * nyquist), false);
+    ok &= test_taken("sweep to nyquist", dds_sweep(&m_dds, 0, 1000000, nyquist, TEST_RATE, DDS_SWEEP_LINEAR, false),
+                     false);
+    ok &= test_taken("sweep from nyquist", dds_sweep(&m_dds, 0, nyquist, 1000000, TEST_RATE, DDS_SWEEP_LINEAR, false),
+                     false);
+    return ok;
+}
+
+static bool test_vibrato(void)
+{
+    const uint32_t nyquist = TEST_RATE * 1000 / 2;
+    const uint32_t rate = 6000;
+    bool ok = true;
+    uint32_t depth;
+
+    dds_init(&m_dds, TEST_RATE);
+    dds_set_frequency(&m_dds, 0, 1000000);
+    ok &= test_taken("vibrato just above 0", dds_vibrato(&m_dds, 0, rate, 999999), true);
+    depth = m_dds.voices[0].lfo_depth;
+    ok &= test_taken("vibrato to 0", dds_vibrato(&m_dds, 0, rate, 1000000), false);
+    ok &= test_taken("refused vibrato kept the old", depth == m_dds.voices[0].lfo_depth, true);
+    ok &= test_taken("vibrato from nyquist", dds_vibrato(&m_dds, 0, rate, nyquist), false);
+    ok &= test_taken("vibrato off", dds_vibrato(&m_dds, 0, 0, nyquist), true);
+
+    dds_set_frequency(&m_dds, 0, nyquist - 1000000);
+    ok &= test_taken("vibrato just below nyquist", dds_vibrato(&m_dds, 0, rate, 999999), true);
+    ok &= test_taken("vibrato to nyquist", dds_vibrato(&m_dds, 0, rate, 1000000), false);
+
+    // Vibrato first, the carrier then has to leave room for it
+    dds_init(&m_dds, TEST_RATE);
+    ok &= test_taken("vibrato before a carrier", dds_vibrato(&m_dds, 0, rate, 20000), true);
+    ok &= test_taken("carrier under the vibrato", dds_set_frequency(&m_dds, 0, 15000), false);
+    ok &= test_taken("carrier over the vibrato", dds_set_frequency(&m_dds, 0, 25000), true);
+    ok &= test_taken("vibrato sweep to nyquist", dds_sweep(&m_dds, 0, 1000000, nyquist - 10000, TEST_RATE,
+                                                           DDS_SWEEP_EXPONENTIAL, true), false);
+    ok &= test_taken("vibrato sweep from under it", dds_sweep(&m_dds, 0, 10000, 1000000, TEST_RATE,
+                                                              DDS_SWEEP_LINEAR, false), false);
+    ok &= test_taken("vibrato sweep", dds_sweep(&m_dds, 0, 1000000, 3000000, TEST_RATE, DDS_SWEEP_EXPONENTIAL,
+                                                true), true);
+
+    // Both ends of a sweep count, wherever it is at
+    ok &= test_taken("vibrato to 0 on a sweep", dds_vibrato(&m_dds, 0, rate, 1000000), false);
+    dds_sweep(&m_dds, 0, 14000000, 3000000, TEST_RATE, DDS_SWEEP_LINEAR, false);
+    ok &= test_taken("vibrato to nyquist on a sweep", dds_vibrato(&m_dds, 0, rate, 2000000), false);
+    ok &= test_taken("vibrato within the sweep", dds_vibrato(&m_dds, 0, rate, 1999999), true);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t failed = 0;
+    uint32_t count = 0;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "vh")))
+    {
+        if ('v' != opt)
+        {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 'h' == opt ? 0 : 1;
+        }
+        m_verbose = true;
+    }
+
+    for (uint32_t i = 0; i < sizeof(TEST_TONES) / sizeof(TEST_TONES[0]); i++, count++)
+    {
+        failed += test_tone(TEST_TONES[i]) ? 0 : 1;
+    }
+    for (uint32_t i = 0; i < sizeof(TEST_SWEEPS) / sizeof(TEST_SWEEPS[0]); i++, count++)
+    {
+        failed += test_sweep(&TEST_SWEEPS[i]) ? 0 : 1;
+    }
+    failed += test_limits() ? 0 : 1;
+    failed += test_vibrato() ? 0 : 1;
+    count += 2;
+
+    printf("dds: %" PRIu32 " of %" PRIu32 " cases failed\n", failed, count);
+    return (0 == failed) ? 0 : 1;
+}
@@ -0,0 +1,252 @@
+/**
+ * @brief Debouncer test, bounce traces of the button replayed through
+ * debounce.c the way the button interrupt and button_loop drive it.
+ *
+ *   esw-gpio-debouncetest [-v] [-d directory]
+ *
+ * Each trace in -d, bounce in the working directory by default, has one
+ * pin change per line and the changes the debouncer must confirm:
+ *
+ *   # us since start, level, the first line is the level at the start
+ *   0 1
+ *   100000 0
+ *   100035 1
+ *   expect 100000 0
+ *
+ * Every change is one interrupt. A rejected change that leaves the pin
+ * off the debounced level wakes button_loop unless its settle poll is
+ * armed already. The poll is a window and a tick after the wake, reads the
+ * pin and is armed again while the input is still settling. Each trace is replayed once
+ * from 0 and once with the timestamps wrapping right after its first
+ * change. -v prints every confirmed change. Exits 1 on any mismatch.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../debounce.h"
+#include "../button_timing.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_CHANGES_MAX 256
+#define TEST_WINDOW_US   (ESWGPIO_DEBOUNCE_MS * 1000)
+#define TEST_TICK_US     1000 // One tick of the settle poll timeout
+#define TEST_NO_POLL     UINT64_MAX
+
+static const char * const TEST_TRACES[] = {"press_release", "spike", "short_tap", "slow_release"};
+
+typedef struct test_change
+{
+    uint32_t at_us;
+    uint8_t level;
+} test_change_t;
+
+typedef struct test_trace
+{
+    test_change_t changes[TEST_CHANGES_MAX];
+    uint32_t change_count;
+    test_change_t expected[TEST_CHANGES_MAX];
+    uint32_t expected_count;
+} test_trace_t;
+
+static test_trace_t m_trace;
+static test_change_t m_confirmed[TEST_CHANGES_MAX];
+static uint32_t m_confirmed_count;
+static bool m_verbose;
+
+static bool test_load(const char *path, test_trace_t *t)
+{
+    FILE *f = fopen(path, "r");
+    char line[128];
+    unsigned lineno = 0;
+
+    if (NULL == f)
+    {
+        perror(path);
+        return false;
+    }
+
+    memset(t, 0, sizeof(*t));
+    while (NULL != fgets(line, sizeof(line), f))
+    {
+        bool expect = (0 == strncmp(line, "expect ", 7));
+        test_change_t *list = expect ? t->expected : t->changes;
+        uint32_t *count = expect ? &t->expected_count : &t->change_count;
+        unsigned long us;
+        unsigned level;
+
+        lineno++;
+        if (('#' == line[0]) || ('\n' == line[0]))
+        {
+            continue;
+        }
+        if ((2 != sscanf(expect ? line + 7 : line, "%lu %u", &us, &level)) || (level > 1) || (us > UINT32_MAX / 2)
+            || (*count >= TEST_CHANGES_MAX) || (!expect && (0 != *count) && (us <= list[*count - 1].at_us)))
+        {
+            fprintf(stderr, "%s:%u: expected [expect] <us> <0|1>, at most %u in order\n", path, lineno,
+                    TEST_CHANGES_MAX);
+            fclose(f);
+            return false;
+        }
+        list[(*count)++] = (test_change_t){.at_us = us, .level = level};
+    }
+    fclose(f);
+
+    if (0 == t->change_count)
+    {
+        fprintf(stderr, "%s: no level at the start\n", path);
+        return false;
+    }
+    return true;
+}
+
+static void test_confirm(uint32_t at_us, uint8_t level)
+{
+    if (m_confirmed_count < TEST_CHANGES_MAX)
+    {
+        m_confirmed[m_confirmed_count++] = (test_change_t){.at_us = at_us, .level = level};
+    }
+}
+
+// The settle poll of button_loop, with the pin as it is by then
+static void test_poll(debounce_t *d, uint64_t *poll_us, uint32_t offset, uint8_t pin)
+{
+    uint64_t at_us = *poll_us;
+
+    *poll_us = TEST_NO_POLL;
+    if ((TEST_NO_POLL == at_us) || !debounce_settling(d))
+    {
+        return;
+    }
+    if (debounce_poll(d, (uint32_t)at_us + offset, pin))
+    {
+        test_confirm((uint32_t)at_us, pin);
+    }
+    else if (debounce_settling(d))
+    {
+        // Too early for the last bounce, the thread goes round and waits again
+        *poll_us = at_us + TEST_WINDOW_US + TEST_TICK_US;
+    }
+}
+
+// Timestamps are the trace time plus offset, the expected changes stay in trace time
+static void test_replay(const test_trace_t *t, uint32_t offset)
+{
+    debounce_t d;
+    uint64_t poll_us = TEST_NO_POLL;
+    uint8_t pin = t->changes[0].level;
+
+    m_confirmed_count = 0;
+    debounce_init(&d, TEST_WINDOW_US, pin, t->changes[0].at_us + offset);
+    for (uint32_t i = 1; i < t->change_count; i++)
+    {
+        const test_change_t *c = &t->changes[i];
+
+        while (c->at_us >= poll_us)
+        {
+            test_poll(&d, &poll_us, offset, pin);
+        }
+
+        pin = c->level;
+        if (debounce_edge(&d, c->at_us + offset, pin))
+        {
+            test_confirm(c->at_us, pin);
+            poll_us = TEST_NO_POLL;
+        }
+        else if (debounce_settling(&d) && (TEST_NO_POLL == poll_us))
+        {
+            // The interrupt woke the thread, it waits a window and a tick from now
+            poll_us = (uint64_t)c->at_us + TEST_WINDOW_US + TEST_TICK_US;
+        }
+    }
+    while (TEST_NO_POLL != poll_us)
+    {
+        test_poll(&d, &poll_us, offset, pin);
+    }
+}
+
+static bool test_check(const char *name, const test_trace_t *t, uint32_t offset)
+{
+    bool ok = (m_confirmed_count == t->expected_count);
+
+    for (uint32_t i = 0; ok && (i < m_confirmed_count); i++)
+    {
+        ok = (m_confirmed[i].at_us == t->expected[i].at_us) && (m_confirmed[i].level == t->expected[i].level);
+    }
+
+    if (!ok || m_verbose)
+    {
+        FILE *out = ok ? stdout : stderr;
+
+        fprintf(out, "%s %s from %" PRIu32 ":", ok ? "ok" : "FAIL", name, offset);
+        for (uint32_t i = 0; i < m_confirmed_count; i++)
+        {
+            fprintf(out, " %" PRIu32 "/%u", m_confirmed[i].at_us, m_confirmed[i].level);
+        }
+        if (!ok)
+        {
+            fprintf(out, ", expected");
+            for (uint32_t i = 0; i < t->expected_count; i++)
+            {
+                fprintf(out, " %" PRIu32 "/%u", t->expected[i].at_us, t->expected[i].level);
+            }
+        }
+        fputc('\n', out);
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dir = "bounce";
+    uint32_t failed = 0;
+    uint32_t count = 0;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "vd:h")))
+    {
+        switch (opt)
+        {
+            case 'v':
+                m_verbose = true;
+                break;
+            case 'd':
+                dir = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-v] [-d directory]\n", argv[0]);
+                return 'h' == opt ? 0 : 1;
+        }
+    }
+
+    for (uint32_t i = 0; i < sizeof(TEST_TRACES) / sizeof(TEST_TRACES[0]); i++)
+    {
+        char path[256];
+
+        snprintf(path, sizeof(path), "%s/%s.txt", dir, TEST_TRACES[i]);
+        if (!test_load(path, &m_trace))
+        {
+            failed++;
+            count++;
+            continue;
+        }
+
+        // Straight, then wrapping 100 us after the first change
+        uint32_t wrap = (m_trace.change_count > 1) ? m_trace.changes[1].at_us + 100 : 0;
+        uint32_t offsets[] = {0, 0 - wrap};
+
+        for (uint32_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++, count++)
+        {
+            test_replay(&m_trace, offsets[o]);
+            failed += test_check(TEST_TRACES[i], &m_trace, offsets[o]) ? 0 : 1;
+        }
+    }
+
+    printf("debounce: %" PRIu32 " of %" PRIu32 " replays failed\n", failed, count);
+    return (0 == failed) ? 0 : 1;
+}
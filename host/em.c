@@ -0,0 +1,952 @@
+/**
+ * @brief Peripheral models for the host build: NVIC, CMU, GPIO, TIMER, USART
+ * transmitter, LDMA, RTCC and the energy modes, see em_device.h for the
+ * registers.
+ *
+ * Interrupts run on whichever pthread raises or unmasks them, in parallel
+ * with the thread holding the RTOS CPU, as they would preempt it on the
+ * device. Masking is one mutex, held by the outermost critical section and
+ * by the running handler, so handlers never overlap critical sections or
+ * each other. Pending interrupts run lowest number first. Raising an
+ * interrupt never waits, while the mutex is held it stays pending and the
+ * holder runs it on release, so edges that arrive meanwhile merge in the
+ * flags like they do on the device.
+ *
+ * LDMA requests are paced by the TIMER overflow rate and the USART0 byte
+ * time in host time and processed in batches by host_periph_advance, all
+ * sources in time order. Bytes written to USART0 TXDATA go to stdout.
+ * The interrupt of a descriptor that completes with doneIfs runs before the
+ * next request is served. In a simulation the clock is set to each request
+ * and the batch ends at the interrupt, so the threads it wakes run first.
+ *
+ * EMU_EnterEM1 and EMU_EnterEM2 are called masked, like WFI with PRIMASK
+ * set, and wait in host/os.c until a thread is ready or the earliest enabled
+ * RTCC compare is reached, which sets its flag and raises the RTCC
+ * interrupt. The mask is let go while asleep, interrupts run right away on
+ * the thread that raises them as they do in the idle loop, waking the core
+ * through a thread would only add host scheduling to their latency.
+ * Compares only match for a sleeping core. Both modes are the same here,
+ * the peripherals keep running.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "host.h"
+#include "em_cmu.h"
+#include "em_emu.h"
+#include "em_gpio.h"
+#include "em_ldma.h"
+#include "em_rtcc.h"
+#include "em_timer.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+#define HOST_PERIPH_STEP_NS 1000000ULL
+#define HOST_USART_BAUD     115200UL // VCOM rate, 8N1 is 10 bits per byte
+#define HOST_REQ_SOURCES    3        // TIMER0, TIMER1, USART0
+#define HOST_RTCC_CHANNELS  3
+
+// Idle of host/os.c, the sleeping core waits there
+void host_cpu_sleep(uint64_t until_ns);
+
+// Handlers the firmware does not define stay NULL.
+void TIMER0_IRQHandler(void) __attribute__((weak));
+void TIMER1_IRQHandler(void) __attribute__((weak));
+void USART0_RX_IRQHandler(void) __attribute__((weak));
+void USART0_TX_IRQHandler(void) __attribute__((weak));
+void LDMA_IRQHandler(void) __attribute__((weak));
+void GPIO_EVEN_IRQHandler(void) __attribute__((weak));
+void GPIO_ODD_IRQHandler(void) __attribute__((weak));
+void RTCC_IRQHandler(void) __attribute__((weak));
+
+static void (*const m_vectors[HOST_IRQ_COUNT])(void) = {
+    [TIMER0_IRQn] = TIMER0_IRQHandler,
+    [USART0_RX_IRQn] = USART0_RX_IRQHandler,
+    [USART0_TX_IRQn] = USART0_TX_IRQHandler,
+    [LDMA_IRQn] = LDMA_IRQHandler,
+    [GPIO_EVEN_IRQn] = GPIO_EVEN_IRQHandler,
+    [TIMER1_IRQn] = TIMER1_IRQHandler,
+    [GPIO_ODD_IRQn] = GPIO_ODD_IRQHandler,
+    [RTCC_IRQn] = RTCC_IRQHandler,
+};
+
+DWT_Type host_dwt_regs;
+CoreDebug_Type host_coredebug_regs;
+SysTick_Type host_systick_regs;
+SCB_Type host_scb_regs;
+GPIO_TypeDef host_gpio_regs;
+TIMER_TypeDef host_timer_regs[2];
+LDMA_TypeDef host_ldma_regs;
+USART_TypeDef host_usart_regs;
+RTCC_TypeDef host_rtcc_regs;
+
+static pthread_mutex_t m_irq_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread uint32_t m_mask_depth;
+static __thread bool m_in_isr;
+static uint32_t m_irq_pending;
+static uint32_t m_irq_enabled;
+static host_irq_stats_t m_irq_stats[HOST_IRQ_COUNT];
+static uint64_t m_irq_raised_ns[HOST_IRQ_COUNT]; // When the pending interrupt was raised
+
+static bool m_clocks[cmuClock_COUNT];
+
+static uint8_t m_pin_mode[GPIO_PORT_COUNT][16];
+static uint16_t m_driven[GPIO_PORT_COUNT]; // Input pins under host_gpio_input control
+static uint16_t m_input[GPIO_PORT_COUNT];  // and the levels they are driven to
+static uint8_t m_exti_port[16];
+static uint8_t m_exti_pin[16];
+
+typedef struct host_ldma_channel
+{
+    const LDMA_Descriptor_t *desc;
+    LDMA_PeripheralSignal_t signal;
+    uint32_t remaining;
+} host_ldma_channel_t;
+
+static pthread_mutex_t m_periph_lock = PTHREAD_MUTEX_INITIALIZER;
+static host_ldma_channel_t m_channels[LDMA_CH_NUM];
+static bool m_source_armed[HOST_REQ_SOURCES];
+static uint64_t m_source_next[HOST_REQ_SOURCES];
+static bool m_usart_sent;
+
+void host_em_init(void)
+{
+    GPIO->INSENSE = GPIO_INSENSE_INT | GPIO_INSENSE_EM4WU;
+    host_systick_regs.LOAD = HOST_CORE_CLOCK_HZ / HOST_TICK_FREQ - 1;
+    host_usart_regs.STATUS = USART_STATUS_TXC;
+}
+
+SysTick_Type *host_systick(void)
+{
+    uint64_t tick_ns = 1000000000ULL / HOST_TICK_FREQ;
+    uint32_t per_tick = host_systick_regs.LOAD + 1;
+
+    host_systick_regs.VAL = host_systick_regs.LOAD - (uint32_t)(host_now_ns() % tick_ns * per_tick / tick_ns);
+    return &host_systick_regs;
+}
+
+// _________________________________ Interrupts _________________________________
+
+static uint32_t host_irq_runnable(void)
+{
+    return __atomic_load_n(&m_irq_pending, __ATOMIC_ACQUIRE) & __atomic_load_n(&m_irq_enabled, __ATOMIC_ACQUIRE);
+}
+
+static void host_irq_deliver(void)
+{
+    // Masked here, the outermost unmask delivers. Handlers do not nest.
+    if ((0 != m_mask_depth) || m_in_isr)
+    {
+        return;
+    }
+
+    // Whoever holds the mask runs what became pending meanwhile, after letting go
+    while (0 != host_irq_runnable())
+    {
+        if (0 != pthread_mutex_trylock(&m_irq_lock))
+        {
+            return;
+        }
+        m_in_isr = true;
+        for (;;)
+        {
+            uint32_t run = host_irq_runnable();
+            uint32_t irq;
+            uint64_t waited;
+
+            if (0 == run)
+            {
+                break;
+            }
+            irq = __builtin_ctz(run);
+            waited = host_now_ns() - __atomic_load_n(&m_irq_raised_ns[irq], __ATOMIC_ACQUIRE);
+            __atomic_fetch_and(&m_irq_pending, ~(1UL << irq), __ATOMIC_ACQ_REL);
+
+            __atomic_fetch_add(&m_irq_stats[irq].delivered, 1, __ATOMIC_RELAXED);
+            if (waited > __atomic_load_n(&m_irq_stats[irq].worst_ns, __ATOMIC_RELAXED))
+            {
+                __atomic_store_n(&m_irq_stats[irq].worst_ns, waited, __ATOMIC_RELAXED);
+            }
+            if (NULL != m_vectors[irq])
+            {
+                host_trace("irq", "%u", (unsigned)irq);
+                m_vectors[irq]();
+            }
+        }
+        m_in_isr = false;
+        pthread_mutex_unlock(&m_irq_lock);
+    }
+}
+
+void host_irq(IRQn_Type irq)
+{
+    uint32_t mask = 1UL << irq;
+
+    // The wait is measured from the first request, later ones merge into it
+    if (0 == (__atomic_load_n(&m_irq_pending, __ATOMIC_ACQUIRE) & mask))
+    {
+        __atomic_store_n(&m_irq_raised_ns[irq], host_now_ns(), __ATOMIC_RELEASE);
+    }
+    __atomic_fetch_add(&m_irq_stats[irq].raised, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_or(&m_irq_pending, mask, __ATOMIC_ACQ_REL);
+    host_irq_deliver();
+}
+
+void host_irq_stats(IRQn_Type irq, host_irq_stats_t *out, bool clear)
+{
+    out->raised = __atomic_load_n(&m_irq_stats[irq].raised, __ATOMIC_RELAXED);
+    out->delivered = __atomic_load_n(&m_irq_stats[irq].delivered, __ATOMIC_RELAXED);
+    out->worst_ns = __atomic_load_n(&m_irq_stats[irq].worst_ns, __ATOMIC_RELAXED);
+    if (clear)
+    {
+        __atomic_fetch_sub(&m_irq_stats[irq].raised, out->raised, __ATOMIC_RELAXED);
+        __atomic_fetch_sub(&m_irq_stats[irq].delivered, out->delivered, __ATOMIC_RELAXED);
+        __atomic_store_n(&m_irq_stats[irq].worst_ns, 0, __ATOMIC_RELAXED);
+    }
+}
+
+bool host_in_isr(void)
+{
+    return m_in_isr;
+}
+
+void host_irq_mask(void)
+{
+    if ((0 == m_mask_depth++) && !m_in_isr)
+    {
+        pthread_mutex_lock(&m_irq_lock);
+    }
+}
+
+void host_irq_unmask(void)
+{
+    if ((0 == --m_mask_depth) && !m_in_isr)
+    {
+        pthread_mutex_unlock(&m_irq_lock);
+        host_irq_deliver();
+    }
+}
+
+void NVIC_EnableIRQ(IRQn_Type irq)
+{
+    __atomic_fetch_or(&m_irq_enabled, 1UL << irq, __ATOMIC_ACQ_REL);
+    host_irq_deliver();
+}
+
+void NVIC_DisableIRQ(IRQn_Type irq)
+{
+    __atomic_fetch_and(&m_irq_enabled, ~(1UL << irq), __ATOMIC_ACQ_REL);
+}
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority)
+{
+    // All interrupts share one level on the host
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type irq)
+{
+    __atomic_fetch_and(&m_irq_pending, ~(1UL << irq), __ATOMIC_ACQ_REL);
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type irq)
+{
+    host_irq(irq);
+}
+
+// ____________________________________ CMU ____________________________________
+
+void CMU_ClockEnable(CMU_Clock_TypeDef clock, bool enable)
+{
+    if (clock < cmuClock_COUNT)
+    {
+        m_clocks[clock] = enable;
+    }
+}
+
+void CMU_ClockSelectSet(CMU_Clock_TypeDef clock, CMU_Select_TypeDef ref)
+{
+}
+
+uint32_t CMU_ClockFreqGet(CMU_Clock_TypeDef clock)
+{
+    return HOST_CORE_CLOCK_HZ;
+}
+
+// ____________________________________ EMU ____________________________________
+
+static uint64_t host_rtcc_count(void)
+{
+    return host_now_ns() * HOST_RTCC_HZ / 1000000000ULL;
+}
+
+static void host_emu_sleep(void)
+{
+    uint32_t ien = __atomic_load_n(&RTCC->IEN, __ATOMIC_ACQUIRE);
+    uint64_t count = host_rtcc_count();
+    uint64_t at[HOST_RTCC_CHANNELS];
+    uint64_t until = UINT64_MAX;
+    uint32_t matched = 0;
+
+    // When each enabled compare matches, a whole counter wrap ahead at most
+    for (uint8_t ch = 0; ch < HOST_RTCC_CHANNELS; ch++)
+    {
+        uint32_t ahead = __atomic_load_n(&RTCC->CC[ch].CCV, __ATOMIC_ACQUIRE) - (uint32_t)count;
+
+        at[ch] = UINT64_MAX;
+        if ((RTCC->CTRL & RTCC_CTRL_ENABLE) && (ien & (RTCC_IF_CC0 << ch)))
+        {
+            at[ch] = ((count + ahead) * 1000000000ULL + HOST_RTCC_HZ - 1) / HOST_RTCC_HZ;
+            until = (at[ch] < until) ? at[ch] : until;
+        }
+    }
+
+    // Called from the outermost critical section, not from a handler
+    uint32_t depth = m_mask_depth;
+
+    m_mask_depth = 0;
+    pthread_mutex_unlock(&m_irq_lock);
+    host_irq_deliver();
+    host_cpu_sleep(until);
+    pthread_mutex_lock(&m_irq_lock);
+    m_mask_depth = depth;
+
+    for (uint8_t ch = 0; ch < HOST_RTCC_CHANNELS; ch++)
+    {
+        if ((UINT64_MAX != at[ch]) && (host_now_ns() >= at[ch]))
+        {
+            matched |= RTCC_IF_CC0 << ch;
+        }
+    }
+    if (0 != matched)
+    {
+        __atomic_fetch_or(&RTCC->IF, matched, __ATOMIC_ACQ_REL);
+        host_irq(RTCC_IRQn);
+    }
+}
+
+void EMU_EnterEM1(void)
+{
+    host_trace("sleep", "em1");
+    host_emu_sleep();
+}
+
+void EMU_EnterEM2(bool restore)
+{
+    host_trace("sleep", "em2");
+    host_emu_sleep();
+}
+
+// ____________________________________ RTCC ___________________________________
+
+void RTCC_Init(const RTCC_Init_TypeDef *init)
+{
+    RTCC->CTRL = init->enable ? RTCC_CTRL_ENABLE : 0;
+}
+
+void RTCC_Enable(bool enable)
+{
+    RTCC->CTRL = enable ? (RTCC->CTRL | RTCC_CTRL_ENABLE) : (RTCC->CTRL & ~RTCC_CTRL_ENABLE);
+}
+
+void RTCC_ChannelInit(int ch, const RTCC_CCChConf_TypeDef *conf)
+{
+    RTCC->CC[ch].CTRL = conf->chMode;
+}
+
+uint32_t RTCC_CounterGet(void)
+{
+    return (uint32_t)host_rtcc_count();
+}
+
+// ____________________________________ GPIO ___________________________________
+
+// The GPIO model is shared by the firmware, the LDMA and the input drivers.
+static pthread_mutex_t m_gpio_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint8_t host_gpio_read(uint8_t port, uint8_t pin)
+{
+    uint8_t mode = m_pin_mode[port][pin];
+    uint8_t out = (GPIO->P[port].DOUT >> pin) & 1;
+
+    if ((gpioModePushPull == mode) || (gpioModeWiredAnd == mode))
+    {
+        return out;
+    }
+    if (m_driven[port] & (1U << pin))
+    {
+        return (m_input[port] >> pin) & 1;
+    }
+    // Undriven inputs float to their pull, DOUT selects its direction
+    return ((gpioModeInputPull == mode) || (gpioModeInputPullFilter == mode)) ? out : 0;
+}
+
+static void host_gpio_din_update(uint8_t port)
+{
+    uint32_t din = 0;
+
+    for (uint8_t pin = 0; pin < 16; pin++)
+    {
+        din |= (uint32_t)host_gpio_read(port, pin) << pin;
+    }
+    GPIO->P[port].DIN = din;
+}
+
+// Request the GPIO interrupts of all pending and enabled lines, unlocked.
+static void host_gpio_request(void)
+{
+    uint32_t requests;
+
+    pthread_mutex_lock(&m_gpio_lock);
+    requests = GPIO->IF & GPIO->IEN;
+    pthread_mutex_unlock(&m_gpio_lock);
+
+    if (requests & 0x5555UL)
+    {
+        host_irq(GPIO_EVEN_IRQn);
+    }
+    if (requests & 0xAAAAUL)
+    {
+        host_irq(GPIO_ODD_IRQn);
+    }
+}
+
+static void host_gpio_write(uint8_t port, uint32_t set, uint32_t clear, uint32_t toggle)
+{
+    uint32_t before;
+    uint32_t changed;
+
+    pthread_mutex_lock(&m_gpio_lock);
+    before = GPIO->P[port].DOUT;
+    GPIO->P[port].DOUT = ((before | set) & ~clear) ^ toggle;
+    changed = (before ^ GPIO->P[port].DOUT) & 0xFFFFUL;
+    host_gpio_din_update(port);
+
+    for (uint8_t pin = 0; 0 != changed; pin++, changed >>= 1)
+    {
+        if (changed & 1)
+        {
+            uint8_t level = (GPIO->P[port].DOUT >> pin) & 1;
+
+            host_trace("pin", "P%c%u %u", 'A' + port, pin, level);
+            host_vcd_pin(port, pin, level);
+        }
+    }
+    pthread_mutex_unlock(&m_gpio_lock);
+}
+
+static void host_gpio_update(volatile uint32_t *reg, uint32_t set, uint32_t clear)
+{
+    pthread_mutex_lock(&m_gpio_lock);
+    *reg = (*reg | set) & ~clear;
+    pthread_mutex_unlock(&m_gpio_lock);
+}
+
+static uint32_t host_gpio_get(volatile uint32_t *reg)
+{
+    uint32_t value;
+
+    pthread_mutex_lock(&m_gpio_lock);
+    value = *reg;
+    pthread_mutex_unlock(&m_gpio_lock);
+    return value;
+}
+
+void GPIO_PinModeSet(GPIO_Port_TypeDef port, unsigned int pin, GPIO_Mode_TypeDef mode, unsigned int out)
+{
+    pthread_mutex_lock(&m_gpio_lock);
+    m_pin_mode[port][pin] = mode;
+    pthread_mutex_unlock(&m_gpio_lock);
+    host_gpio_write(port, out ? (1UL << pin) : 0, out ? 0 : (1UL << pin), 0);
+}
+
+void GPIO_PinOutSet(GPIO_Port_TypeDef port, unsigned int pin)
+{
+    host_gpio_write(port, 1UL << pin, 0, 0);
+}
+
+void GPIO_PinOutClear(GPIO_Port_TypeDef port, unsigned int pin)
+{
+    host_gpio_write(port, 0, 1UL << pin, 0);
+}
+
+void GPIO_PinOutToggle(GPIO_Port_TypeDef port, unsigned int pin)
+{
+    host_gpio_write(port, 0, 0, 1UL << pin);
+}
+
+unsigned int GPIO_PinOutGet(GPIO_Port_TypeDef port, unsigned int pin)
+{
+    return (host_gpio_get(&GPIO->P[port].DOUT) >> pin) & 1;
+}
+
+unsigned int GPIO_PinInGet(GPIO_Port_TypeDef port, unsigned int pin)
+{
+    return host_gpio_level(port, pin);
+}
+
+void GPIO_ExtIntConfig(GPIO_Port_TypeDef port, unsigned int pin, unsigned int intNo,
+                       bool risingEdge, bool fallingEdge, bool enable)
+{
+    uint32_t mask = 1UL << intNo;
+    uint8_t shift = 4 * (intNo & 7);
+    volatile uint32_t *psel;
+    volatile uint32_t *isel;
+
+    pthread_mutex_lock(&m_gpio_lock);
+    m_exti_port[intNo] = port;
+    m_exti_pin[intNo] = pin;
+    // Port and pin within the group of four, as emlib sets them
+    psel = (intNo < 8) ? &GPIO->EXTIPSELL : &GPIO->EXTIPSELH;
+    isel = (intNo < 8) ? &GPIO->EXTIPINSELL : &GPIO->EXTIPINSELH;
+    *psel = (*psel & ~(0xFUL << shift)) | ((uint32_t)port << shift);
+    *isel = (*isel & ~(0x3UL << shift)) | ((uint32_t)(pin & 3) << shift);
+    GPIO->EXTIRISE = risingEdge ? (GPIO->EXTIRISE | mask) : (GPIO->EXTIRISE & ~mask);
+    GPIO->EXTIFALL = fallingEdge ? (GPIO->EXTIFALL | mask) : (GPIO->EXTIFALL & ~mask);
+    pthread_mutex_unlock(&m_gpio_lock);
+
+    GPIO_IntClear(mask);
+    if (enable)
+    {
+        GPIO_IntEnable(mask);
+    }
+    else
+    {
+        GPIO_IntDisable(mask);
+    }
+}
+
+void GPIO_InputSenseSet(uint32_t val, uint32_t mask)
+{
+    host_gpio_update(&GPIO->INSENSE, val & mask, ~val & mask);
+}
+
+void GPIO_IntEnable(uint32_t flags)
+{
+    host_gpio_update(&GPIO->IEN, flags, 0);
+    host_gpio_request();
+}
+
+void GPIO_IntDisable(uint32_t flags)
+{
+    host_gpio_update(&GPIO->IEN, 0, flags);
+}
+
+void GPIO_IntClear(uint32_t flags)
+{
+    host_gpio_update(&GPIO->IF, 0, flags);
+}
+
+void GPIO_IntSet(uint32_t flags)
+{
+    host_gpio_update(&GPIO->IF, flags, 0);
+    host_gpio_request();
+}
+
+uint32_t GPIO_IntGet(void)
+{
+    return host_gpio_get(&GPIO->IF);
+}
+
+uint32_t GPIO_IntGetEnabled(void)
+{
+    uint32_t value;
+
+    pthread_mutex_lock(&m_gpio_lock);
+    value = GPIO->IF & GPIO->IEN;
+    pthread_mutex_unlock(&m_gpio_lock);
+    return value;
+}
+
+void host_gpio_input(uint8_t port, uint8_t pin, uint8_t level)
+{
+    uint8_t before;
+    uint8_t after;
+    uint32_t edges = 0;
+
+    pthread_mutex_lock(&m_gpio_lock);
+    host_trace("input", "P%c%u %u", 'A' + port, pin, level);
+    before = host_gpio_read(port, pin);
+    m_driven[port] |= 1U << pin;
+    m_input[port] = level ? (m_input[port] | (1U << pin)) : (m_input[port] & ~(1U << pin));
+    host_gpio_din_update(port);
+    after = host_gpio_read(port, pin);
+    if (before != after)
+    {
+        host_vcd_pin(port, pin, after);
+    }
+
+    if ((before != after) && (GPIO->INSENSE & GPIO_INSENSE_INT))
+    {
+        for (uint8_t line = 0; line < 16; line++)
+        {
+            if ((m_exti_port[line] == port) && (m_exti_pin[line] == pin))
+            {
+                uint32_t sense = after ? GPIO->EXTIRISE : GPIO->EXTIFALL;
+
+                edges |= sense & (1UL << line);
+            }
+        }
+        GPIO->IF |= edges;
+    }
+    pthread_mutex_unlock(&m_gpio_lock);
+
+    if (0 != edges)
+    {
+        host_gpio_request();
+    }
+}
+
+uint8_t host_gpio_level(uint8_t port, uint8_t pin)
+{
+    uint8_t level;
+
+    pthread_mutex_lock(&m_gpio_lock);
+    level = host_gpio_read(port, pin);
+    pthread_mutex_unlock(&m_gpio_lock);
+    return level;
+}
+
+// ____________________________________ TIMER __________________________________
+
+void TIMER_Init(TIMER_TypeDef *timer, const TIMER_Init_TypeDef *init)
+{
+    uint32_t ctrl = ((uint32_t)init->prescale << _TIMER_CTRL_PRESC_SHIFT)
+                    | (init->dmaClrAct ? TIMER_CTRL_DMACLRACT : 0);
+
+    __atomic_store_n(&timer->CTRL, ctrl, __ATOMIC_RELEASE);
+    timer->CNT = 0;
+    TIMER_Enable(timer, init->enable);
+}
+
+void TIMER_InitCC(TIMER_TypeDef *timer, unsigned int ch, const TIMER_InitCC_TypeDef *init)
+{
+    timer->CC[ch].CTRL = init->mode;
+}
+
+// ____________________________________ LDMA ___________________________________
+
+void LDMA_Init(const LDMA_Init_t *init)
+{
+    pthread_mutex_lock(&m_periph_lock);
+    __atomic_store_n(&LDMA->CHEN, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&LDMA->IF, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&LDMA->IEN, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&m_periph_lock);
+
+    NVIC_ClearPendingIRQ(LDMA_IRQn);
+    NVIC_SetPriority(LDMA_IRQn, init->ldmaInitIrqPriority);
+    NVIC_EnableIRQ(LDMA_IRQn);
+}
+
+static void host_ldma_load(uint8_t ch, const LDMA_Descriptor_t *desc)
+{
+    m_channels[ch].desc = desc;
+    m_channels[ch].remaining = desc->xfer.xferCnt + 1;
+    __atomic_store_n(&LDMA->CH[ch].SRC, desc->xfer.srcAddr, __ATOMIC_RELEASE);
+    __atomic_store_n(&LDMA->CH[ch].DST, desc->xfer.dstAddr, __ATOMIC_RELEASE);
+}
+
+void LDMA_StartTransfer(int ch, const LDMA_TransferCfg_t *transfer, const LDMA_Descriptor_t *descriptor)
+{
+    uint32_t mask = 1UL << ch;
+
+    pthread_mutex_lock(&m_periph_lock);
+    m_channels[ch].signal = transfer->ldmaReqSel;
+    host_ldma_load(ch, descriptor);
+    __atomic_fetch_and(&LDMA->CHDONE, ~mask, __ATOMIC_RELEASE);
+    __atomic_fetch_or(&LDMA->IEN, mask, __ATOMIC_RELEASE);
+    __atomic_fetch_or(&LDMA->CHEN, mask, __ATOMIC_ACQ_REL);
+    pthread_mutex_unlock(&m_periph_lock);
+}
+
+void LDMA_StopTransfer(int ch)
+{
+    pthread_mutex_lock(&m_periph_lock);
+    __atomic_fetch_and(&LDMA->CHEN, ~(1UL << ch), __ATOMIC_ACQ_REL);
+    m_channels[ch].desc = NULL;
+    pthread_mutex_unlock(&m_periph_lock);
+}
+
+bool LDMA_TransferDone(int ch)
+{
+    return 0 != (__atomic_load_n(&LDMA->CHDONE, __ATOMIC_ACQUIRE) & (1UL << ch));
+}
+
+// Enabled channels are read by the sleeping core, unlocked
+bool LDMA_ChannelEnabled(int ch)
+{
+    return 0 != (__atomic_load_n(&LDMA->CHEN, __ATOMIC_ACQUIRE) & (1UL << ch));
+}
+
+void LDMA_IntEnable(uint32_t flags)
+{
+    __atomic_fetch_or(&LDMA->IEN, flags, __ATOMIC_ACQ_REL);
+}
+
+void LDMA_IntDisable(uint32_t flags)
+{
+    __atomic_fetch_and(&LDMA->IEN, ~flags, __ATOMIC_ACQ_REL);
+}
+
+void LDMA_IntClear(uint32_t flags)
+{
+    __atomic_fetch_and(&LDMA->IF, ~flags, __ATOMIC_ACQ_REL);
+}
+
+uint32_t LDMA_IntGetEnabled(void)
+{
+    return __atomic_load_n(&LDMA->IF, __ATOMIC_ACQUIRE) & __atomic_load_n(&LDMA->IEN, __ATOMIC_ACQUIRE);
+}
+
+static uint32_t host_ldma_unit(uint8_t size, uint8_t inc)
+{
+    return (3 == inc) ? 0 : ((1UL << size) << inc);
+}
+
+// Serve one request of channel ch, true if it raised the channel interrupt.
+static bool host_ldma_request(uint8_t ch)
+{
+    host_ldma_channel_t *c = &m_channels[ch];
+    const LDMA_Descriptor_t *d = c->desc;
+    uintptr_t src = LDMA->CH[ch].SRC;
+    uintptr_t dst = LDMA->CH[ch].DST;
+    uint32_t mask = 1UL << ch;
+    uint32_t value;
+
+    switch (d->xfer.size)
+    {
+        case ldmaCtrlSizeByte:
+            value = *(const volatile uint8_t *)src;
+            break;
+        case ldmaCtrlSizeHalf:
+            value = *(const volatile uint16_t *)src;
+            break;
+        default:
+            value = *(const volatile uint32_t *)src;
+            break;
+    }
+
+    uint8_t port = 0;
+
+    // Toggle registers and the USART are the DMA destinations with side effects
+    while ((port < GPIO_PORT_COUNT) && (dst != (uintptr_t)&GPIO->P[port].DOUTTGL))
+    {
+        port++;
+    }
+    if (port < GPIO_PORT_COUNT)
+    {
+        host_gpio_write(port, 0, 0, value);
+    }
+    else if (dst == (uintptr_t)&USART0->TXDATA)
+    {
+        putchar((uint8_t)value);
+        m_usart_sent = true;
+    }
+    else
+    {
+        switch (d->xfer.size)
+        {
+            case ldmaCtrlSizeByte:
+                *(volatile uint8_t *)dst = (uint8_t)value;
+                break;
+            case ldmaCtrlSizeHalf:
+                *(volatile uint16_t *)dst = (uint16_t)value;
+                break;
+            default:
+                *(volatile uint32_t *)dst = value;
+                break;
+        }
+    }
+
+    __atomic_store_n(&LDMA->CH[ch].SRC, src + host_ldma_unit(d->xfer.size, d->xfer.srcInc), __ATOMIC_RELEASE);
+    __atomic_store_n(&LDMA->CH[ch].DST, dst + host_ldma_unit(d->xfer.size, d->xfer.dstInc), __ATOMIC_RELEASE);
+    if (0 != --c->remaining)
+    {
+        return false;
+    }
+
+    // Only relative links are modeled, absolute ones cannot hold a host pointer
+    if (d->xfer.link && (ldmaLinkModeRel == d->xfer.linkMode))
+    {
+        host_ldma_load(ch, d + d->xfer.linkAddr / 4);
+    }
+    else
+    {
+        c->desc = NULL;
+        __atomic_fetch_and(&LDMA->CHEN, ~mask, __ATOMIC_ACQ_REL);
+        __atomic_fetch_or(&LDMA->CHDONE, mask, __ATOMIC_RELEASE);
+    }
+
+    if (d->xfer.doneIfs)
+    {
+        __atomic_fetch_or(&LDMA->IF, mask, __ATOMIC_ACQ_REL);
+        return 0 != (__atomic_load_n(&LDMA->IEN, __ATOMIC_ACQUIRE) & mask);
+    }
+    return false;
+}
+
+// Period of a running timer in ns, 0 when it does not pace anything.
+static uint64_t host_timer_period(const TIMER_TypeDef *timer)
+{
+    uint32_t ctrl = __atomic_load_n(&timer->CTRL, __ATOMIC_ACQUIRE);
+    uint32_t top = __atomic_load_n(&timer->TOP, __ATOMIC_ACQUIRE);
+    uint32_t prescale = (ctrl & _TIMER_CTRL_PRESC_MASK) >> _TIMER_CTRL_PRESC_SHIFT;
+
+    if (!(__atomic_load_n(&timer->STATUS, __ATOMIC_ACQUIRE) & TIMER_STATUS_RUNNING))
+    {
+        return 0;
+    }
+    return ((uint64_t)(top + 1) << prescale) * 1000000000ULL / HOST_CORE_CLOCK_HZ;
+}
+
+// Update event of a timer, the buffered TOP and compare values take over for the next period.
+static void host_timer_overflow(TIMER_TypeDef *timer)
+{
+    uint32_t status = __atomic_fetch_and(&timer->STATUS, ~(TIMER_STATUS_TOPBV | (0xFUL * TIMER_STATUS_CCVBV0)),
+                                         __ATOMIC_ACQ_REL);
+
+    if (status & TIMER_STATUS_TOPBV)
+    {
+        __atomic_store_n(&timer->TOP, __atomic_load_n(&timer->TOPB, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+    }
+    for (uint8_t ch = 0; ch < 4; ch++)
+    {
+        if (status & (TIMER_STATUS_CCVBV0 << ch))
+        {
+            __atomic_store_n(&timer->CC[ch].CCV, __atomic_load_n(&timer->CC[ch].CCVB, __ATOMIC_ACQUIRE),
+                             __ATOMIC_RELEASE);
+        }
+    }
+}
+
+// Time between the requests of source i in ns, 0 while it requests nothing.
+static uint64_t host_source_period(uint8_t i)
+{
+    if (i < 2)
+    {
+        return host_timer_period(&host_timer_regs[i]);
+    }
+
+    // TXBL stays set while the transmitter has room, one byte per frame
+    for (uint8_t ch = 0; ch < LDMA_CH_NUM; ch++)
+    {
+        if ((LDMA->CHEN & (1UL << ch)) && (ldmaPeripheralSignal_USART0_TXBL == m_channels[ch].signal))
+        {
+            return 10 * 1000000000ULL / HOST_USART_BAUD;
+        }
+    }
+    return 0;
+}
+
+bool host_periph_advance(uint64_t now_ns)
+{
+    static const LDMA_PeripheralSignal_t signals[HOST_REQ_SOURCES] = {ldmaPeripheralSignal_TIMER0_UFOF,
+                                                                      ldmaPeripheralSignal_TIMER1_UFOF,
+                                                                      ldmaPeripheralSignal_USART0_TXBL};
+    bool done = true;
+
+    pthread_mutex_lock(&m_periph_lock);
+    for (;;)
+    {
+        uint64_t period[HOST_REQ_SOURCES];
+        int8_t t = -1;
+        bool irq = false;
+
+        // Requests of all sources are served in the order they happen
+        for (uint8_t i = 0; i < HOST_REQ_SOURCES; i++)
+        {
+            period[i] = host_source_period(i);
+            if (0 == period[i])
+            {
+                m_source_armed[i] = false;
+                continue;
+            }
+            if (!m_source_armed[i])
+            {
+                uint64_t now = host_now_ns();
+
+                // A timer overflows a period after it starts, an idle transmitter has room right away
+                m_source_armed[i] = true;
+                if (i < 2)
+                {
+                    m_source_next[i] = now + period[i];
+                }
+                else if (m_source_next[i] < now)
+                {
+                    m_source_next[i] = now;
+                }
+            }
+            if ((m_source_next[i] <= now_ns) && ((t < 0) || (m_source_next[i] < m_source_next[t])))
+            {
+                t = i;
+            }
+        }
+        if (t < 0)
+        {
+            break;
+        }
+
+        if (host_sim_enabled())
+        {
+            host_sim_set_now(m_source_next[t]);
+        }
+        if (t < 2)
+        {
+            // The next overflow is a period of the values latched at this one
+            host_timer_overflow(&host_timer_regs[t]);
+            period[t] = host_source_period(t);
+        }
+        m_source_next[t] += period[t];
+
+        for (uint8_t ch = 0; ch < LDMA_CH_NUM; ch++)
+        {
+            if ((LDMA->CHEN & (1UL << ch)) && (signals[t] == m_channels[ch].signal))
+            {
+                irq |= host_ldma_request(ch);
+            }
+        }
+
+        if (irq)
+        {
+            pthread_mutex_unlock(&m_periph_lock);
+            host_irq(LDMA_IRQn);
+            pthread_mutex_lock(&m_periph_lock);
+            if (host_sim_enabled())
+            {
+                done = false;
+                break;
+            }
+        }
+    }
+    if (m_usart_sent)
+    {
+        m_usart_sent = false;
+        fflush(stdout);
+    }
+    pthread_mutex_unlock(&m_periph_lock);
+    return done;
+}
+
+static void *host_periph_main(void *argument)
+{
+    const struct timespec step = {.tv_sec = 0, .tv_nsec = HOST_PERIPH_STEP_NS};
+
+    for (;;)
+    {
+        nanosleep(&step, NULL);
+        host_periph_advance(host_now_ns());
+    }
+    return NULL;
+}
+
+void host_periph_start(void)
+{
+    pthread_t thread;
+
+    pthread_create(&thread, NULL, host_periph_main, NULL);
+    pthread_detach(thread);
+}
@@ -0,0 +1,40 @@
+/**
+ * @brief Clock management for the host build, every clock runs at the HFXO
+ * frequency and enabling or selecting one is only recorded. The RTCC counts
+ * at 32768 Hz whatever its clock, see em_rtcc.h.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef EM_CMU_H_
+#define EM_CMU_H_
+
+#include "em_device.h"
+
+typedef enum
+{
+    cmuClock_HF,
+    cmuClock_CORE,
+    cmuClock_HFPER,
+    cmuClock_GPIO,
+    cmuClock_TIMER0,
+    cmuClock_TIMER1,
+    cmuClock_LDMA,
+    cmuClock_USART0,
+    cmuClock_LFE,
+    cmuClock_RTCC,
+    cmuClock_COUNT
+} CMU_Clock_TypeDef;
+
+typedef enum
+{
+    cmuSelect_LFRCO,
+    cmuSelect_LFXO,
+    cmuSelect_ULFRCO
+} CMU_Select_TypeDef;
+
+void CMU_ClockEnable(CMU_Clock_TypeDef clock, bool enable);
+void CMU_ClockSelectSet(CMU_Clock_TypeDef clock, CMU_Select_TypeDef ref);
+uint32_t CMU_ClockFreqGet(CMU_Clock_TypeDef clock);
+
+#endif//EM_CMU_H_
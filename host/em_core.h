@@ -0,0 +1,24 @@
+/**
+ * @brief Interrupt masking for the host build.
+ *
+ * Critical sections mask every modeled interrupt, interrupts raised meanwhile
+ * run when the outermost section ends, see host_irq_unmask.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef EM_CORE_H_
+#define EM_CORE_H_
+
+#include "host.h"
+
+typedef uint32_t CORE_irqState_t;
+
+#define CORE_DECLARE_IRQ_STATE  CORE_irqState_t irqState __attribute__((unused)) = 0
+#define CORE_ENTER_ATOMIC()     host_irq_mask()
+#define CORE_EXIT_ATOMIC()      host_irq_unmask()
+#define CORE_ENTER_CRITICAL()   host_irq_mask()
+#define CORE_EXIT_CRITICAL()    host_irq_unmask()
+#define CORE_InIrqContext()     host_in_isr()
+
+#endif//EM_CORE_H_
@@ -0,0 +1,252 @@
+/**
+ * @brief Device header for the host build, the EFR32MG12 interrupt numbers,
+ * Cortex-M intrinsics and the peripheral register models in host/em.c.
+ *
+ * Registers are plain memory. Only the fields and bits the firmware and the
+ * em_* shims touch are modeled, the peripheral behavior lives in em.c.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef EM_DEVICE_H_
+#define EM_DEVICE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum IRQn
+{
+    TIMER0_IRQn    = 2,
+    USART0_RX_IRQn = 3,
+    USART0_TX_IRQn = 4,
+    LDMA_IRQn      = 8,
+    GPIO_EVEN_IRQn = 10,
+    TIMER1_IRQn    = 12,
+    GPIO_ODD_IRQn  = 18,
+    RTCC_IRQn      = 30,
+    HOST_IRQ_COUNT = 32
+} IRQn_Type;
+
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+void NVIC_ClearPendingIRQ(IRQn_Type irq);
+void NVIC_SetPendingIRQ(IRQn_Type irq);
+
+static inline uint32_t __CLZ(uint32_t value)
+{
+    return (0 == value) ? 32 : (uint32_t)__builtin_clz(value);
+}
+
+static inline void __DMB(void)
+{
+    __sync_synchronize();
+}
+
+static inline void __DSB(void)
+{
+    __sync_synchronize();
+}
+
+static inline void __NOP(void)
+{
+}
+
+// _________________________________ Core debug _________________________________
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+
+uint32_t host_cycles(void);
+
+extern DWT_Type host_dwt_regs;
+extern CoreDebug_Type host_coredebug_regs;
+
+// CYCCNT follows the host clock, it is refreshed on every access
+static inline DWT_Type *host_dwt(void)
+{
+    host_dwt_regs.CYCCNT = host_cycles();
+    return &host_dwt_regs;
+}
+
+#define DWT       (host_dwt())
+#define CoreDebug (&host_coredebug_regs)
+
+// _________________________________ SysTick __________________________________
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t LOAD;
+    volatile uint32_t VAL;
+} SysTick_Type;
+
+typedef struct
+{
+    volatile uint32_t ICSR;
+} SCB_Type;
+
+#define SysTick_CTRL_ENABLE_Msk (1UL << 0)
+#define SCB_ICSR_PENDSTSET_Msk  (1UL << 26)
+
+extern SysTick_Type host_systick_regs;
+extern SCB_Type host_scb_regs;
+
+// The kernel tick is host time, VAL counts down to the next one. Stopping
+// the SysTick does not stop the tick.
+SysTick_Type *host_systick(void);
+
+// A pended SysTick has been taken by the next access.
+static inline SCB_Type *host_scb(void)
+{
+    host_scb_regs.ICSR = 0;
+    return &host_scb_regs;
+}
+
+#define SysTick (host_systick())
+#define SCB     (host_scb())
+
+// ___________________________________ GPIO ___________________________________
+
+#define GPIO_PORT_COUNT 12
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t MODEL;
+    volatile uint32_t MODEH;
+    volatile uint32_t DOUT;
+    volatile uint32_t DOUTTGL;
+    volatile uint32_t DIN;
+} GPIO_P_TypeDef;
+
+typedef struct
+{
+    GPIO_P_TypeDef P[GPIO_PORT_COUNT];
+    volatile uint32_t EXTIPSELL;
+    volatile uint32_t EXTIPSELH;
+    volatile uint32_t EXTIPINSELL;
+    volatile uint32_t EXTIPINSELH;
+    volatile uint32_t EXTIRISE;
+    volatile uint32_t EXTIFALL;
+    volatile uint32_t IF;
+    volatile uint32_t IEN;
+    volatile uint32_t INSENSE;
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef host_gpio_regs;
+#define GPIO (&host_gpio_regs)
+
+#define GPIO_INSENSE_INT (1UL << 0)
+#define GPIO_INSENSE_EM4WU (1UL << 1)
+
+// ___________________________________ TIMER __________________________________
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t CCV;
+    volatile uint32_t CCVB;
+} TIMER_CC_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t STATUS;
+    volatile uint32_t CNT;
+    volatile uint32_t TOP;
+    volatile uint32_t TOPB;
+    volatile uint32_t ROUTEPEN;
+    volatile uint32_t ROUTELOC0;
+    TIMER_CC_TypeDef CC[4];
+} TIMER_TypeDef;
+
+#define TIMER_STATUS_RUNNING            (1UL << 0)
+#define TIMER_STATUS_TOPBV              (1UL << 2) // TOPB waits for the overflow
+#define TIMER_STATUS_CCVBV0             (1UL << 8) // CC0 CCVB waits for the overflow, CC1 to CC3 follow
+#define _TIMER_CTRL_PRESC_SHIFT         24
+#define _TIMER_CTRL_PRESC_MASK          (0xFUL << 24)
+#define TIMER_CTRL_DMACLRACT            (1UL << 7)
+#define TIMER_ROUTEPEN_CC0PEN           (1UL << 0)
+#define _TIMER_ROUTELOC0_CC0LOC_MASK    0x3FUL
+#define TIMER_ROUTELOC0_CC0LOC_LOC0     0x0UL
+
+extern TIMER_TypeDef host_timer_regs[2];
+#define TIMER0 (&host_timer_regs[0])
+#define TIMER1 (&host_timer_regs[1])
+
+// ___________________________________ LDMA ___________________________________
+
+#define LDMA_CH_NUM 8
+
+// Addresses the channel moves the next unit from and to, host pointers like the descriptors
+typedef struct
+{
+    volatile uintptr_t SRC;
+    volatile uintptr_t DST;
+} LDMA_CH_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t IF;
+    volatile uint32_t IEN;
+    volatile uint32_t CHEN;
+    volatile uint32_t CHBUSY;
+    volatile uint32_t CHDONE;
+    LDMA_CH_TypeDef CH[LDMA_CH_NUM];
+} LDMA_TypeDef;
+
+extern LDMA_TypeDef host_ldma_regs;
+#define LDMA (&host_ldma_regs)
+
+// __________________________________ USART ___________________________________
+
+typedef struct
+{
+    volatile uint32_t STATUS;
+    volatile uint32_t TXDATA;
+} USART_TypeDef;
+
+#define USART_STATUS_TXC (1UL << 5) // Always set, a byte is out when written
+
+extern USART_TypeDef host_usart_regs;
+#define USART0 (&host_usart_regs)
+
+// ___________________________________ RTCC ___________________________________
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t CCV;
+} RTCC_CC_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t IF;
+    volatile uint32_t IEN;
+    RTCC_CC_TypeDef CC[3];
+} RTCC_TypeDef;
+
+#define RTCC_CTRL_ENABLE (1UL << 0)
+#define RTCC_IF_OF       (1UL << 0)
+#define RTCC_IF_CC0      (1UL << 1)
+#define RTCC_IF_CC1      (1UL << 2)
+#define RTCC_IF_CC2      (1UL << 3)
+
+extern RTCC_TypeDef host_rtcc_regs;
+#define RTCC (&host_rtcc_regs)
+
+#endif//EM_DEVICE_H_
@@ -0,0 +1,17 @@
+/**
+ * @brief Energy modes for the host build. Sleeping waits in host time until
+ * an enabled interrupt is pending or the armed RTCC compare is reached,
+ * which raises the RTCC interrupt, see em.c.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef EM_EMU_H_
+#define EM_EMU_H_
+
+#include "em_device.h"
+
+void EMU_EnterEM1(void);
+void EMU_EnterEM2(bool restore);
+
+#endif//EM_EMU_H_
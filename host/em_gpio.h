@@ -0,0 +1,57 @@
+/**
+ * @brief GPIO for the host build, emlib calls on the register model in em.c.
+ *
+ * Output pins read back what they drive. Input pins read their pull level
+ * until host_gpio_input drives them, which also raises the external
+ * interrupts configured on the pin.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef EM_GPIO_H_
+#define EM_GPIO_H_
+
+#include "em_device.h"
+
+typedef enum
+{
+    gpioPortA = 0,
+    gpioPortB = 1,
+    gpioPortC = 2,
+    gpioPortD = 3,
+    gpioPortE = 4,
+    gpioPortF = 5,
+    gpioPortI = 8,
+    gpioPortJ = 9,
+    gpioPortK = 10
+} GPIO_Port_TypeDef;
+
+typedef enum
+{
+    gpioModeDisabled,
+    gpioModeInput,
+    gpioModeInputPull,
+    gpioModeInputPullFilter,
+    gpioModePushPull,
+    gpioModeWiredAnd
+} GPIO_Mode_TypeDef;
+
+void GPIO_PinModeSet(GPIO_Port_TypeDef port, unsigned int pin, GPIO_Mode_TypeDef mode, unsigned int out);
+void GPIO_PinOutSet(GPIO_Port_TypeDef port, unsigned int pin);
+void GPIO_PinOutClear(GPIO_Port_TypeDef port, unsigned int pin);
+void GPIO_PinOutToggle(GPIO_Port_TypeDef port, unsigned int pin);
+unsigned int GPIO_PinOutGet(GPIO_Port_TypeDef port, unsigned int pin);
+unsigned int GPIO_PinInGet(GPIO_Port_TypeDef port, unsigned int pin);
+
+void GPIO_ExtIntConfig(GPIO_Port_TypeDef port, unsigned int pin, unsigned int intNo,
+                       bool risingEdge, bool fallingEdge, bool enable);
+void GPIO_InputSenseSet(uint32_t val, uint32_t mask);
+
+void GPIO_IntEnable(uint32_t flags);
+void GPIO_IntDisable(uint32_t flags);
+void GPIO_IntClear(uint32_t flags);
+void GPIO_IntSet(uint32_t flags);
+uint32_t GPIO_IntGet(void);
+uint32_t GPIO_IntGetEnabled(void);
+
+#endif//EM_GPIO_H_
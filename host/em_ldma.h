@@ -0,0 +1,109 @@
+/**
+ * @brief LDMA for the host build, the descriptor walker in em.c.
+ *
+ * Descriptors keep the emlib field names but hold host pointers. Each
+ * peripheral request moves one unit, a descriptor that ends with doneIfs
+ * set raises LDMA_IRQn. Writes to a DOUTTGL register toggle the pins.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef EM_LDMA_H_
+#define EM_LDMA_H_
+
+#include <stdint.h>
+
+#include "em_device.h"
+
+typedef enum
+{
+    ldmaPeripheralSignal_NONE,
+    ldmaPeripheralSignal_TIMER0_UFOF,
+    ldmaPeripheralSignal_TIMER1_UFOF,
+    ldmaPeripheralSignal_USART0_TXBL
+} LDMA_PeripheralSignal_t;
+
+enum
+{
+    ldmaCtrlSizeByte,
+    ldmaCtrlSizeHalf,
+    ldmaCtrlSizeWord
+};
+
+enum
+{
+    ldmaCtrlSrcIncOne,
+    ldmaCtrlSrcIncTwo,
+    ldmaCtrlSrcIncFour,
+    ldmaCtrlSrcIncNone
+};
+
+enum
+{
+    ldmaCtrlDstIncOne,
+    ldmaCtrlDstIncTwo,
+    ldmaCtrlDstIncFour,
+    ldmaCtrlDstIncNone
+};
+
+enum
+{
+    ldmaLinkModeAbs,
+    ldmaLinkModeRel
+};
+
+typedef union
+{
+    struct
+    {
+        uint32_t xferCnt;
+        uint8_t doneIfs;
+        uint8_t srcInc;
+        uint8_t size;
+        uint8_t dstInc;
+        uintptr_t srcAddr;
+        uintptr_t dstAddr;
+        uint8_t linkMode;
+        uint8_t link;
+        int32_t linkAddr; // Relative links count words, 4 per descriptor
+    } xfer;
+} LDMA_Descriptor_t;
+
+typedef struct
+{
+    LDMA_PeripheralSignal_t ldmaReqSel;
+} LDMA_TransferCfg_t;
+
+typedef struct
+{
+    uint8_t ldmaInitIrqPriority;
+} LDMA_Init_t;
+
+#define LDMA_INIT_DEFAULT {.ldmaInitIrqPriority = 3}
+
+#define LDMA_TRANSFER_CFG_PERIPHERAL(signal) {.ldmaReqSel = (signal)}
+
+#define LDMA_DESCRIPTOR_SINGLE_M2P_BYTE(src, dest, count)                                     \
+    {.xfer = {.xferCnt = (count) - 1, .doneIfs = 1, .srcInc = ldmaCtrlSrcIncOne,              \
+              .size = ldmaCtrlSizeByte, .dstInc = ldmaCtrlDstIncNone,                         \
+              .srcAddr = (uintptr_t)(src), .dstAddr = (uintptr_t)(dest),                      \
+              .linkMode = ldmaLinkModeAbs, .link = 0, .linkAddr = 0}}
+
+#define LDMA_DESCRIPTOR_LINKREL_M2P_BYTE(src, dest, count, linkjmp)                           \
+    {.xfer = {.xferCnt = (count) - 1, .doneIfs = 1, .srcInc = ldmaCtrlSrcIncOne,              \
+              .size = ldmaCtrlSizeByte, .dstInc = ldmaCtrlDstIncNone,                         \
+              .srcAddr = (uintptr_t)(src), .dstAddr = (uintptr_t)(dest),                      \
+              .linkMode = ldmaLinkModeRel, .link = 1, .linkAddr = (linkjmp) * 4}}
+
+void LDMA_Init(const LDMA_Init_t *init);
+void LDMA_StartTransfer(int ch, const LDMA_TransferCfg_t *transfer, const LDMA_Descriptor_t *descriptor);
+void LDMA_StopTransfer(int ch);
+bool LDMA_TransferDone(int ch);
+bool LDMA_ChannelEnabled(int ch);
+
+void LDMA_IntEnable(uint32_t flags);
+void LDMA_IntDisable(uint32_t flags);
+void LDMA_IntClear(uint32_t flags);
+uint32_t LDMA_IntGetEnabled(void);
+
+#endif//EM_LDMA_H_
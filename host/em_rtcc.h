@@ -0,0 +1,108 @@
+/**
+ * @brief RTCC for the host build, a 32 bit counter at 32768 Hz on host time
+ * with compare channels, see em.c. Only compare mode is modeled and the
+ * prescaler is ignored.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef EM_RTCC_H_
+#define EM_RTCC_H_
+
+#include "em_device.h"
+
+#define HOST_RTCC_HZ 32768UL
+
+typedef enum
+{
+    rtccCntPresc_1,
+    rtccCntPresc_2,
+    rtccCntPresc_4,
+    rtccCntPresc_8,
+    rtccCntPresc_16,
+    rtccCntPresc_32,
+    rtccCntPresc_64,
+    rtccCntPresc_128,
+    rtccCntPresc_256,
+    rtccCntPresc_512,
+    rtccCntPresc_1024,
+    rtccCntPresc_2048,
+    rtccCntPresc_4096,
+    rtccCntPresc_8192,
+    rtccCntPresc_16384,
+    rtccCntPresc_32768
+} RTCC_CntPresc_TypeDef;
+
+typedef enum
+{
+    rtccCntTickPresc,
+    rtccCntTickCCV0Match
+} RTCC_PrescMode_TypeDef;
+
+typedef enum
+{
+    rtccCntModeNormal,
+    rtccCntModeCalendar
+} RTCC_CntMode_TypeDef;
+
+typedef struct
+{
+    bool enable;
+    bool debugRun;
+    bool precntWrapOnCCV0;
+    bool cntWrapOnCCV1;
+    RTCC_CntPresc_TypeDef presc;
+    RTCC_PrescMode_TypeDef prescMode;
+    bool enaOSCFailDetect;
+    RTCC_CntMode_TypeDef cntMode;
+    bool disLeapYearCorr;
+} RTCC_Init_TypeDef;
+
+#define RTCC_INIT_DEFAULT \
+    {true, false, false, false, rtccCntPresc_32768, rtccCntTickPresc, false, rtccCntModeNormal, false}
+
+typedef enum
+{
+    rtccCapComChModeOff,
+    rtccCapComChModeCapture,
+    rtccCapComChModeCompare
+} RTCC_CapComChMode_TypeDef;
+
+typedef struct
+{
+    RTCC_CapComChMode_TypeDef chMode;
+} RTCC_CCChConf_TypeDef;
+
+#define RTCC_CH_INIT_COMPARE_DEFAULT {rtccCapComChModeCompare}
+
+void RTCC_Init(const RTCC_Init_TypeDef *init);
+void RTCC_Enable(bool enable);
+void RTCC_ChannelInit(int ch, const RTCC_CCChConf_TypeDef *conf);
+uint32_t RTCC_CounterGet(void);
+
+static inline void RTCC_ChannelCCVSet(int ch, uint32_t value)
+{
+    __atomic_store_n(&RTCC->CC[ch].CCV, value, __ATOMIC_RELEASE);
+}
+
+static inline void RTCC_IntEnable(uint32_t flags)
+{
+    __atomic_fetch_or(&RTCC->IEN, flags, __ATOMIC_ACQ_REL);
+}
+
+static inline void RTCC_IntDisable(uint32_t flags)
+{
+    __atomic_fetch_and(&RTCC->IEN, ~flags, __ATOMIC_ACQ_REL);
+}
+
+static inline void RTCC_IntClear(uint32_t flags)
+{
+    __atomic_fetch_and(&RTCC->IF, ~flags, __ATOMIC_ACQ_REL);
+}
+
+static inline uint32_t RTCC_IntGet(void)
+{
+    return __atomic_load_n(&RTCC->IF, __ATOMIC_ACQUIRE);
+}
+
+#endif//EM_RTCC_H_
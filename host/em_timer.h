@@ -0,0 +1,112 @@
+/**
+ * @brief TIMER for the host build. The registers are stored, a running
+ * TIMER1 paces the LDMA requests that select its overflow, see em.c, which
+ * is why the registers it reads are accessed atomically. The buffered TOPB
+ * and CCVB are latched into TOP and CCV at the overflow of a running timer,
+ * as em.c advances the peripherals, like on the device. Compare outputs
+ * are not modeled, a routed PWM does not move the pin.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef EM_TIMER_H_
+#define EM_TIMER_H_
+
+#include "em_device.h"
+
+typedef enum
+{
+    timerPrescale1,
+    timerPrescale2,
+    timerPrescale4,
+    timerPrescale8,
+    timerPrescale16,
+    timerPrescale32,
+    timerPrescale64,
+    timerPrescale128,
+    timerPrescale256,
+    timerPrescale512,
+    timerPrescale1024
+} TIMER_Prescale_TypeDef;
+
+typedef enum
+{
+    timerCCModeOff,
+    timerCCModeCapture,
+    timerCCModeCompare,
+    timerCCModePWM
+} TIMER_CCMode_TypeDef;
+
+typedef struct
+{
+    bool enable;
+    bool debugRun;
+    TIMER_Prescale_TypeDef prescale;
+    bool dmaClrAct;
+    bool oneShot;
+} TIMER_Init_TypeDef;
+
+typedef struct
+{
+    TIMER_CCMode_TypeDef mode;
+    bool outInvert;
+} TIMER_InitCC_TypeDef;
+
+#define TIMER_INIT_DEFAULT   {.enable = true, .debugRun = false, .prescale = timerPrescale1, .dmaClrAct = false, .oneShot = false}
+#define TIMER_INITCC_DEFAULT {.mode = timerCCModeOff, .outInvert = false}
+
+void TIMER_Init(TIMER_TypeDef *timer, const TIMER_Init_TypeDef *init);
+void TIMER_InitCC(TIMER_TypeDef *timer, unsigned int ch, const TIMER_InitCC_TypeDef *init);
+
+static inline void TIMER_Enable(TIMER_TypeDef *timer, bool enable)
+{
+    if (enable)
+    {
+        __atomic_fetch_or(&timer->STATUS, TIMER_STATUS_RUNNING, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        __atomic_fetch_and(&timer->STATUS, ~TIMER_STATUS_RUNNING, __ATOMIC_RELEASE);
+    }
+}
+
+static inline void TIMER_TopSet(TIMER_TypeDef *timer, uint32_t val)
+{
+    __atomic_store_n(&timer->TOP, val, __ATOMIC_RELEASE);
+}
+
+// Latched on the next overflow
+static inline void TIMER_TopBufSet(TIMER_TypeDef *timer, uint32_t val)
+{
+    __atomic_store_n(&timer->TOPB, val, __ATOMIC_RELEASE);
+    __atomic_fetch_or(&timer->STATUS, TIMER_STATUS_TOPBV, __ATOMIC_ACQ_REL);
+}
+
+static inline uint32_t TIMER_TopGet(TIMER_TypeDef *timer)
+{
+    return __atomic_load_n(&timer->TOP, __ATOMIC_ACQUIRE);
+}
+
+static inline void TIMER_CompareSet(TIMER_TypeDef *timer, unsigned int ch, uint32_t val)
+{
+    timer->CC[ch].CCV = val;
+}
+
+// Latched on the next overflow
+static inline void TIMER_CompareBufSet(TIMER_TypeDef *timer, unsigned int ch, uint32_t val)
+{
+    __atomic_store_n(&timer->CC[ch].CCVB, val, __ATOMIC_RELEASE);
+    __atomic_fetch_or(&timer->STATUS, TIMER_STATUS_CCVBV0 << ch, __ATOMIC_ACQ_REL);
+}
+
+static inline void TIMER_CounterSet(TIMER_TypeDef *timer, uint32_t val)
+{
+    timer->CNT = val;
+}
+
+static inline uint32_t TIMER_CounterGet(TIMER_TypeDef *timer)
+{
+    return timer->CNT;
+}
+
+#endif//EM_TIMER_H_
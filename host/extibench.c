@@ -0,0 +1,224 @@
+/**
+ * @brief EXTI benchmark, the cost of one dispatch of exti.c against a
+ * linear scan of the 16 lines for a number of pending lines.
+ *
+ *   esw-gpio-extibench [-n lines] [-d dispatches] [-o report]
+ *
+ * For each count of pending lines, 1 to 16 by default, -d pending masks,
+ * 1000000 by default, with that many lines set at random are dispatched
+ * once by exti_dispatch, which walks the mask with count-leading-zeros,
+ * and once by bench_dispatch_linear, which tests all 16 lines from the
+ * top like the dispatch did before. Every line has a handler that counts
+ * its calls, both must make the same calls. The cycles are counted with
+ * bench.h around the whole run.
+ *
+ * The JSON report has per count of pending lines the mean cycles and
+ * nanoseconds of one dispatch by both. Cycles are those of the host, where
+ * the CLZ is one instruction like on the Cortex-M33, so only the ratios
+ * carry over to the device.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+
+#include "../exti.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_MASKS 1024 // Distinct masks per count, cycled through
+
+typedef struct bench_entry
+{
+    exti_handler_f handler;
+    void *context;
+} bench_entry_t;
+
+typedef struct bench_result
+{
+    uint64_t cycles;
+    uint64_t ns;
+    uint64_t calls;
+} bench_result_t;
+
+static uint32_t m_counts[EXTI_LINES];
+static uint32_t m_count_count;
+static uint32_t m_dispatches = 1000000;
+
+static uint32_t m_masks[BENCH_MASKS];
+static bench_entry_t m_table[EXTI_LINES];
+static uint64_t m_calls;
+
+static uint64_t bench_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void bench_handler(uint8_t line, void *context)
+{
+    m_calls += line + 1;
+}
+
+// The dispatch of exti.c with a scan of every line in place of the CLZ
+__attribute__((noinline)) static void bench_dispatch_linear(uint32_t pending)
+{
+    for (int8_t line = EXTI_LINES - 1; line >= 0; line--)
+    {
+        bench_entry_t *e = &m_table[line];
+
+        if (0 != (pending & (1UL << line)))
+        {
+            e->handler(line, e->context);
+        }
+    }
+}
+
+// Masks of count lines out of the 16, from a fixed seed so runs compare
+static void bench_masks(uint32_t count)
+{
+    uint32_t seed = 0x2022 + count;
+
+    for (uint32_t i = 0; i < BENCH_MASKS; i++)
+    {
+        uint32_t mask = 0;
+
+        while ((uint32_t)__builtin_popcount(mask) < count)
+        {
+            seed = seed * 1664525 + 1013904223;
+            mask |= 1UL << (seed >> 28);
+        }
+        m_masks[i] = mask;
+    }
+}
+
+static void bench_run(void (*dispatch)(uint32_t), bench_result_t *r)
+{
+    uint64_t start;
+    uint64_t cycles;
+
+    // One round first, for the caches and the branch predictor
+    for (uint32_t i = 0; i < BENCH_MASKS; i++)
+    {
+        dispatch(m_masks[i]);
+    }
+
+    m_calls = 0;
+    start = bench_ns();
+    cycles = bench_cycles();
+    for (uint32_t i = 0; i < m_dispatches; i++)
+    {
+        dispatch(m_masks[i % BENCH_MASKS]);
+    }
+    r->cycles = bench_cycles() - cycles;
+    r->ns = bench_ns() - start;
+    r->calls = m_calls;
+}
+
+static bool bench_parse_counts(char *list)
+{
+    m_count_count = 0;
+    for (char *tok = strtok(list, ","); NULL != tok; tok = strtok(NULL, ","))
+    {
+        unsigned long count = strtoul(tok, NULL, 0);
+
+        if ((m_count_count == EXTI_LINES) || (count < 1) || (count > EXTI_LINES))
+        {
+            return false;
+        }
+        m_counts[m_count_count++] = count;
+    }
+    return 0 != m_count_count;
+}
+
+int main(int argc, char *argv[])
+{
+    char default_counts[] = "1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16";
+    const char *path = NULL;
+    FILE *report = stdout;
+    bool ok = true;
+    int opt;
+
+    bench_parse_counts(default_counts);
+
+    while (-1 != (opt = getopt(argc, argv, "n:d:o:h")))
+    {
+        switch (opt)
+        {
+            case 'n':
+                if (!bench_parse_counts(optarg))
+                {
+                    fprintf(stderr, "lines are 1 to %u, at most %u counts\n", EXTI_LINES, EXTI_LINES);
+                    return 1;
+                }
+                break;
+            case 'd':
+                m_dispatches = strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                path = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n lines] [-d dispatches] [-o report]\n", argv[0]);
+                return 'h' == opt ? 0 : 1;
+        }
+    }
+    if (0 == m_dispatches)
+    {
+        fprintf(stderr, "at least one dispatch\n");
+        return 1;
+    }
+
+    if ((NULL != path) && (NULL == (report = fopen(path, "w"))))
+    {
+        perror(path);
+        return 1;
+    }
+
+    for (uint8_t line = 0; line < EXTI_LINES; line++)
+    {
+        exti_register(line, bench_handler, NULL);
+        m_table[line].handler = bench_handler;
+    }
+
+    fprintf(report, "{\"dispatches\": %" PRIu32 ", \"counter\": \"%s\",\n \"runs\": [\n", m_dispatches,
+            BENCH_COUNTER);
+    for (uint32_t i = 0; i < m_count_count; i++)
+    {
+        bench_result_t clz;
+        bench_result_t linear;
+
+        bench_masks(m_counts[i]);
+        bench_run(exti_dispatch, &clz);
+        bench_run(bench_dispatch_linear, &linear);
+        if (clz.calls != linear.calls)
+        {
+            fprintf(stderr, "FAIL %" PRIu32 " lines: the dispatches made different calls\n", m_counts[i]);
+            ok = false;
+        }
+
+        fprintf(report, "    {\"lines\": %" PRIu32 ", \"clz_cycles\": %.2f, \"clz_ns\": %.2f"
+                ", \"linear_cycles\": %.2f, \"linear_ns\": %.2f}%s\n",
+                m_counts[i], (double)clz.cycles / m_dispatches, (double)clz.ns / m_dispatches,
+                (double)linear.cycles / m_dispatches, (double)linear.ns / m_dispatches,
+                (i + 1 == m_count_count) ? "" : ",");
+    }
+    fprintf(report, " ]\n}\n");
+    fclose(report);
+
+    if (0 != exti_spurious())
+    {
+        fprintf(stderr, "FAIL %" PRIu32 " spurious lines\n", exti_spurious());
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
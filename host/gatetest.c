@@ -0,0 +1,180 @@
+/**
+ * @brief Gate test, producer threads of gate.c started and stopped by a
+ * controller thread in virtual time.
+ *
+ *   esw-gpio-gatetest [-v]
+ *
+ * Three producers with periods of 3, 5 and 7 ticks loop the way gate.h
+ * shows, at a priority above the controller, so the ones waiting enter
+ * as soon as a start sets the event flag, before the start is finished.
+ * The controller opens and closes the gate TEST_ROUNDS times, each open
+ * for 8 to 19 ticks and closed for 0 to 9 ticks from a fixed seed, so
+ * some opens come with every producer out and some with producers still
+ * finishing the period they were in.
+ *
+ * A round fails when a producer entered in it is refused a pass while no
+ * close has come since it entered, or passes after the idle action has
+ * run since it entered. At the end the idle action must have run exactly
+ * once per close. -v prints every round. Exits 1 on any failure.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "host.h"
+#include "cmsis_os2.h"
+
+#include "../gate.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define TEST_ROUNDS     200
+#define TEST_PRODUCERS  3
+#define TEST_END_NS     60000000000ULL // Virtual time the rounds must fit in
+
+static const uint32_t TEST_PERIODS[TEST_PRODUCERS] = {3, 5, 7};
+
+typedef struct test_round
+{
+    uint32_t entered;
+    uint32_t passed;
+    uint32_t refused; // Without a close since the enter
+    uint32_t late;    // Passes after the idle action
+} test_round_t;
+
+static gate_t m_gate;
+static test_round_t m_rounds[TEST_ROUNDS];
+static uint32_t m_round; // Of the last open
+static uint32_t m_closes;
+static uint32_t m_idles;
+static bool m_done;
+static bool m_verbose;
+
+static void test_idle(void *user)
+{
+    m_idles++;
+}
+
+static void test_producer(void *argument)
+{
+    uint32_t period = (uint32_t)(uintptr_t)argument;
+
+    for (;;)
+    {
+        uint32_t ticket;
+        uint32_t next = gate_enter(&m_gate, &ticket);
+        test_round_t *r = &m_rounds[m_round];
+        uint32_t closes = m_closes;
+        uint32_t idles = m_idles;
+
+        r->entered++;
+        for (;;)
+        {
+            next += period;
+            osDelayUntil(next);
+            if (!gate_pass(&m_gate, ticket))
+            {
+                r->refused += (closes == m_closes) ? 1 : 0;
+                break;
+            }
+            r->passed++;
+            r->late += (idles == m_idles) ? 0 : 1;
+        }
+    }
+}
+
+static bool test_report(uint32_t round)
+{
+    const test_round_t *r = &m_rounds[round];
+    bool ok = (0 != r->entered) && (0 == r->refused) && (0 == r->late);
+
+    if (!ok || m_verbose)
+    {
+        fprintf(ok ? stdout : stderr,
+                "%s round %" PRIu32 ": %" PRIu32 " entered, %" PRIu32 " passes, %" PRIu32 " refused while open, %"
+                PRIu32 " after idle\n", ok ? "ok" : "FAIL", round, r->entered, r->passed, r->refused, r->late);
+    }
+    return ok;
+}
+
+static void test_controller(void *argument)
+{
+    uint32_t seed = 0x2022;
+    uint32_t failed = 0;
+
+    for (uint32_t round = 0; round < TEST_ROUNDS; round++)
+    {
+        m_round = round;
+        gate_open(&m_gate);
+        seed = seed * 1664525 + 1013904223;
+        osDelay(8 + (seed >> 28) % 12); // Longer than a period, every close is one stop
+        m_closes++;
+        gate_close(&m_gate);
+        seed = seed * 1664525 + 1013904223;
+        osDelay((seed >> 28) % 10);
+    }
+    osDelay(TEST_PERIODS[TEST_PRODUCERS - 1] + 1);
+
+    for (uint32_t round = 0; round < TEST_ROUNDS; round++)
+    {
+        failed += test_report(round) ? 0 : 1;
+    }
+    if (m_idles != m_closes)
+    {
+        fprintf(stderr, "FAIL idle action run %" PRIu32 " times for %" PRIu32 " closes\n", m_idles, m_closes);
+        failed++;
+    }
+
+    printf("gate: %" PRIu32 " of %" PRIu32 " cases failed\n", failed, TEST_ROUNDS + 1);
+    m_done = true;
+    exit((0 == failed) ? 0 : 1);
+}
+
+// The simulation ran out before the controller was done
+static void test_unfinished(void)
+{
+    if (!m_done)
+    {
+        fprintf(stderr, "FAIL ended in round %" PRIu32 " of %u\n", m_round, TEST_ROUNDS);
+        _exit(1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const osThreadAttr_t controller = {.name = "controller", .priority = osPriorityNormal};
+    const osThreadAttr_t producer = {.name = "producer", .priority = osPriorityAboveNormal};
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "vh")))
+    {
+        if ('v' != opt)
+        {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 'h' == opt ? 0 : 1;
+        }
+        m_verbose = true;
+    }
+
+    host_init();
+    host_sim_enable(TEST_END_NS);
+    osKernelInitialize();
+    if (!gate_init(&m_gate, "gate", test_idle, NULL))
+    {
+        fprintf(stderr, "FAIL gate_init\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < TEST_PRODUCERS; i++)
+    {
+        osThreadNew(test_producer, (void *)(uintptr_t)TEST_PERIODS[i], &producer);
+    }
+    osThreadNew(test_controller, NULL, &controller);
+
+    atexit(test_unfinished);
+    osKernelStart();
+    return 1;
+}
@@ -0,0 +1,161 @@
+/**
+ * @brief Gesture recognizer test, the same edges fed on time and in one
+ * late batch must give the same gestures.
+ *
+ *   esw-gpio-gesturetest [-v]
+ *
+ * Each case is a list of press and release times in ms with the timings
+ * of button_timing.h. It is fed once like a thread that keeps up, gesture_timeout
+ * at every deadline before the next edge, and once like button_loop
+ * running late, all edges drained first and gesture_timeout only at the
+ * end. Both must match the expected gestures. -v prints them. Exits 1 on
+ * any mismatch.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../gesture.h"
+#include "../button_timing.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_EDGES_MAX  16
+#define TEST_EVENTS_MAX 16
+#define TEST_END_MS     10000 // Everything is over by then
+
+typedef struct test_edge
+{
+    uint32_t at_ms;
+    bool pressed;
+} test_edge_t;
+
+typedef struct test_case
+{
+    const char *name;
+    test_edge_t edges[TEST_EDGES_MAX];
+    const char *expected; // Gestures as "type:count" words
+} test_case_t;
+
+static const test_case_t TEST_CASES[] = {
+    {"single click", {{100, true}, {200, false}}, "click:1"},
+    {"double click", {{100, true}, {200, false}, {300, true}, {400, false}}, "click:2"},
+    {"triple click at once", {{100, true}, {150, false}, {250, true}, {300, false}, {400, true}, {450, false}},
+     "click:3"},
+    {"press after the click gap", {{100, true}, {200, false}, {200 + ESWGPIO_CLICK_GAP_MS + 50, true},
+     {300 + ESWGPIO_CLICK_GAP_MS + 50, false}}, "click:1 click:1"},
+    {"release after the long press", {{100, true}, {100 + ESWGPIO_LONG_PRESS_MS + 100, false}},
+     "long:1 end:0"},
+    {"hold repeats", {{100, true}, {100 + ESWGPIO_LONG_PRESS_MS + 2 * ESWGPIO_HOLD_REPEAT_MS + 100, false}},
+     "long:1 repeat:1 repeat:2 end:2"},
+    {"click then long press", {{100, true}, {200, false}, {300, true}, {300 + ESWGPIO_LONG_PRESS_MS + 10, false}},
+     "click:1 long:1 end:0"},
+};
+
+static const char * const TEST_NAMES[] = {"click", "long", "repeat", "end"};
+
+static char m_events[TEST_EVENTS_MAX * 12];
+static bool m_verbose;
+
+static void test_gesture(const gesture_event_t *event, void *user)
+{
+    size_t len = strlen(m_events);
+
+    snprintf(&m_events[len], sizeof(m_events) - len, "%s%s:%u", (0 == len) ? "" : " ",
+             TEST_NAMES[event->type], event->count);
+}
+
+static void test_setup(gesture_t *g)
+{
+    const gesture_config_t config = {
+        .click_gap = ESWGPIO_CLICK_GAP_MS,
+        .long_press = ESWGPIO_LONG_PRESS_MS,
+        .repeat = ESWGPIO_HOLD_REPEAT_MS,
+        .max_clicks = ESWGPIO_MAX_CLICKS};
+
+    gesture_init(g, &config);
+    gesture_subscribe(g, test_gesture, NULL, GESTURE_MASK_ALL);
+    m_events[0] = '\0';
+}
+
+// Every deadline before each edge is handled in time, like a thread that keeps up
+static void test_on_time(gesture_t *g, const test_case_t *c)
+{
+    uint32_t now = 0;
+    uint32_t remaining;
+
+    for (uint32_t i = 0; (i < TEST_EDGES_MAX) && (0 != c->edges[i].at_ms); i++)
+    {
+        while (gesture_next_deadline(g, now, &remaining) && (now + remaining < c->edges[i].at_ms))
+        {
+            now += remaining;
+            gesture_timeout(g, now);
+        }
+        now = c->edges[i].at_ms;
+        gesture_edge(g, 0, now, c->edges[i].pressed);
+    }
+    while (gesture_next_deadline(g, now, &remaining) && (now + remaining < TEST_END_MS))
+    {
+        now += remaining;
+        gesture_timeout(g, now);
+    }
+}
+
+// All edges drained in one go long after, then the timeout, like a late button_loop
+static void test_late(gesture_t *g, const test_case_t *c)
+{
+    for (uint32_t i = 0; (i < TEST_EDGES_MAX) && (0 != c->edges[i].at_ms); i++)
+    {
+        gesture_edge(g, 0, c->edges[i].at_ms, c->edges[i].pressed);
+    }
+    gesture_timeout(g, TEST_END_MS);
+}
+
+static bool test_check(const test_case_t *c, const char *how)
+{
+    bool ok = (0 == strcmp(m_events, c->expected));
+
+    if (!ok || m_verbose)
+    {
+        fprintf(ok ? stdout : stderr, "%s %s, %s: \"%s\", expected \"%s\"\n",
+                ok ? "ok" : "FAIL", c->name, how, m_events, c->expected);
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t failed = 0;
+    uint32_t count = sizeof(TEST_CASES) / sizeof(TEST_CASES[0]);
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "vh")))
+    {
+        if ('v' != opt)
+        {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 'h' == opt ? 0 : 1;
+        }
+        m_verbose = true;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        gesture_t g;
+
+        test_setup(&g);
+        test_on_time(&g, &TEST_CASES[i]);
+        failed += test_check(&TEST_CASES[i], "on time") ? 0 : 1;
+
+        test_setup(&g);
+        test_late(&g, &TEST_CASES[i]);
+        failed += test_check(&TEST_CASES[i], "drained late") ? 0 : 1;
+    }
+
+    printf("gesture: %" PRIu32 " of %" PRIu32 " runs failed\n", failed, 2 * count);
+    return (0 == failed) ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+/**
+ * @brief Host side of the Linux build, the calls test code and host tools use
+ * to run and stimulate the firmware.
+ *
+ * The firmware main is compiled as firmware_main. A host program calls
+ * host_init, starts whatever drives the inputs in its own pthreads and
+ * then calls firmware_main, which does not return.
+ *
+ * With host_sim_enable the same program runs in virtual time instead, and
+ * the inputs are queued as events up front or from event callbacks.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef HOST_H_
+#define HOST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "em_device.h"
+
+#define HOST_CORE_CLOCK_HZ 38400000UL // HFXO of the tsb0, also the DWT and sys timer rate
+#define HOST_TICK_FREQ     1000UL     // RTOS ticks per second
+
+// Firmware entry point, main() of main.c.
+int firmware_main(void);
+
+// Set up the clock and peripheral models, before anything else.
+void host_init(void);
+
+// Nanoseconds since host_init.
+uint64_t host_now_ns(void);
+
+// Core clock cycles since host_init, what DWT->CYCCNT reads.
+uint32_t host_cycles(void);
+
+// Drive an input pin from outside, raising its external interrupt like the GPIO would.
+void host_gpio_input(uint8_t port, uint8_t pin, uint8_t level);
+
+// Current level of a pin as the GPIO would read it.
+uint8_t host_gpio_level(uint8_t port, uint8_t pin);
+
+// Mark irq pending, its handler runs now unless it is disabled or masked.
+void host_irq(IRQn_Type irq);
+
+typedef struct host_irq_stats
+{
+    uint32_t raised;    // host_irq calls, requests while pending merge
+    uint32_t delivered; // Handler runs
+    uint64_t worst_ns;  // Longest time from the first request to the handler
+} host_irq_stats_t;
+
+// Counters of one interrupt, clear starts them over.
+void host_irq_stats(IRQn_Type irq, host_irq_stats_t *out, bool clear);
+
+// True in a handler started by host_irq.
+bool host_in_isr(void);
+
+// Interrupt masking behind CORE_ENTER_ATOMIC and CORE_EXIT_ATOMIC, nests.
+void host_irq_mask(void);
+void host_irq_unmask(void);
+
+// Run the peripherals (LDMA requests paced by timers and the USART) up to now, false if a
+// simulation stopped short at an interrupt.
+bool host_periph_advance(uint64_t now_ns);
+
+// Start a pthread that calls host_periph_advance every millisecond.
+void host_periph_start(void);
+
+// Context switches so far, every time the CPU is handed to a thread.
+uint32_t host_switch_count(void);
+
+typedef void (*host_flags_f)(const char *name, uint32_t flags);
+
+// Called with the new flags of every event flags change, one observer.
+void host_on_event_flags(host_flags_f func);
+
+typedef void (*host_event_f)(void *arg);
+
+// Run in virtual time until end_ns, UINT64_MAX for as long as anything is pending.
+void host_sim_enable(uint64_t end_ns);
+bool host_sim_enabled(void);
+
+// Virtual time, host_now_ns in a simulation.
+uint64_t host_sim_now(void);
+
+// Move the virtual clock forward to ns, never back.
+void host_sim_set_now(uint64_t ns);
+
+// Call func in interrupt-free context at virtual time at_ns.
+void host_sim_at(uint64_t at_ns, host_event_f func, void *arg);
+
+// host_gpio_input at virtual time at_ns.
+void host_sim_input(uint64_t at_ns, uint8_t port, uint8_t pin, uint8_t level);
+
+// Idle loop step, advance to the earlier of deadline_ns and the next event and run what is due.
+void host_sim_step(uint64_t deadline_ns);
+
+// Write the trace of thread switches, pin changes and interrupts to path.
+bool host_trace_open(const char *path);
+void host_trace_close(void);
+void host_trace(const char *kind, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Write every pin change of the GPIO model to a VCD file at path, completed at exit.
+bool host_vcd_open(const char *path);
+void host_vcd_pin(uint8_t port, uint8_t pin, uint8_t level);
+
+#endif//HOST_H_
@@ -0,0 +1,199 @@
+/**
+ * @brief Linux entry point of the host build, runs the firmware as a process.
+ *
+ *   esw-gpio-host [-s] [-t seconds] [-e stimulus] [-o trace] [-v vcd] [-q]
+ *
+ * -t ends the run after the given time, so perf and the sanitizers get to
+ * report. -e replays a stimulus file on the input pins, one change per line:
+ *
+ *   # ms since start, port and pin, level
+ *   1000 F4 0
+ *   1120 F4 1
+ *
+ * -s runs in virtual time, as fast as the host allows and the same way every
+ * time, see sim.c. -t is then firmware time, without it the run ends when
+ * nothing but the peripherals has anything left to do. -o writes the trace
+ * of thread switches, pin changes and interrupts, see trace.c, -v a VCD of
+ * the pins for a waveform viewer or tools/vcdstats.py, see vcd.c, and -q
+ * drops the firmware output.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "host.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HOST_STIMULUS_MAX 4096
+
+typedef struct host_stimulus
+{
+    uint64_t at_ns;
+    uint8_t port;
+    uint8_t pin;
+    uint8_t level;
+} host_stimulus_t;
+
+static host_stimulus_t m_stimulus[HOST_STIMULUS_MAX];
+static uint32_t m_stimulus_count;
+static uint32_t m_run_seconds;
+static bool m_simulate;
+
+static void host_sleep_until(uint64_t at_ns)
+{
+    uint64_t now = host_now_ns();
+
+    if (at_ns > now)
+    {
+        struct timespec wait = {.tv_sec = (at_ns - now) / 1000000000ULL,
+                                .tv_nsec = (at_ns - now) % 1000000000ULL};
+        nanosleep(&wait, NULL);
+    }
+}
+
+static int host_load_stimulus(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    char line[128];
+    unsigned lineno = 0;
+
+    if (NULL == f)
+    {
+        perror(path);
+        return -1;
+    }
+
+    while (NULL != fgets(line, sizeof(line), f))
+    {
+        unsigned long ms;
+        char port;
+        unsigned pin;
+        unsigned level;
+
+        lineno++;
+        if (('#' == line[0]) || ('\n' == line[0]))
+        {
+            continue;
+        }
+        if ((4 != sscanf(line, "%lu %c%u %u", &ms, &port, &pin, &level))
+            || (port < 'A') || (port > 'K') || (pin > 15) || (level > 1))
+        {
+            fprintf(stderr, "%s:%u: expected <ms> <port><pin> <0|1>\n", path, lineno);
+            fclose(f);
+            return -1;
+        }
+        if (m_stimulus_count >= HOST_STIMULUS_MAX)
+        {
+            fprintf(stderr, "%s:%u: more than %u changes\n", path, lineno, HOST_STIMULUS_MAX);
+            fclose(f);
+            return -1;
+        }
+        m_stimulus[m_stimulus_count++] = (host_stimulus_t){
+            .at_ns = ms * 1000000ULL, .port = port - 'A', .pin = pin, .level = level};
+    }
+    fclose(f);
+    return 0;
+}
+
+static void *host_stimulus_main(void *argument)
+{
+    for (uint32_t i = 0; i < m_stimulus_count; i++)
+    {
+        host_sleep_until(m_stimulus[i].at_ns);
+        host_gpio_input(m_stimulus[i].port, m_stimulus[i].pin, m_stimulus[i].level);
+    }
+    return NULL;
+}
+
+static void *host_timeout_main(void *argument)
+{
+    host_sleep_until(m_run_seconds * 1000000000ULL);
+    fflush(stdout);
+    exit(0);
+    return NULL;
+}
+
+static void host_start(void *(*func)(void *))
+{
+    pthread_t thread;
+
+    pthread_create(&thread, NULL, func, NULL);
+    pthread_detach(thread);
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+
+    host_init();
+
+    while (-1 != (opt = getopt(argc, argv, "st:e:o:v:qh")))
+    {
+        switch (opt)
+        {
+            case 's':
+                m_simulate = true;
+                break;
+            case 't':
+                m_run_seconds = strtoul(optarg, NULL, 0);
+                break;
+            case 'e':
+                if (0 != host_load_stimulus(optarg))
+                {
+                    return 1;
+                }
+                break;
+            case 'o':
+                if (!host_trace_open(optarg))
+                {
+                    return 1;
+                }
+                break;
+            case 'v':
+                if (!host_vcd_open(optarg))
+                {
+                    return 1;
+                }
+                break;
+            case 'q':
+                if (NULL == freopen("/dev/null", "w", stdout))
+                {
+                    perror("/dev/null");
+                    return 1;
+                }
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-s] [-t seconds] [-e stimulus] [-o trace] [-v vcd] [-q]\n", argv[0]);
+                return 'h' == opt ? 0 : 1;
+        }
+    }
+
+    if (m_simulate)
+    {
+        // Everything is queued up front, no pthread drives the firmware
+        host_sim_enable((0 != m_run_seconds) ? m_run_seconds * 1000000000ULL : UINT64_MAX);
+        for (uint32_t i = 0; i < m_stimulus_count; i++)
+        {
+            host_sim_input(m_stimulus[i].at_ns, m_stimulus[i].port, m_stimulus[i].pin, m_stimulus[i].level);
+        }
+        return firmware_main();
+    }
+
+    host_periph_start();
+    if (0 != m_stimulus_count)
+    {
+        host_start(host_stimulus_main);
+    }
+    if (0 != m_run_seconds)
+    {
+        host_start(host_timeout_main);
+    }
+
+    return firmware_main();
+}
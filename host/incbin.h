@@ -0,0 +1,30 @@
+/**
+ * @brief INCBIN for the host build, the same gNameData, gNameEnd and
+ * gNameSize symbols as graphitemaster/incbin, with the files found through
+ * the assembler include path.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef INCBIN_H_
+#define INCBIN_H_
+
+#define INCBIN(NAME, FILE)                                                                    \
+    __asm__(".section .rodata\n"                                                              \
+            ".global g" #NAME "Data\n"                                                        \
+            ".balign 16\n"                                                                    \
+            "g" #NAME "Data:\n"                                                               \
+            ".incbin \"" FILE "\"\n"                                                          \
+            ".global g" #NAME "End\n"                                                         \
+            "g" #NAME "End:\n"                                                                \
+            ".byte 0\n"                                                                       \
+            ".balign 4\n"                                                                     \
+            ".global g" #NAME "Size\n"                                                        \
+            "g" #NAME "Size:\n"                                                               \
+            ".int g" #NAME "End - g" #NAME "Data\n"                                           \
+            ".previous\n");                                                                   \
+    extern const unsigned char g##NAME##Data[];                                               \
+    extern const unsigned char g##NAME##End[];                                                \
+    extern const unsigned int g##NAME##Size
+
+#endif//INCBIN_H_
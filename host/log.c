@@ -0,0 +1,71 @@
+/**
+ * @brief lll logging for the host build, see log.h.
+ *
+ * Lines are formatted like lll prints them, time, level letter, module and
+ * line, then the message.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "log.h"
+#include "cmsis_os2.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#define LOG_LINE_MAX 256
+
+static uint16_t m_flags;
+static log_output_f m_output;
+static log_time_f m_time;
+
+int log_init(uint16_t flags, log_output_f output, log_time_f time)
+{
+    m_flags = flags;
+    m_output = output;
+    m_time = time;
+    return 0;
+}
+
+static char log_letter(uint16_t level)
+{
+    if (level >= LOG_ERR1)
+    {
+        return 'E';
+    }
+    if (level >= LOG_WARN1)
+    {
+        return 'W';
+    }
+    return (level >= LOG_INFO1) ? 'I' : 'D';
+}
+
+void log_line(uint16_t level, const char *module, int line, const char *fmt, ...)
+{
+    char buf[LOG_LINE_MAX];
+    uint32_t ms;
+    int len;
+    va_list args;
+
+    if ((NULL == m_output) || (0 == (m_flags & level)))
+    {
+        return;
+    }
+
+    ms = (NULL != m_time) ? m_time() : osKernelGetTickCount() * 1000 / osKernelGetTickFreq();
+    len = snprintf(buf, sizeof(buf), "%02u:%02u:%02u.%03u %c|%4s:%4d|",
+                   (unsigned)(ms / 3600000 % 100), (unsigned)(ms / 60000 % 60),
+                   (unsigned)(ms / 1000 % 60), (unsigned)(ms % 1000), log_letter(level), module, line);
+
+    va_start(args, fmt);
+    len += vsnprintf(&buf[len], sizeof(buf) - len - 1, fmt, args);
+    va_end(args);
+
+    if (len > (int)sizeof(buf) - 2)
+    {
+        len = sizeof(buf) - 2;
+    }
+    buf[len++] = '\n';
+    buf[len] = '\0';
+    m_output(buf, len);
+}
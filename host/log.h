@@ -0,0 +1,37 @@
+/**
+ * @brief lll logging macros for the host build, implemented by host/log.c.
+ *
+ * Like lll, a file defines __MODUUL__ and __LOG_LEVEL__ before including
+ * this header. A level bit that is clear in __LOG_LEVEL__ compiles its
+ * calls out, the mask given to log_init filters the rest at runtime.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef LOG_H_
+#define LOG_H_
+
+#include "loggers_ext.h"
+
+#define LOG_DEBUG1 0x0001
+#define LOG_INFO1  0x0010
+#define LOG_WARN1  0x0100
+#define LOG_ERR1   0x1000
+
+#define LOG_LEVEL_DEBUG 0xFFFF
+#define LOG_LEVEL_INFO  0xFFF0
+#define LOG_LEVEL_WARN  0xFF00
+#define LOG_LEVEL_ERROR 0xF000
+#define LOG_LEVEL_NONE  0x0000
+
+void log_line(uint16_t level, const char *module, int line, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+#define __LOG_LINE(lvl, fmt, ...) do { if ((__LOG_LEVEL__) & (lvl)) { log_line(lvl, __MODUUL__, __LINE__, fmt, ##__VA_ARGS__); } } while (0)
+
+#define debug1(fmt, ...) __LOG_LINE(LOG_DEBUG1, fmt, ##__VA_ARGS__)
+#define info1(fmt, ...)  __LOG_LINE(LOG_INFO1, fmt, ##__VA_ARGS__)
+#define warn1(fmt, ...)  __LOG_LINE(LOG_WARN1, fmt, ##__VA_ARGS__)
+#define err1(fmt, ...)   __LOG_LINE(LOG_ERR1, fmt, ##__VA_ARGS__)
+
+#endif//LOG_H_
@@ -0,0 +1,18 @@
+/**
+ * @brief lll logger setup for the host build, see host/log.c.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef LOGGERS_EXT_H_
+#define LOGGERS_EXT_H_
+
+#include <stdint.h>
+
+typedef int (*log_output_f)(const char *ptr, int len);
+typedef uint32_t (*log_time_f)(void);
+
+// Send lines enabled in flags to output, time stamps from time or the RTOS tick.
+int log_init(uint16_t flags, log_output_f output, log_time_f time);
+
+#endif//LOGGERS_EXT_H_
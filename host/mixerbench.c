@@ -0,0 +1,178 @@
+/**
+ * @brief Mixer benchmark, the cost of rendering one output sample of
+ * mixer.c for a number of voices.
+ *
+ *   esw-gpio-mixerbench [-n voices] [-s seconds] [-o report]
+ *
+ * For each voice count, 2,8,32 by default, the voices are added at
+ * BENCH_PITCHES and -s seconds of output, 60 by default, are rendered as
+ * toggle words in blocks of the playback buffer length at the sample rate
+ * of main.c, like the LDMA refill does. The cycles of every block are
+ * counted with bench.h.
+ *
+ * The JSON report has per voice count the samples, the toggle words that
+ * flip the pin, the mean cycles and nanoseconds per sample and the cycles
+ * of the slowest block, which bounds the refill interrupt but also
+ * catches any preemption of the host. Cycles are those of the host, so
+ * only the ratios between voice counts carry over to the device.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+
+#include "../mixer.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_COUNTS_MAX 8
+#define BENCH_RATE       8000 // ESWGPIO_MIXER_RATE of main.c, Hz
+#define BENCH_BLOCK      256  // ESWGPIO_PLAYBACK_BLOCK of main.c, samples
+
+// Voice pitches, two octaves of the A major pentatonic scale from A2, mHz
+static const uint32_t BENCH_PITCHES[] = {110000, 123471, 138591, 164814, 184997,
+                                         220000, 246942, 277183, 329628, 369994};
+
+typedef struct bench_result
+{
+    uint64_t samples;
+    uint64_t toggles;
+    uint64_t cycles;
+    uint64_t worst; // Cycles of the slowest block
+    uint64_t ns;
+} bench_result_t;
+
+static uint32_t m_counts[BENCH_COUNTS_MAX];
+static uint32_t m_count_count;
+static uint32_t m_seconds = 60;
+
+static mixer_t m_mixer;
+static uint32_t m_block[BENCH_BLOCK];
+
+static uint64_t bench_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void bench_run(uint32_t voices, bench_result_t *r)
+{
+    uint32_t blocks = m_seconds * BENCH_RATE / BENCH_BLOCK;
+    uint64_t start;
+
+    mixer_init(&m_mixer);
+    for (uint32_t i = 0; i < voices; i++)
+    {
+        uint32_t pitch = BENCH_PITCHES[i % (sizeof(BENCH_PITCHES) / sizeof(BENCH_PITCHES[0]))];
+
+        // Octaves up every time the scale repeats, 32 voices reach A6
+        mixer_add_voice(&m_mixer, mixer_half_period(BENCH_RATE, pitch << (i / 10)));
+    }
+
+    // One block first, for the caches
+    mixer_render_toggles(&m_mixer, m_block, BENCH_BLOCK);
+
+    memset(r, 0, sizeof(*r));
+    start = bench_ns();
+    for (uint32_t b = 0; b < blocks; b++)
+    {
+        uint64_t cycles = bench_cycles();
+
+        mixer_render_toggles(&m_mixer, m_block, BENCH_BLOCK);
+        cycles = bench_cycles() - cycles;
+
+        r->cycles += cycles;
+        r->worst = (cycles > r->worst) ? cycles : r->worst;
+        for (uint32_t i = 0; i < BENCH_BLOCK; i++)
+        {
+            r->toggles += (0 != m_block[i]) ? 1 : 0;
+        }
+    }
+    r->ns = bench_ns() - start;
+    r->samples = (uint64_t)blocks * BENCH_BLOCK;
+}
+
+static bool bench_parse_counts(char *list)
+{
+    m_count_count = 0;
+    for (char *tok = strtok(list, ","); NULL != tok; tok = strtok(NULL, ","))
+    {
+        unsigned long count = strtoul(tok, NULL, 0);
+
+        if ((m_count_count == BENCH_COUNTS_MAX) || (count < 1) || (count > MIXER_MAX_VOICES))
+        {
+            return false;
+        }
+        m_counts[m_count_count++] = count;
+    }
+    return 0 != m_count_count;
+}
+
+int main(int argc, char *argv[])
+{
+    char default_counts[] = "2,8,32";
+    const char *path = NULL;
+    FILE *report = stdout;
+    int opt;
+
+    bench_parse_counts(default_counts);
+
+    while (-1 != (opt = getopt(argc, argv, "n:s:o:h")))
+    {
+        switch (opt)
+        {
+            case 'n':
+                if (!bench_parse_counts(optarg))
+                {
+                    fprintf(stderr, "voices are 1 to %u, at most %u counts\n", MIXER_MAX_VOICES, BENCH_COUNTS_MAX);
+                    return 1;
+                }
+                break;
+            case 's':
+                m_seconds = strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                path = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n voices] [-s seconds] [-o report]\n", argv[0]);
+                return 'h' == opt ? 0 : 1;
+        }
+    }
+    if (m_seconds * BENCH_RATE < BENCH_BLOCK)
+    {
+        fprintf(stderr, "at least one block, %u samples\n", BENCH_BLOCK);
+        return 1;
+    }
+
+    if ((NULL != path) && (NULL == (report = fopen(path, "w"))))
+    {
+        perror(path);
+        return 1;
+    }
+
+    fprintf(report, "{\"seconds\": %" PRIu32 ", \"rate\": %u, \"block\": %u, \"counter\": \"%s\",\n \"runs\": [\n",
+            m_seconds, BENCH_RATE, BENCH_BLOCK, BENCH_COUNTER);
+    for (uint32_t i = 0; i < m_count_count; i++)
+    {
+        bench_result_t r;
+
+        bench_run(m_counts[i], &r);
+        fprintf(report, "    {\"voices\": %" PRIu32 ", \"samples\": %" PRIu64 ", \"toggles\": %" PRIu64
+                ", \"cycles_per_sample\": %.2f, \"ns_per_sample\": %.2f, \"worst_block_cycles\": %" PRIu64 "}%s\n",
+                m_counts[i], r.samples, r.toggles, (double)r.cycles / r.samples, (double)r.ns / r.samples, r.worst,
+                (i + 1 == m_count_count) ? "" : ",");
+    }
+    fprintf(report, " ]\n}\n");
+    fclose(report);
+    return 0;
+}
@@ -0,0 +1,1345 @@
+/**
+ * @brief CMSIS-RTOS2 on POSIX threads for the host build.
+ *
+ * Every RTOS thread is a pthread, but only the one holding the CPU
+ * (m_current) runs firmware code. The CPU is handed on when the running
+ * thread blocks in an os* call, to the highest priority ready thread and
+ * first come first served within a priority. A thread readied at a higher
+ * priority than the running one takes over at the running thread's next
+ * os* call, thread code is never preempted halfway. Interrupts are the
+ * exception, they run whenever injected, see em.c.
+ *
+ * When no thread is ready, the caller of osKernelStart idles until the
+ * next timeout or until an interrupt readies a thread. osTimer callbacks
+ * run in a timer service thread at osPriorityRealtime7, like the FreeRTOS
+ * timer task. In a simulation the idle loop moves the virtual clock
+ * instead of waiting, see sim.c.
+ *
+ * If the firmware has a vPortSuppressTicksAndSleep, for
+ * configUSE_TICKLESS_IDLE 2, the idle loop calls it for idle times of
+ * HOST_IDLE_SLEEP_MIN ticks and more. The sleep itself, EMU_EnterEM1 or
+ * EMU_EnterEM2 masked, ends in host_cpu_sleep.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _GNU_SOURCE // pthread_getattr_np
+
+#include "cmsis_os2.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "host.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HOST_TICK_NS  (1000000000ULL / HOST_TICK_FREQ)
+#define HOST_FOREVER  UINT64_MAX
+
+#define HOST_STACK_PAINT 0xA5      // Fill byte of unused stack, tskSTACK_FILL_BYTE
+#define HOST_STACK_WATCH (64 * 1024) // Painted part of a pthread stack, bytes
+
+#define HOST_IDLE_SLEEP_MIN 2 // configEXPECTED_IDLE_TIME_BEFORE_SLEEP
+
+enum
+{
+    HOST_READY,
+    HOST_BLOCKED,
+    HOST_TERMINATED
+};
+
+typedef struct host_thread
+{
+    pthread_t pthread;
+    pthread_cond_t wake;
+    osThreadFunc_t func;
+    void *argument;
+    const char *name;
+    osPriority_t priority;
+    uint8_t state;
+    bool suspended;
+    uint32_t flags;
+    uint32_t waiting;   // Flags that end the current wait, 0 in a delay
+    void *wait_on;      // Event flags or mutex of the current wait, NULL for the thread flags
+    uint64_t deadline;  // Tick the current wait times out on
+    uint64_t ready_seq; // Order of becoming ready, within a priority
+    uint32_t run_time;  // host_cycles holding the CPU
+    void *stack_mem;    // Firmware stack, only reported
+    uint32_t stack_size;
+    uint8_t *stack_top;   // Where the pthread stack starts, it grows down
+    uint8_t *paint_low;   // Painted below the first frame, down to here
+    uint32_t number;
+    struct host_thread *next;
+} host_thread_t;
+
+_Static_assert(sizeof(StaticTask_t) >= sizeof(host_thread_t), "StaticTask_t holds a thread record");
+
+typedef struct host_timer
+{
+    osTimerFunc_t func;
+    void *argument;
+    const char *name;
+    osTimerType_t type;
+    bool running;
+    uint32_t period;
+    uint64_t deadline;
+    bool cb_static; // In the cb_mem of the caller, not freed on delete
+    struct host_timer *next;
+} host_timer_t;
+
+_Static_assert(sizeof(StaticTimer_t) >= sizeof(host_timer_t), "StaticTimer_t holds a timer record");
+
+typedef struct host_event_flags
+{
+    const char *name;
+    uint32_t flags;
+    bool cb_static;
+} host_event_flags_t;
+
+_Static_assert(sizeof(StaticEventGroup_t) >= sizeof(host_event_flags_t), "StaticEventGroup_t holds an event flags record");
+
+typedef struct host_mutex
+{
+    const char *name;
+    struct host_thread *owner;
+    bool cb_static;
+} host_mutex_t;
+
+_Static_assert(sizeof(StaticSemaphore_t) >= sizeof(host_mutex_t), "StaticSemaphore_t holds a mutex record");
+
+static pthread_mutex_t m_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t m_idle;
+static struct timespec m_epoch;
+
+static osKernelState_t m_state = osKernelInactive;
+static host_thread_t *m_threads;
+static host_thread_t *m_current;
+static uint64_t m_ready_seq;
+
+static uint32_t m_switched; // host_cycles of the last switch
+static uint32_t m_idle_time;
+static uint32_t m_switches;
+static uint32_t m_thread_count;
+
+static host_timer_t *m_timers;
+static host_thread_t *m_timer_service;
+static StaticTask_t m_timer_service_cb; // Static like the FreeRTOS timer task
+
+static __thread host_thread_t *m_self;
+
+static host_flags_f m_on_flags;
+
+void host_em_init(void);
+
+// Weak, the firmware may leave it out
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime) __attribute__((weak));
+
+void host_init(void)
+{
+    pthread_condattr_t attr;
+
+    clock_gettime(CLOCK_MONOTONIC, &m_epoch);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&m_idle, &attr);
+    pthread_condattr_destroy(&attr);
+
+    host_em_init();
+}
+
+uint64_t host_now_ns(void)
+{
+    struct timespec now;
+
+    if (host_sim_enabled())
+    {
+        return host_sim_now();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - m_epoch.tv_sec) * 1000000000ULL + now.tv_nsec - m_epoch.tv_nsec;
+}
+
+void host_on_event_flags(host_flags_f func)
+{
+    m_on_flags = func;
+}
+
+uint32_t host_switch_count(void)
+{
+    return __atomic_load_n(&m_switches, __ATOMIC_RELAXED);
+}
+
+uint32_t host_cycles(void)
+{
+    // 38.4 cycles per microsecond
+    return (uint32_t)(host_now_ns() * 48 / 1250);
+}
+
+static uint64_t host_ticks(void)
+{
+    return host_now_ns() / HOST_TICK_NS;
+}
+
+// Everything below runs with m_lock held unless noted.
+
+static void host_ready(host_thread_t *t)
+{
+    if (HOST_BLOCKED == t->state)
+    {
+        t->state = HOST_READY;
+        t->ready_seq = m_ready_seq++;
+    }
+    if (NULL == m_current)
+    {
+        pthread_cond_signal(&m_idle);
+    }
+}
+
+static host_thread_t *host_pick(void)
+{
+    uint64_t now = host_ticks();
+    host_thread_t *best = NULL;
+
+    for (host_thread_t *t = m_threads; NULL != t; t = t->next)
+    {
+        if ((HOST_BLOCKED == t->state) && (t->deadline <= now))
+        {
+            host_ready(t);
+        }
+        if ((HOST_READY == t->state) && !t->suspended)
+        {
+            if ((NULL == best) || (t->priority > best->priority)
+                || ((t->priority == best->priority) && (t->ready_seq < best->ready_seq)))
+            {
+                best = t;
+            }
+        }
+    }
+    return best;
+}
+
+static uint64_t host_next_deadline(void)
+{
+    uint64_t next = HOST_FOREVER;
+
+    for (host_thread_t *t = m_threads; NULL != t; t = t->next)
+    {
+        if ((HOST_BLOCKED == t->state) && (t->deadline < next))
+        {
+            next = t->deadline;
+        }
+    }
+    return next;
+}
+
+// Give the CPU to the best ready thread, the idle loop if there is none.
+static void host_pass(host_thread_t *next)
+{
+    uint32_t now = host_cycles();
+
+    // Run time stats like configGENERATE_RUN_TIME_STATS, on the cycle counter
+    if (NULL != m_current)
+    {
+        m_current->run_time += now - m_switched;
+    }
+    else
+    {
+        m_idle_time += now - m_switched;
+    }
+    m_switched = now;
+
+    m_current = next;
+    __atomic_fetch_add(&m_switches, (NULL != next) ? 1 : 0, __ATOMIC_RELAXED);
+    host_trace("run", "%s", (NULL == next) ? "idle" : (NULL != next->name) ? next->name : "?");
+    pthread_cond_signal((NULL != next) ? &next->wake : &m_idle);
+}
+
+// Hand over the CPU if someone else should run and wait to get it back.
+static void host_switch(host_thread_t *self)
+{
+    host_thread_t *next = host_pick();
+
+    if (next != self)
+    {
+        host_pass(next);
+        while (m_current != self)
+        {
+            pthread_cond_wait(&self->wake, &m_lock);
+        }
+    }
+}
+
+// Block the running thread until readied or until tick deadline.
+static void host_block(host_thread_t *self, uint32_t waiting, uint64_t deadline)
+{
+    self->state = HOST_BLOCKED;
+    self->waiting = waiting;
+    self->deadline = deadline;
+    host_switch(self);
+    self->waiting = 0;
+    self->wait_on = NULL;
+}
+
+// Give way to a higher priority thread that the caller has readied.
+static void host_preempt(void)
+{
+    host_thread_t *self = m_self;
+
+    if ((NULL != self) && (self == m_current) && !host_in_isr())
+    {
+        host_thread_t *best = host_pick();
+
+        if ((NULL != best) && (best->priority > self->priority))
+        {
+            host_switch(self);
+        }
+    }
+}
+
+// Paint the stack below this frame for the high water mark, like FreeRTOS fills a new stack.
+static void host_stack_paint(host_thread_t *self)
+{
+    pthread_attr_t attr;
+    void *low;
+    size_t size;
+    uint8_t *here = __builtin_frame_address(0);
+
+    pthread_getattr_np(pthread_self(), &attr);
+    pthread_attr_getstack(&attr, &low, &size);
+    pthread_attr_destroy(&attr);
+
+    // Clear of the frames of memset itself
+    uint8_t *top = here - 512;
+    uint8_t *bottom = (top - (uint8_t *)low > HOST_STACK_WATCH) ? top - HOST_STACK_WATCH : (uint8_t *)low;
+
+    memset(bottom, HOST_STACK_PAINT, top - bottom);
+    self->stack_top = (uint8_t *)low + size;
+    self->paint_low = bottom;
+}
+
+// Bytes the thread has used of its stack, the startup frames included.
+static uint32_t host_stack_used(const host_thread_t *t)
+{
+    const uint8_t *p = t->paint_low;
+
+    if (NULL == p)
+    {
+        return 0;
+    }
+    while ((p < t->stack_top) && (HOST_STACK_PAINT == *p))
+    {
+        p++;
+    }
+    return t->stack_top - p;
+}
+
+static void *host_thread_main(void *argument)
+{
+    host_thread_t *self = argument;
+
+    m_self = self;
+
+    pthread_mutex_lock(&m_lock);
+    host_stack_paint(self);
+    while (m_current != self)
+    {
+        pthread_cond_wait(&self->wake, &m_lock);
+    }
+    pthread_mutex_unlock(&m_lock);
+
+    self->func(self->argument);
+
+    pthread_mutex_lock(&m_lock);
+    self->state = HOST_TERMINATED;
+    host_pass(host_pick());
+    pthread_mutex_unlock(&m_lock);
+    return NULL;
+}
+
+// The record goes to cb_mem, to the heap if it is NULL.
+static host_thread_t *host_thread_new(osThreadFunc_t func, void *argument, const char *name, osPriority_t priority,
+                                      void *cb_mem)
+{
+    host_thread_t *t = (NULL != cb_mem) ? memset(cb_mem, 0, sizeof(host_thread_t)) : calloc(1, sizeof(host_thread_t));
+    pthread_attr_t attr;
+
+    if (NULL == t)
+    {
+        return NULL;
+    }
+
+    t->func = func;
+    t->argument = argument;
+    t->name = name;
+    t->priority = priority;
+    t->state = HOST_READY;
+    t->ready_seq = m_ready_seq++;
+    t->number = ++m_thread_count;
+    pthread_cond_init(&t->wake, NULL);
+
+    t->next = m_threads;
+    m_threads = t;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_create(&t->pthread, &attr, host_thread_main, t);
+    pthread_attr_destroy(&attr);
+
+    if (NULL == m_current)
+    {
+        pthread_cond_signal(&m_idle);
+    }
+    return t;
+}
+
+// _________________________________ Timers _________________________________
+
+static void host_timer_loop(void *argument)
+{
+    host_thread_t *self = m_self;
+
+    pthread_mutex_lock(&m_lock);
+    for (;;)
+    {
+        host_timer_t *due = NULL;
+
+        for (host_timer_t *tm = m_timers; NULL != tm; tm = tm->next)
+        {
+            if (tm->running && ((NULL == due) || (tm->deadline < due->deadline)))
+            {
+                due = tm;
+            }
+        }
+
+        if ((NULL != due) && (due->deadline <= host_ticks()))
+        {
+            // Periodic timers keep their phase, late callbacks do not shift it
+            if (osTimerPeriodic == due->type)
+            {
+                due->deadline += due->period;
+            }
+            else
+            {
+                due->running = false;
+            }
+
+            pthread_mutex_unlock(&m_lock);
+            due->func(due->argument);
+            pthread_mutex_lock(&m_lock);
+        }
+        else
+        {
+            host_block(self, 0, (NULL != due) ? due->deadline : HOST_FOREVER);
+        }
+    }
+}
+
+// _________________________________ Kernel _________________________________
+
+osStatus_t osKernelInitialize(void)
+{
+    pthread_mutex_lock(&m_lock);
+    if (osKernelInactive == m_state)
+    {
+        m_state = osKernelReady;
+        m_timer_service = host_thread_new(host_timer_loop, NULL, "Tmr Svc", osPriorityRealtime7, &m_timer_service_cb);
+    }
+    pthread_mutex_unlock(&m_lock);
+    return osOK;
+}
+
+osKernelState_t osKernelGetState(void)
+{
+    return m_state;
+}
+
+osStatus_t osKernelStart(void)
+{
+    pthread_mutex_lock(&m_lock);
+    if (osKernelReady != m_state)
+    {
+        pthread_mutex_unlock(&m_lock);
+        return osError;
+    }
+    m_state = osKernelRunning;
+
+    // The caller becomes the idle loop
+    for (;;)
+    {
+        if (NULL == m_current)
+        {
+            host_thread_t *next = host_pick();
+
+            if (NULL != next)
+            {
+                host_pass(next);
+            }
+        }
+
+        if (NULL != m_current)
+        {
+            pthread_cond_wait(&m_idle, &m_lock);
+        }
+        else
+        {
+            uint64_t deadline = host_next_deadline();
+            uint64_t now = host_ticks();
+
+            if ((NULL != vPortSuppressTicksAndSleep)
+                && ((HOST_FOREVER == deadline) || (deadline >= now + HOST_IDLE_SLEEP_MIN)))
+            {
+                uint64_t expected = (HOST_FOREVER == deadline) ? portMAX_DELAY : deadline - now;
+
+                // Masks the interrupts, which take m_lock
+                pthread_mutex_unlock(&m_lock);
+                vPortSuppressTicksAndSleep((expected < portMAX_DELAY) ? (TickType_t)expected : portMAX_DELAY);
+                pthread_mutex_lock(&m_lock);
+            }
+            else if (host_sim_enabled())
+            {
+                // Handlers run from here may take m_lock
+                pthread_mutex_unlock(&m_lock);
+                host_sim_step((HOST_FOREVER == deadline) ? UINT64_MAX : deadline * HOST_TICK_NS);
+                pthread_mutex_lock(&m_lock);
+            }
+            else if (HOST_FOREVER == deadline)
+            {
+                pthread_cond_wait(&m_idle, &m_lock);
+            }
+            else
+            {
+                uint64_t ns = deadline * HOST_TICK_NS;
+                struct timespec until = {
+                    .tv_sec = m_epoch.tv_sec + (time_t)(ns / 1000000000ULL),
+                    .tv_nsec = m_epoch.tv_nsec + (long)(ns % 1000000000ULL)};
+
+                if (until.tv_nsec >= 1000000000L)
+                {
+                    until.tv_sec++;
+                    until.tv_nsec -= 1000000000L;
+                }
+                pthread_cond_timedwait(&m_idle, &m_lock, &until);
+            }
+        }
+    }
+}
+
+uint32_t osKernelGetTickCount(void)
+{
+    return (uint32_t)host_ticks();
+}
+
+uint32_t osKernelGetTickFreq(void)
+{
+    return HOST_TICK_FREQ;
+}
+
+uint32_t osKernelGetSysTimerCount(void)
+{
+    return host_cycles();
+}
+
+uint32_t osKernelGetSysTimerFreq(void)
+{
+    return HOST_CORE_CLOCK_HZ;
+}
+
+// _________________________________ Sleep __________________________________
+
+eSleepModeStatus eTaskConfirmSleepModeStatus(void)
+{
+    host_thread_t *next;
+
+    pthread_mutex_lock(&m_lock);
+    next = host_pick();
+    pthread_mutex_unlock(&m_lock);
+    return (NULL != next) ? eAbortSleep : eStandardSleep;
+}
+
+void vTaskStepTick(TickType_t xTicksToJump)
+{
+}
+
+// The core of EMU_EnterEM1 and EMU_EnterEM2, unmasked. Waits until a thread is ready
+// or until until_ns, a simulation moves the clock instead.
+void host_cpu_sleep(uint64_t until_ns)
+{
+    pthread_mutex_lock(&m_lock);
+    for (;;)
+    {
+        uint64_t deadline = host_next_deadline();
+
+        if ((NULL != host_pick()) || (host_now_ns() >= until_ns))
+        {
+            break;
+        }
+        if (host_sim_enabled())
+        {
+            // Nothing left to wake a thread, a run without end time may finish
+            pthread_mutex_unlock(&m_lock);
+            host_sim_step((HOST_FOREVER == deadline) ? UINT64_MAX : until_ns);
+            pthread_mutex_lock(&m_lock);
+        }
+        else if (UINT64_MAX == until_ns)
+        {
+            pthread_cond_wait(&m_idle, &m_lock);
+        }
+        else
+        {
+            struct timespec until = {
+                .tv_sec = m_epoch.tv_sec + (time_t)(until_ns / 1000000000ULL),
+                .tv_nsec = m_epoch.tv_nsec + (long)(until_ns % 1000000000ULL)};
+
+            if (until.tv_nsec >= 1000000000L)
+            {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&m_idle, &m_lock, &until);
+        }
+    }
+    pthread_mutex_unlock(&m_lock);
+}
+
+// _________________________________ Threads ________________________________
+
+osThreadId_t osThreadNew(osThreadFunc_t func, void *argument, const osThreadAttr_t *attr)
+{
+    host_thread_t *t;
+    osPriority_t priority = osPriorityNormal;
+    const char *name = NULL;
+    void *cb_mem = NULL;
+
+    if ((NULL == func) || host_in_isr())
+    {
+        return NULL;
+    }
+    if (NULL != attr)
+    {
+        name = attr->name;
+        if (osPriorityNone != attr->priority)
+        {
+            priority = attr->priority;
+        }
+
+        // The memory rules of the FreeRTOS wrapper, all static or all from the heap. The
+        // stack is checked but not used, firmware stacks are too small for a pthread.
+        if ((NULL != attr->cb_mem) && (attr->cb_size >= sizeof(StaticTask_t))
+            && (NULL != attr->stack_mem) && (attr->stack_size > 0) && (0 == attr->stack_size % 4))
+        {
+            cb_mem = attr->cb_mem;
+        }
+        else if ((NULL != attr->cb_mem) || (0 != attr->cb_size) || (NULL != attr->stack_mem))
+        {
+            return NULL;
+        }
+    }
+
+    pthread_mutex_lock(&m_lock);
+    t = host_thread_new(func, argument, name, priority, cb_mem);
+    if ((NULL != t) && (NULL != attr))
+    {
+        t->stack_mem = attr->stack_mem;
+        t->stack_size = attr->stack_size;
+    }
+    host_preempt();
+    pthread_mutex_unlock(&m_lock);
+    return t;
+}
+
+const char *osThreadGetName(osThreadId_t thread_id)
+{
+    host_thread_t *t = thread_id;
+
+    return (NULL != t) ? t->name : NULL;
+}
+
+osThreadId_t osThreadGetId(void)
+{
+    return host_in_isr() ? NULL : m_self;
+}
+
+osThreadState_t osThreadGetState(osThreadId_t thread_id)
+{
+    host_thread_t *t = thread_id;
+    osThreadState_t state = osThreadError;
+
+    if (NULL != t)
+    {
+        pthread_mutex_lock(&m_lock);
+        if (HOST_TERMINATED == t->state)
+        {
+            state = osThreadTerminated;
+        }
+        else if (t == m_current)
+        {
+            state = osThreadRunning;
+        }
+        else if ((HOST_READY == t->state) && !t->suspended)
+        {
+            state = osThreadReady;
+        }
+        else
+        {
+            state = osThreadBlocked;
+        }
+        pthread_mutex_unlock(&m_lock);
+    }
+    return state;
+}
+
+osPriority_t osThreadGetPriority(osThreadId_t thread_id)
+{
+    host_thread_t *t = thread_id;
+
+    return (NULL != t) ? t->priority : osPriorityError;
+}
+
+osStatus_t osThreadYield(void)
+{
+    host_thread_t *self = m_self;
+
+    if (host_in_isr())
+    {
+        return osErrorISR;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    self->ready_seq = m_ready_seq++;
+    host_switch(self);
+    pthread_mutex_unlock(&m_lock);
+    return osOK;
+}
+
+osStatus_t osThreadSuspend(osThreadId_t thread_id)
+{
+    host_thread_t *t = thread_id;
+
+    if (host_in_isr())
+    {
+        return osErrorISR;
+    }
+    if ((NULL == t) || (HOST_TERMINATED == t->state))
+    {
+        return osErrorParameter;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    t->suspended = true;
+    if (t == m_self)
+    {
+        host_switch(t);
+    }
+    pthread_mutex_unlock(&m_lock);
+    return osOK;
+}
+
+// A resumed thread finishes the wait it was suspended in, like vTaskResume after osDelay.
+osStatus_t osThreadResume(osThreadId_t thread_id)
+{
+    host_thread_t *t = thread_id;
+    osStatus_t status = osOK;
+
+    if (host_in_isr())
+    {
+        return osErrorISR;
+    }
+    if (NULL == t)
+    {
+        return osErrorParameter;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    if (t->suspended)
+    {
+        t->suspended = false;
+        if (NULL == m_current)
+        {
+            pthread_cond_signal(&m_idle);
+        }
+        host_preempt();
+    }
+    else
+    {
+        status = osErrorResource;
+    }
+    pthread_mutex_unlock(&m_lock);
+    return status;
+}
+
+// ______________________________ Thread flags ______________________________
+
+uint32_t osThreadFlagsSet(osThreadId_t thread_id, uint32_t flags)
+{
+    host_thread_t *t = thread_id;
+    uint32_t result;
+
+    if ((NULL == t) || (flags & osFlagsError))
+    {
+        return osFlagsErrorParameter;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    t->flags |= flags;
+    result = t->flags;
+    if ((HOST_BLOCKED == t->state) && (NULL == t->wait_on) && (t->waiting & flags))
+    {
+        host_ready(t);
+    }
+    host_preempt();
+    pthread_mutex_unlock(&m_lock);
+    return result;
+}
+
+uint32_t osThreadFlagsClear(uint32_t flags)
+{
+    host_thread_t *self = m_self;
+    uint32_t result;
+
+    if (host_in_isr() || (NULL == self))
+    {
+        return osFlagsErrorISR;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    result = self->flags;
+    self->flags &= ~flags;
+    pthread_mutex_unlock(&m_lock);
+    return result;
+}
+
+uint32_t osThreadFlagsGet(void)
+{
+    host_thread_t *self = m_self;
+
+    return (host_in_isr() || (NULL == self)) ? 0 : self->flags;
+}
+
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout)
+{
+    host_thread_t *self = m_self;
+    uint32_t result;
+    uint64_t deadline;
+
+    if (host_in_isr() || (NULL == self))
+    {
+        return osFlagsErrorISR;
+    }
+    if (flags & osFlagsError)
+    {
+        return osFlagsErrorParameter;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    deadline = (osWaitForever == timeout) ? HOST_FOREVER : host_ticks() + timeout;
+    for (;;)
+    {
+        uint32_t have = self->flags & flags;
+
+        if ((options & osFlagsWaitAll) ? (have == flags) : (0 != have))
+        {
+            result = self->flags;
+            if (0 == (options & osFlagsNoClear))
+            {
+                self->flags &= ~flags;
+            }
+            break;
+        }
+        if (0 == timeout)
+        {
+            result = osFlagsErrorResource;
+            break;
+        }
+        if (host_ticks() >= deadline)
+        {
+            result = osFlagsErrorTimeout;
+            break;
+        }
+        host_block(self, flags, deadline);
+    }
+    pthread_mutex_unlock(&m_lock);
+    return result;
+}
+
+// ______________________________ Event flags _______________________________
+
+osEventFlagsId_t osEventFlagsNew(const osEventFlagsAttr_t *attr)
+{
+    host_event_flags_t *ef;
+    bool cb_static = false;
+
+    if (host_in_isr())
+    {
+        return NULL;
+    }
+    if ((NULL != attr) && ((NULL != attr->cb_mem) || (0 != attr->cb_size)))
+    {
+        if ((NULL == attr->cb_mem) || (attr->cb_size < sizeof(StaticEventGroup_t)))
+        {
+            return NULL;
+        }
+        cb_static = true;
+    }
+
+    ef = cb_static ? memset(attr->cb_mem, 0, sizeof(host_event_flags_t)) : calloc(1, sizeof(host_event_flags_t));
+    if (NULL != ef)
+    {
+        ef->cb_static = cb_static;
+        ef->name = (NULL != attr) ? attr->name : NULL;
+    }
+    return ef;
+}
+
+const char *osEventFlagsGetName(osEventFlagsId_t ef_id)
+{
+    host_event_flags_t *ef = ef_id;
+
+    return (NULL != ef) ? ef->name : NULL;
+}
+
+// Every thread waiting for one of the flags is readied, a waiter that clears them on
+// return takes them from the ones behind it.
+uint32_t osEventFlagsSet(osEventFlagsId_t ef_id, uint32_t flags)
+{
+    host_event_flags_t *ef = ef_id;
+    uint32_t result;
+
+    if ((NULL == ef) || (flags & osFlagsError))
+    {
+        return osFlagsErrorParameter;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    if ((flags != (ef->flags & flags)) && (NULL != m_on_flags))
+    {
+        m_on_flags(ef->name, ef->flags | flags);
+    }
+    ef->flags |= flags;
+    result = ef->flags;
+    for (host_thread_t *t = m_threads; NULL != t; t = t->next)
+    {
+        if ((HOST_BLOCKED == t->state) && (ef == t->wait_on) && (t->waiting & flags))
+        {
+            host_ready(t);
+        }
+    }
+    host_preempt();
+    pthread_mutex_unlock(&m_lock);
+    return result;
+}
+
+uint32_t osEventFlagsClear(osEventFlagsId_t ef_id, uint32_t flags)
+{
+    host_event_flags_t *ef = ef_id;
+    uint32_t result;
+
+    if ((NULL == ef) || (flags & osFlagsError))
+    {
+        return osFlagsErrorParameter;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    result = ef->flags;
+    if ((0 != (ef->flags & flags)) && (NULL != m_on_flags))
+    {
+        m_on_flags(ef->name, ef->flags & ~flags);
+    }
+    ef->flags &= ~flags;
+    pthread_mutex_unlock(&m_lock);
+    return result;
+}
+
+uint32_t osEventFlagsGet(osEventFlagsId_t ef_id)
+{
+    host_event_flags_t *ef = ef_id;
+    uint32_t result;
+
+    if (NULL == ef)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    result = ef->flags;
+    pthread_mutex_unlock(&m_lock);
+    return result;
+}
+
+uint32_t osEventFlagsWait(osEventFlagsId_t ef_id, uint32_t flags, uint32_t options, uint32_t timeout)
+{
+    host_event_flags_t *ef = ef_id;
+    host_thread_t *self = m_self;
+    uint32_t result;
+    uint64_t deadline;
+
+    if (host_in_isr() || (NULL == self))
+    {
+        return osFlagsErrorISR;
+    }
+    if ((NULL == ef) || (flags & osFlagsError))
+    {
+        return osFlagsErrorParameter;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    deadline = (osWaitForever == timeout) ? HOST_FOREVER : host_ticks() + timeout;
+    for (;;)
+    {
+        uint32_t have = ef->flags & flags;
+
+        if ((options & osFlagsWaitAll) ? (have == flags) : (0 != have))
+        {
+            result = ef->flags;
+            if (0 == (options & osFlagsNoClear))
+            {
+                if (NULL != m_on_flags)
+                {
+                    m_on_flags(ef->name, ef->flags & ~flags);
+                }
+                ef->flags &= ~flags;
+            }
+            break;
+        }
+        if (0 == timeout)
+        {
+            result = osFlagsErrorResource;
+            break;
+        }
+        if (host_ticks() >= deadline)
+        {
+            result = osFlagsErrorTimeout;
+            break;
+        }
+        self->wait_on = ef;
+        host_block(self, flags, deadline);
+    }
+    pthread_mutex_unlock(&m_lock);
+    return result;
+}
+
+// _________________________________ Mutexes ________________________________
+
+osMutexId_t osMutexNew(const osMutexAttr_t *attr)
+{
+    host_mutex_t *mx;
+    bool cb_static = false;
+
+    if (host_in_isr())
+    {
+        return NULL;
+    }
+    if ((NULL != attr) && ((NULL != attr->cb_mem) || (0 != attr->cb_size)))
+    {
+        if ((NULL == attr->cb_mem) || (attr->cb_size < sizeof(StaticSemaphore_t)))
+        {
+            return NULL;
+        }
+        cb_static = true;
+    }
+
+    mx = cb_static ? memset(attr->cb_mem, 0, sizeof(host_mutex_t)) : calloc(1, sizeof(host_mutex_t));
+    if (NULL != mx)
+    {
+        mx->cb_static = cb_static;
+        mx->name = (NULL != attr) ? attr->name : NULL;
+    }
+    return mx;
+}
+
+// Not recursive and without priority inheritance
+osStatus_t osMutexAcquire(osMutexId_t mutex_id, uint32_t timeout)
+{
+    host_mutex_t *mx = mutex_id;
+    host_thread_t *self = m_self;
+    osStatus_t status;
+    uint64_t deadline;
+
+    if (host_in_isr() || (NULL == self))
+    {
+        return osErrorISR;
+    }
+    if (NULL == mx)
+    {
+        return osErrorParameter;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    deadline = (osWaitForever == timeout) ? HOST_FOREVER : host_ticks() + timeout;
+    for (;;)
+    {
+        if (NULL == mx->owner)
+        {
+            mx->owner = self;
+            status = osOK;
+            break;
+        }
+        if ((self == mx->owner) || (0 == timeout))
+        {
+            status = osErrorResource;
+            break;
+        }
+        if (host_ticks() >= deadline)
+        {
+            status = osErrorTimeout;
+            break;
+        }
+        self->wait_on = mx;
+        host_block(self, 0, deadline);
+    }
+    pthread_mutex_unlock(&m_lock);
+    return status;
+}
+
+// Every waiter is readied, the first one to run takes it
+osStatus_t osMutexRelease(osMutexId_t mutex_id)
+{
+    host_mutex_t *mx = mutex_id;
+    osStatus_t status = osOK;
+
+    if (host_in_isr())
+    {
+        return osErrorISR;
+    }
+    if (NULL == mx)
+    {
+        return osErrorParameter;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    if (m_self != mx->owner)
+    {
+        status = osErrorResource;
+    }
+    else
+    {
+        mx->owner = NULL;
+        for (host_thread_t *t = m_threads; NULL != t; t = t->next)
+        {
+            if ((HOST_BLOCKED == t->state) && (mx == t->wait_on))
+            {
+                host_ready(t);
+            }
+        }
+        host_preempt();
+    }
+    pthread_mutex_unlock(&m_lock);
+    return status;
+}
+
+// _________________________________ Delays _________________________________
+
+static osStatus_t host_delay(uint64_t deadline)
+{
+    host_thread_t *self = m_self;
+
+    if (host_in_isr() || (NULL == self))
+    {
+        return osErrorISR;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    while (host_ticks() < deadline)
+    {
+        host_block(self, 0, deadline);
+    }
+    pthread_mutex_unlock(&m_lock);
+    return osOK;
+}
+
+osStatus_t osDelay(uint32_t ticks)
+{
+    return (0 == ticks) ? osOK : host_delay(host_ticks() + ticks);
+}
+
+osStatus_t osDelayUntil(uint32_t ticks)
+{
+    uint64_t now = host_ticks();
+    uint32_t delay = ticks - (uint32_t)now;
+
+    // Same rule as the FreeRTOS wrapper, a deadline in the past is an error
+    if ((0 == delay) || (delay >> 31))
+    {
+        return osErrorParameter;
+    }
+    return host_delay(now + delay);
+}
+
+// ________________________________ Task state ______________________________
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t * const pxTaskStatusArray, const UBaseType_t uxArraySize,
+                                 uint32_t * const pulTotalRunTime)
+{
+    // Threads take no virtual time, no run time stats then, like configGENERATE_RUN_TIME_STATS 0
+    bool sim = host_sim_enabled();
+    UBaseType_t count = 0;
+
+    pthread_mutex_lock(&m_lock);
+    if (uxArraySize >= m_thread_count + 1)
+    {
+        for (host_thread_t *t = m_threads; NULL != t; t = t->next)
+        {
+            TaskStatus_t *st = &pxTaskStatusArray[count++];
+            uint32_t size = (0 != t->stack_size) ? t->stack_size : HOST_STACK_WATCH;
+            uint32_t used = host_stack_used(t);
+            uint32_t free = (used < size) ? (size - used) / sizeof(StackType_t) : 0;
+
+            st->xHandle = t;
+            st->pcTaskName = (NULL != t->name) ? t->name : "";
+            st->xTaskNumber = t->number;
+            st->eCurrentState = (HOST_TERMINATED == t->state) ? eDeleted
+                              : (t == m_current) ? eRunning
+                              : t->suspended ? eSuspended
+                              : (HOST_READY == t->state) ? eReady : eBlocked;
+            st->uxCurrentPriority = t->priority;
+            st->uxBasePriority = t->priority;
+            st->ulRunTimeCounter = sim ? 0 : t->run_time;
+            st->pxStackBase = t->stack_mem;
+            st->usStackHighWaterMark = (free > UINT16_MAX) ? UINT16_MAX : free;
+        }
+
+        // The idle loop of osKernelStart stands in for the idle task
+        pxTaskStatusArray[count++] = (TaskStatus_t){
+            .xHandle = &m_idle_time, .pcTaskName = "IDLE", .eCurrentState = (NULL == m_current) ? eRunning : eReady,
+            .ulRunTimeCounter = sim ? 0 : m_idle_time, .usStackHighWaterMark = 0};
+        if (NULL != pulTotalRunTime)
+        {
+            *pulTotalRunTime = sim ? 0 : host_cycles();
+        }
+    }
+    pthread_mutex_unlock(&m_lock);
+    return count;
+}
+
+// _________________________________ Timers _________________________________
+
+osTimerId_t osTimerNew(osTimerFunc_t func, osTimerType_t type, void *argument, const osTimerAttr_t *attr)
+{
+    host_timer_t *tm;
+    bool cb_static = false;
+
+    if ((NULL == func) || host_in_isr())
+    {
+        return NULL;
+    }
+    if ((NULL != attr) && ((NULL != attr->cb_mem) || (0 != attr->cb_size)))
+    {
+        if ((NULL == attr->cb_mem) || (attr->cb_size < sizeof(StaticTimer_t)))
+        {
+            return NULL;
+        }
+        cb_static = true;
+    }
+
+    tm = cb_static ? memset(attr->cb_mem, 0, sizeof(host_timer_t)) : calloc(1, sizeof(host_timer_t));
+    if (NULL != tm)
+    {
+        tm->cb_static = cb_static;
+        tm->func = func;
+        tm->argument = argument;
+        tm->type = type;
+        tm->name = (NULL != attr) ? attr->name : NULL;
+
+        pthread_mutex_lock(&m_lock);
+        tm->next = m_timers;
+        m_timers = tm;
+        pthread_mutex_unlock(&m_lock);
+    }
+    return tm;
+}
+
+const char *osTimerGetName(osTimerId_t timer_id)
+{
+    host_timer_t *tm = timer_id;
+
+    return (NULL != tm) ? tm->name : NULL;
+}
+
+osStatus_t osTimerStart(osTimerId_t timer_id, uint32_t ticks)
+{
+    host_timer_t *tm = timer_id;
+
+    if (host_in_isr())
+    {
+        return osErrorISR;
+    }
+    if ((NULL == tm) || (0 == ticks))
+    {
+        return osErrorParameter;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    tm->period = ticks;
+    tm->deadline = host_ticks() + ticks;
+    tm->running = true;
+    host_ready(m_timer_service);
+    host_preempt();
+    pthread_mutex_unlock(&m_lock);
+    return osOK;
+}
+
+osStatus_t osTimerStop(osTimerId_t timer_id)
+{
+    host_timer_t *tm = timer_id;
+    osStatus_t status = osOK;
+
+    if (host_in_isr())
+    {
+        return osErrorISR;
+    }
+    if (NULL == tm)
+    {
+        return osErrorParameter;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    if (tm->running)
+    {
+        tm->running = false;
+    }
+    else
+    {
+        status = osErrorResource;
+    }
+    pthread_mutex_unlock(&m_lock);
+    return status;
+}
+
+uint32_t osTimerIsRunning(osTimerId_t timer_id)
+{
+    host_timer_t *tm = timer_id;
+
+    return ((NULL != tm) && tm->running) ? 1 : 0;
+}
+
+osStatus_t osTimerDelete(osTimerId_t timer_id)
+{
+    host_timer_t *tm = timer_id;
+
+    if (host_in_isr())
+    {
+        return osErrorISR;
+    }
+    if (NULL == tm)
+    {
+        return osErrorParameter;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    for (host_timer_t **p = &m_timers; NULL != *p; p = &(*p)->next)
+    {
+        if (*p == tm)
+        {
+            *p = tm->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&m_lock);
+
+    if (!tm->cb_static)
+    {
+        free(tm);
+    }
+    return osOK;
+}
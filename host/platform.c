@@ -0,0 +1,91 @@
+/**
+ * @brief Board support for the host build: platform init, the serial console
+ * on stdin and stdout, and the stdout logger.
+ *
+ * A reader pthread stands in for the VCOM receiver. It puts every byte of
+ * stdin in the receive buffer and raises the USART0 RX interrupt, which
+ * retargetserial.c handles on the device.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "platform.h"
+#include "retargetserial.h"
+#include "logger_fwrite.h"
+#include "host.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define HOST_RX_SIZE 64 // Receive buffer, bytes past a full one are lost like on the device
+
+static uint8_t m_rx[HOST_RX_SIZE];
+static uint32_t m_rx_head; // Written by the reader only
+static uint32_t m_rx_tail; // Written by RETARGET_ReadChar only
+
+void PLATFORM_Init(void)
+{
+}
+
+static void *host_rx_main(void *argument)
+{
+    unsigned char c;
+
+    while (1 == read(STDIN_FILENO, &c, 1))
+    {
+        uint32_t head = m_rx_head;
+
+        if (head - __atomic_load_n(&m_rx_tail, __ATOMIC_ACQUIRE) < HOST_RX_SIZE)
+        {
+            m_rx[head % HOST_RX_SIZE] = c;
+            __atomic_store_n(&m_rx_head, head + 1, __ATOMIC_RELEASE);
+        }
+        host_irq(USART0_RX_IRQn);
+    }
+    return NULL;
+}
+
+void RETARGET_SerialInit(void)
+{
+    pthread_t reader;
+
+    // A simulation does not depend on the terminal
+    if (!host_sim_enabled() && (0 == pthread_create(&reader, NULL, host_rx_main, NULL)))
+    {
+        pthread_detach(reader);
+    }
+    NVIC_EnableIRQ(USART0_RX_IRQn);
+}
+
+// The reader has put the byte in the buffer already
+void RETARGET_RX_IRQHandler(void)
+{
+}
+
+int RETARGET_ReadChar(void)
+{
+    uint32_t tail = m_rx_tail;
+    int c;
+
+    if (tail == __atomic_load_n(&m_rx_head, __ATOMIC_ACQUIRE))
+    {
+        return -1;
+    }
+    c = m_rx[tail % HOST_RX_SIZE];
+    __atomic_store_n(&m_rx_tail, tail + 1, __ATOMIC_RELEASE);
+    return c;
+}
+
+void logger_fwrite_init(void)
+{
+}
+
+int logger_fwrite(const char *ptr, int len)
+{
+    fwrite(ptr, len, 1, stdout);
+    fflush(stdout);
+    return len;
+}
@@ -0,0 +1,193 @@
+/**
+ * @brief LDMA playback test, buffer handoff and underruns on the LDMA model
+ * of em.c in virtual time.
+ *
+ *   esw-gpio-playbacktest [-v]
+ *
+ * Each case streams a number of blocks, one toggle word each, through
+ * playback.c one sample at a time. Every refill must get the buffer the
+ * LDMA is not in, every block must toggle the pin once, and the short
+ * refills and the buffers the LDMA reached before their refill must show
+ * up in the stats. The late interrupt case keeps interrupts masked over
+ * both buffers, so their done interrupts merge into one. -v prints the
+ * stats of every case. Exits 1 on any mismatch.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../playback.h"
+#include "host.h"
+#include "em_core.h"
+#include "em_gpio.h"
+#include "em_ldma.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define TEST_LEN     4    // Words per buffer
+#define TEST_RATE    1000 // Samples per second
+#define TEST_WORD_NS 1000000ULL
+#define TEST_MAX_NS  (1000 * TEST_WORD_NS) // Every case is done by then
+
+typedef struct test_case
+{
+    const char *name;
+    uint32_t blocks;    // Blocks before the end of the stream
+    uint32_t short_at;  // Block returned one word short, 0 for none
+    uint32_t mask_at;   // Sample to mask interrupts at for two buffers, 0 for none
+    uint32_t underruns; // Expected
+    uint32_t late;      // Expected
+} test_case_t;
+
+static const test_case_t TEST_CASES[] = {
+    {"handoff", 6, 0, 0, 0, 0},
+    {"short refill", 6, 3, 0, 1, 0},
+    {"late interrupt", 8, 0, 1, 0, 1},
+    {"late interrupt mid buffer", 12, 0, 10, 0, 1},
+};
+
+static uint32_t m_buf[2][TEST_LEN];
+static uint32_t m_block;
+static uint32_t m_wrong; // Refills of the buffer the LDMA is in
+static bool m_done;
+static const test_case_t *m_case;
+static bool m_verbose;
+
+// Same as playback.c works it out, from the source address of the channel
+static uint32_t *test_playing(void)
+{
+    uintptr_t src = LDMA->CH[0].SRC;
+
+    return ((src >= (uintptr_t)m_buf[1]) && (src < (uintptr_t)&m_buf[1][TEST_LEN])) ? m_buf[1] : m_buf[0];
+}
+
+static uint32_t test_refill(uint32_t *buf, uint32_t len, void *user)
+{
+    uint32_t n;
+
+    if (playback_active() && (buf == test_playing()))
+    {
+        m_wrong++;
+    }
+    if (m_block >= m_case->blocks)
+    {
+        return 0;
+    }
+
+    m_block++;
+    n = (m_block == m_case->short_at) ? len - 1 : len;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        buf[i] = (0 == i) ? PLAYBACK_TOGGLE : 0;
+    }
+    return n;
+}
+
+static void test_done(void *user)
+{
+    m_done = true;
+}
+
+// Serve the LDMA requests up to ns, the interrupts run as they come unless masked
+static void test_advance(uint64_t ns)
+{
+    while (!host_periph_advance(ns))
+    {
+    }
+    host_sim_set_now(ns);
+}
+
+static bool test_run(const test_case_t *c)
+{
+    playback_stats_t stats;
+    uint32_t expected = c->blocks + c->late; // A stale buffer plays its old block once more
+    uint64_t now = host_sim_now();
+    uint64_t end = now + TEST_MAX_NS;
+    uint8_t level = host_gpio_level(gpioPortA, 0);
+    uint32_t toggles = 0;
+    uint32_t sample = 0;
+    bool ok;
+
+    m_case = c;
+    m_block = 0;
+    m_wrong = 0;
+    m_done = false;
+    if (!playback_start(m_buf[0], m_buf[1], TEST_LEN, TEST_RATE, test_refill, test_done, NULL))
+    {
+        fprintf(stderr, "FAIL %s, not started\n", c->name);
+        return false;
+    }
+
+    while (playback_active() && (now < end))
+    {
+        CORE_DECLARE_IRQ_STATE;
+
+        if ((0 != c->mask_at) && (++sample == c->mask_at))
+        {
+            // Both buffers end while masked, the LDMA is back in the first one
+            CORE_ENTER_ATOMIC();
+            for (uint32_t i = 0; i < 2 * TEST_LEN; i++)
+            {
+                now += TEST_WORD_NS;
+                test_advance(now);
+                toggles += (level != host_gpio_level(gpioPortA, 0)) ? 1 : 0;
+                level = host_gpio_level(gpioPortA, 0);
+            }
+            CORE_EXIT_ATOMIC();
+            continue;
+        }
+
+        now += TEST_WORD_NS;
+        test_advance(now);
+        toggles += (level != host_gpio_level(gpioPortA, 0)) ? 1 : 0;
+        level = host_gpio_level(gpioPortA, 0);
+    }
+    playback_get_stats(&stats);
+
+    // The stop drives a high pin low
+    expected += expected & 1;
+    ok = m_done && (0 == m_wrong) && (stats.underruns == c->underruns) && (stats.late == c->late)
+         && (toggles == expected);
+    if (!ok || m_verbose)
+    {
+        fprintf(ok ? stdout : stderr,
+                "%s %s: done %d buffers %" PRIu32 " underruns %" PRIu32 " late %" PRIu32 " toggles %" PRIu32
+                " wrong refills %" PRIu32 ", expected underruns %" PRIu32 " late %" PRIu32 " toggles %" PRIu32 "\n",
+                ok ? "ok" : "FAIL", c->name, m_done, stats.buffers, stats.underruns, stats.late, toggles, m_wrong,
+                c->underruns, c->late, expected);
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t failed = 0;
+    uint32_t count = sizeof(TEST_CASES) / sizeof(TEST_CASES[0]);
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "vh")))
+    {
+        if ('v' != opt)
+        {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 'h' == opt ? 0 : 1;
+        }
+        m_verbose = true;
+    }
+
+    host_init();
+    host_sim_enable(UINT64_MAX);
+    GPIO_PinModeSet(gpioPortA, 0, gpioModePushPull, 0);
+    playback_init();
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        failed += test_run(&TEST_CASES[i]) ? 0 : 1;
+    }
+
+    printf("playback: %" PRIu32 " of %" PRIu32 " cases failed\n", failed, count);
+    return (0 == failed) ? 0 : 1;
+}
@@ -0,0 +1,16 @@
+/**
+ * @brief Serial console for the host build, stdin and stdout stand in for
+ * the VCOM USART, see host/platform.c.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef RETARGETSERIAL_H_
+#define RETARGETSERIAL_H_
+
+void RETARGET_SerialInit(void);
+
+// Next received character, -1 if there is none.
+int RETARGET_ReadChar(void);
+
+#endif//RETARGETSERIAL_H_
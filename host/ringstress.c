@@ -0,0 +1,228 @@
+/**
+ * @brief Edge ring stress, edge_ring.c alone between a producer and a
+ * consumer pthread on two host cores.
+ *
+ *   esw-gpio-ringstress [-n edges] [-p producer_ns] [-b batch] [-c consumer_ns] [-o report]
+ *
+ * The producer pushes -n edges, 10000000 by default, in place of the
+ * interrupt handler, one every -p ns, 100 by default, or as fast as it
+ * can with -p 0, which overflows the ring at once. Every record carries its sequence
+ * number as the timestamp and port, pin and level derived from it. The
+ * consumer pops up to -b records at a time, 8 by default like
+ * button_loop, and spins -c ns between pops, 0 by default, to stand in
+ * for a thread that is busy. It checks every record: the sequence numbers
+ * must go up, a gap is lost edges, and the other fields must match.
+ *
+ * The JSON report has the edges pushed and dropped by the ring, the edges
+ * seen by the consumer, the ones lost to gaps and the corrupt ones, the
+ * high water mark and the throughput of both sides. The edges lost must
+ * be the ones the ring counted as dropped and none may be corrupt,
+ * anything else is reported as an error. Two host cores race much harder
+ * than an interrupt and a thread on the device, which is the point. On a
+ * single core the threads take turns a time slice each, the ring
+ * overflows every turn and only the accounting is checked, so the report
+ * has the cores online too.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../edge_ring.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RING_BATCH_MAX 64
+
+typedef struct ring_result
+{
+    uint64_t seen;
+    uint64_t lost;
+    uint64_t corrupt;
+    uint64_t producer_ns;
+    uint64_t consumer_ns;
+} ring_result_t;
+
+static edge_ring_t m_ring;
+static uint32_t m_edges = 10000000;
+static uint32_t m_batch = 8;
+static uint32_t m_producer_ns = 100;
+static uint32_t m_consumer_ns;
+static volatile bool m_started;
+static volatile bool m_produced;
+static uint64_t m_produced_ns;
+
+static uint64_t ring_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void ring_spin(uint32_t ns)
+{
+    uint64_t until = ring_ns() + ns;
+
+    while ((0 != ns) && (ring_ns() < until))
+    {
+    }
+}
+
+// Fields of record seq, so the consumer can tell a torn one
+static uint8_t ring_port(uint32_t seq)
+{
+    return (uint8_t)(seq >> 8);
+}
+
+static uint8_t ring_pin(uint32_t seq)
+{
+    return (uint8_t)(seq & 0x0F);
+}
+
+static uint8_t ring_level(uint32_t seq)
+{
+    return (uint8_t)((seq >> 4) & 1);
+}
+
+static void *ring_producer(void *argument)
+{
+    uint64_t start;
+
+    // Not before the consumer runs, or the first edges meet no one
+    while (!__atomic_load_n(&m_started, __ATOMIC_ACQUIRE))
+    {
+    }
+    start = ring_ns();
+    for (uint32_t seq = 1; seq <= m_edges; seq++)
+    {
+        edge_ring_push(&m_ring, seq, ring_port(seq), ring_pin(seq), ring_level(seq));
+        ring_spin(m_producer_ns);
+    }
+    m_produced_ns = ring_ns() - start;
+    __atomic_store_n(&m_produced, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void ring_consume(ring_result_t *r)
+{
+    edge_event_t batch[RING_BATCH_MAX];
+    uint32_t expected = 1;
+    uint64_t start = ring_ns();
+
+    __atomic_store_n(&m_started, true, __ATOMIC_RELEASE);
+    for (;;)
+    {
+        // Done is read before the pop, so nothing pushed before it is missed
+        bool done = __atomic_load_n(&m_produced, __ATOMIC_ACQUIRE);
+        uint32_t count = edge_ring_pop(&m_ring, batch, m_batch);
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const edge_event_t *e = &batch[i];
+            uint32_t seq = e->timestamp;
+
+            if ((seq < expected) || (seq > m_edges) || (ring_port(seq) != e->port) || (ring_pin(seq) != e->pin)
+                || (ring_level(seq) != e->level))
+            {
+                r->corrupt++;
+                continue;
+            }
+            r->lost += seq - expected;
+            r->seen++;
+            expected = seq + 1;
+        }
+        if (done && (0 == count))
+        {
+            break;
+        }
+        if (0 == count)
+        {
+            // Lets the producer in when both share a core
+            sched_yield();
+        }
+        ring_spin(m_consumer_ns);
+    }
+    r->lost += (m_edges + 1) - expected;
+    r->consumer_ns = ring_ns() - start;
+    r->producer_ns = m_produced_ns;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = NULL;
+    FILE *report = stdout;
+    ring_result_t r = {0};
+    pthread_t producer;
+    bool ok;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "n:p:b:c:o:h")))
+    {
+        switch (opt)
+        {
+            case 'n':
+                m_edges = strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                m_producer_ns = strtoul(optarg, NULL, 0);
+                break;
+            case 'b':
+                m_batch = strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                m_consumer_ns = strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                path = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n edges] [-p producer_ns] [-b batch] [-c consumer_ns] [-o report]\n",
+                        argv[0]);
+                return 'h' == opt ? 0 : 1;
+        }
+    }
+    if ((0 == m_edges) || (m_edges >= UINT32_MAX) || (0 == m_batch) || (m_batch > RING_BATCH_MAX))
+    {
+        fprintf(stderr, "at least one edge, batches of 1 to %u\n", RING_BATCH_MAX);
+        return 1;
+    }
+
+    if ((NULL != path) && (NULL == (report = fopen(path, "w"))))
+    {
+        perror(path);
+        return 1;
+    }
+
+    edge_ring_init(&m_ring);
+    if (0 != pthread_create(&producer, NULL, ring_producer, NULL))
+    {
+        perror("pthread_create");
+        return 1;
+    }
+    ring_consume(&r);
+    pthread_join(producer, NULL);
+
+    fprintf(report, "{\"cores\": %ld, \"edges\": %" PRIu32 ", \"producer_ns\": %" PRIu32 ", \"batch\": %" PRIu32
+            ", \"consumer_ns\": %" PRIu32 ", \"pushed\": %" PRIu32 ", \"dropped\": %" PRIu32 ", \"seen\": %" PRIu64
+            ", \"lost\": %" PRIu64 ", \"corrupt\": %" PRIu64 ", \"high_water\": %" PRIu32
+            ", \"push_per_s\": %.0f, \"pop_per_s\": %.0f}\n",
+            sysconf(_SC_NPROCESSORS_ONLN), m_edges, m_producer_ns, m_batch, m_consumer_ns, m_ring.pushed,
+            m_ring.dropped, r.seen, r.lost, r.corrupt, m_ring.high_water, m_edges * 1e9 / r.producer_ns,
+            r.seen * 1e9 / r.consumer_ns);
+    fclose(report);
+
+    ok = (0 == r.corrupt) && (r.lost == m_ring.dropped) && (r.seen == m_ring.pushed);
+    if (!ok)
+    {
+        fprintf(stderr, "%" PRIu64 " lost against %" PRIu32 " dropped, %" PRIu64 " seen against %" PRIu32
+                " pushed, %" PRIu64 " corrupt\n", r.lost, m_ring.dropped, r.seen, m_ring.pushed, r.corrupt);
+    }
+    return ok ? 0 : 1;
+}
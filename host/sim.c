@@ -0,0 +1,215 @@
+/**
+ * @brief Discrete-event simulation for the host build, see host.h.
+ *
+ * In virtual time the clock stands still while any thread or handler runs
+ * and only moves in the idle loop, straight to the next thing that can
+ * happen: a thread timeout, a queued event or an LDMA interrupt. Firmware code
+ * takes no time, so a run depends only on the firmware and the events and
+ * replays exactly.
+ *
+ * Events are kept in a binary heap ordered by time, then by the order they
+ * were queued in.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "host.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HOST_SIM_HEAP_MIN 64
+
+typedef struct host_event
+{
+    uint64_t at_ns;
+    uint64_t seq;
+    host_event_f func;
+    void *arg;
+    uint8_t port;
+    uint8_t pin;
+    uint8_t level;
+} host_event_t;
+
+static bool m_enabled;
+static uint64_t m_now;
+static uint64_t m_end = UINT64_MAX;
+
+static pthread_mutex_t m_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static host_event_t *m_heap;
+static uint32_t m_heap_size;
+static uint32_t m_heap_count;
+static uint64_t m_seq;
+
+void host_sim_enable(uint64_t end_ns)
+{
+    m_enabled = true;
+    m_end = end_ns;
+}
+
+bool host_sim_enabled(void)
+{
+    return m_enabled;
+}
+
+uint64_t host_sim_now(void)
+{
+    return __atomic_load_n(&m_now, __ATOMIC_ACQUIRE);
+}
+
+void host_sim_set_now(uint64_t ns)
+{
+    if (ns > m_now)
+    {
+        __atomic_store_n(&m_now, ns, __ATOMIC_RELEASE);
+    }
+}
+
+static bool host_event_before(const host_event_t *a, const host_event_t *b)
+{
+    return (a->at_ns < b->at_ns) || ((a->at_ns == b->at_ns) && (a->seq < b->seq));
+}
+
+static void host_queue(host_event_t *e)
+{
+    uint32_t i;
+
+    pthread_mutex_lock(&m_queue_lock);
+    if (m_heap_count == m_heap_size)
+    {
+        m_heap_size = (0 == m_heap_size) ? HOST_SIM_HEAP_MIN : 2 * m_heap_size;
+        m_heap = realloc(m_heap, m_heap_size * sizeof(host_event_t));
+        if (NULL == m_heap)
+        {
+            fprintf(stderr, "sim: out of memory\n");
+            exit(1);
+        }
+    }
+
+    e->seq = m_seq++;
+    for (i = m_heap_count++; (i > 0) && host_event_before(e, &m_heap[(i - 1) / 2]); i = (i - 1) / 2)
+    {
+        m_heap[i] = m_heap[(i - 1) / 2];
+    }
+    m_heap[i] = *e;
+    pthread_mutex_unlock(&m_queue_lock);
+}
+
+// Remove the first event if it is due by ns.
+static bool host_dequeue(uint64_t ns, host_event_t *out)
+{
+    bool due = false;
+
+    pthread_mutex_lock(&m_queue_lock);
+    if ((0 != m_heap_count) && (m_heap[0].at_ns <= ns))
+    {
+        host_event_t last = m_heap[--m_heap_count];
+        uint32_t i = 0;
+
+        *out = m_heap[0];
+        for (;;)
+        {
+            uint32_t child = 2 * i + 1;
+
+            if (child >= m_heap_count)
+            {
+                break;
+            }
+            if ((child + 1 < m_heap_count) && host_event_before(&m_heap[child + 1], &m_heap[child]))
+            {
+                child++;
+            }
+            if (!host_event_before(&m_heap[child], &last))
+            {
+                break;
+            }
+            m_heap[i] = m_heap[child];
+            i = child;
+        }
+        m_heap[i] = last;
+        due = true;
+    }
+    pthread_mutex_unlock(&m_queue_lock);
+    return due;
+}
+
+static uint64_t host_next_event(void)
+{
+    uint64_t next;
+
+    pthread_mutex_lock(&m_queue_lock);
+    next = (0 != m_heap_count) ? m_heap[0].at_ns : UINT64_MAX;
+    pthread_mutex_unlock(&m_queue_lock);
+    return next;
+}
+
+void host_sim_at(uint64_t at_ns, host_event_f func, void *arg)
+{
+    host_event_t e = {.at_ns = at_ns, .func = func, .arg = arg};
+
+    host_queue(&e);
+}
+
+void host_sim_input(uint64_t at_ns, uint8_t port, uint8_t pin, uint8_t level)
+{
+    host_event_t e = {.at_ns = at_ns, .func = NULL, .port = port, .pin = pin, .level = level};
+
+    host_queue(&e);
+}
+
+static void host_sim_finish(const char *why)
+{
+    host_trace("end", "%s", why);
+    host_trace_close();
+    fflush(stdout);
+    exit(0);
+}
+
+void host_sim_step(uint64_t deadline_ns)
+{
+    uint64_t next = host_next_event();
+    host_event_t e;
+
+    // The threads have had their turn at the end time
+    if (m_now >= m_end)
+    {
+        host_sim_finish("time");
+    }
+
+    if (deadline_ns < next)
+    {
+        next = deadline_ns;
+    }
+    if (next > m_end)
+    {
+        next = m_end;
+    }
+    if (UINT64_MAX == next)
+    {
+        // Without an end time a run stops when only the peripherals are left
+        host_sim_finish("idle");
+    }
+
+    // An LDMA interrupt comes first, the threads it wakes run at its time
+    if (!host_periph_advance(next))
+    {
+        return;
+    }
+    host_sim_set_now(next);
+
+    // Events may queue more events, those that are already due run too
+    while (host_dequeue(m_now, &e))
+    {
+        if (NULL != e.func)
+        {
+            e.func(e.arg);
+        }
+        else
+        {
+            host_gpio_input(e.port, e.pin, e.level);
+        }
+    }
+}
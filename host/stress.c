@@ -0,0 +1,538 @@
+/**
+ * @brief Button interrupt stress harness, fires PF4 pulse trains into the
+ * running firmware and accounts for every edge.
+ *
+ *   esw-gpio-stress [-r rates] [-d seconds] [-n presses] [-b bounces]
+ *                   [-w bounce_us] [-p press_ms] [-s seed] [-o report] [-v]
+ *
+ * For each rate in Hz, 1 to 1000000, presses of -p ms (at most half the
+ * period) are fired through the GPIO model for -d seconds or -n presses,
+ * whichever ends first. Every press and release carries 0 to -b extra
+ * bounce pairs at random times within -w us. The edges go through the
+ * EXTI model into GPIO_EVEN_IRQHandler on the harness thread while the
+ * firmware threads keep running, so the handler competes with critical
+ * sections and edges merge in the interrupt flag as they would on the
+ * device.
+ *
+ * The edges as fired are also fed to debounce.c and gesture.c directly
+ * with the button timings of button_timing.h, which gives the single clicks the firmware
+ * should have recognized. Each of those must turn into one stop or start
+ * of the buzzer gate, the rest is loss. Edges the firmware may
+ * legitimately decide either way, right at the end of a debounce window
+ * or a gesture deadline, are left out and counted as guarded. The JSON
+ * report lists per rate the edges fired and delivered to the handler, the
+ * expected and performed transitions, the loss rate and the worst
+ * interrupt and transition latencies. Single clicks need a 300 ms gap, at
+ * higher rates only the end of a train can make one and the run mostly
+ * shows interrupt loss and spurious transitions. Firmware output is
+ * dropped unless -v sends it to stderr. A stop is the gate closing, a
+ * start the gate letting the tone threads through once both are out,
+ * which is up to a tone period after the click. Needs
+ * BUZZER_MODE=THREADS, the other backends have no gate.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "host.h"
+#include "em_gpio.h"
+
+#include "../debounce.h"
+#include "../gesture.h"
+#include "../button_timing.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STRESS_GATE           "buzzer"
+
+#define STRESS_RATES_MAX  16
+#define STRESS_BOOT_MS    500  // Firmware set-up before the first rate
+#define STRESS_QUIET_MS   1500 // Released between rates, every gesture ends
+#define STRESS_SPIN_NS    100000ULL
+#define STRESS_TOGGLE_MAX 65536
+#define STRESS_PER_MS     (HOST_CORE_CLOCK_HZ / 1000)
+#define STRESS_GUARD_NS   200000ULL                   // Handler and timer uncertainty
+#define STRESS_GUARD      (HOST_CORE_CLOCK_HZ / 5000) // Same in system timer cycles
+#define STRESS_LATE       (3 * STRESS_PER_MS)         // How late button_loop may handle a deadline
+
+typedef struct stress_edge
+{
+    uint64_t at_ns;
+    uint8_t level;
+} stress_edge_t;
+
+static uint32_t m_rates[STRESS_RATES_MAX];
+static uint32_t m_rate_count;
+static uint32_t m_seconds = 10;
+static uint32_t m_presses = 50000;
+static uint32_t m_bounces = 4;
+static uint32_t m_bounce_us = 5000;
+static uint32_t m_press_ms = 100;
+static uint32_t m_seed = 1;
+static FILE *m_report;
+
+static pthread_mutex_t m_toggle_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t m_toggles[STRESS_TOGGLE_MAX];
+static uint32_t m_toggle_count;
+
+static stress_edge_t *m_edges;
+static uint32_t m_edge_count;
+static uint32_t m_edge_size;
+
+// The event flag of the buzzer gate is cleared on a stop and set on a start
+static void stress_on_gate(const char *name, uint32_t flags)
+{
+    if ((NULL != name) && (0 == strcmp(name, STRESS_GATE)))
+    {
+        pthread_mutex_lock(&m_toggle_lock);
+        if (m_toggle_count < STRESS_TOGGLE_MAX)
+        {
+            m_toggles[m_toggle_count++] = host_cycles();
+        }
+        pthread_mutex_unlock(&m_toggle_lock);
+    }
+}
+
+static void stress_sleep_until(uint64_t at_ns)
+{
+    uint64_t now = host_now_ns();
+
+    // Sleep most of the way, the last stretch is spun for sub-microsecond spacing
+    if (at_ns > now + STRESS_SPIN_NS)
+    {
+        uint64_t wait = at_ns - now - STRESS_SPIN_NS;
+        struct timespec ts = {.tv_sec = wait / 1000000000ULL, .tv_nsec = wait % 1000000000ULL};
+
+        nanosleep(&ts, NULL);
+    }
+    while (host_now_ns() < at_ns)
+    {
+    }
+}
+
+static void stress_add(uint64_t at_ns, uint8_t level)
+{
+    if (m_edge_count == m_edge_size)
+    {
+        m_edge_size = (0 == m_edge_size) ? 4096 : 2 * m_edge_size;
+        m_edges = realloc(m_edges, m_edge_size * sizeof(stress_edge_t));
+        if (NULL == m_edges)
+        {
+            fprintf(stderr, "stress: out of memory\n");
+            exit(1);
+        }
+    }
+    m_edges[m_edge_count++] = (stress_edge_t){.at_ns = at_ns, .level = level};
+}
+
+static int stress_cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+// The edge to level at at_ns, then bounce pairs within window that end on level.
+static void stress_transition(uint64_t at_ns, uint8_t level, uint64_t window)
+{
+    uint64_t offsets[2 * 64];
+    uint32_t pairs = (0 == window) ? 0 : rand() % (m_bounces + 1);
+
+    stress_add(at_ns, level);
+    for (uint32_t i = 0; i < 2 * pairs; i++)
+    {
+        offsets[i] = 1 + (uint64_t)rand() % window;
+    }
+    qsort(offsets, 2 * pairs, sizeof(uint64_t), stress_cmp_u64);
+    for (uint32_t i = 0; i < 2 * pairs; i++)
+    {
+        stress_add(at_ns + offsets[i], (i & 1) ? level : !level);
+    }
+}
+
+static void stress_plan(uint32_t rate, uint64_t start_ns)
+{
+    uint64_t period = 1000000000ULL / rate;
+    uint64_t width = (uint64_t)m_press_ms * 1000000ULL;
+    uint64_t window = (uint64_t)m_bounce_us * 1000ULL;
+    uint64_t presses = (uint64_t)m_seconds * rate;
+
+    if (width > period / 2)
+    {
+        width = period / 2;
+    }
+    // Bounces stay within their half of the pulse
+    if (window > width / 2)
+    {
+        window = width / 2;
+    }
+    if (window > (period - width) / 2)
+    {
+        window = (period - width) / 2;
+    }
+    if (presses > m_presses)
+    {
+        presses = m_presses;
+    }
+
+    m_edge_count = 0;
+    for (uint64_t i = 0; i < presses; i++)
+    {
+        stress_transition(start_ns + i * period, 0, window);
+        stress_transition(start_ns + i * period + width, 1, window);
+    }
+}
+
+// ________________________________ Reference _________________________________
+
+// Edges are fed to the firmware and to a copy of its debounce and gesture logic with the
+// same stamps. Near a decision boundary the firmware outcome depends on how late its
+// handler and thread run, such edges are not fired and do not count. The settle poll of
+// button_loop times out a window after its last wake, up to a window after the reference
+// poll. Every poll adds that to the uncertainty of the debounce and gesture times until
+// an edge is accepted in the handler again.
+typedef struct stress_reference
+{
+    debounce_t debounce;
+    gesture_t gesture;
+    uint32_t now;       // Deadlines handled up to here
+    uint32_t last_due;  // Latest settle poll or gesture deadline handled
+    uint32_t slack;     // The firmware may be this much behind last_change
+    uint32_t quiet_end; // No edge before this, an accepted edge is still being read
+    uint8_t level;      // Pin
+    uint32_t clicks[STRESS_TOGGLE_MAX];
+    uint32_t click_count;
+} stress_reference_t;
+
+static void stress_click(const gesture_event_t *event, void *user)
+{
+    stress_reference_t *r = user;
+
+    if ((1 == event->count) && (r->click_count < STRESS_TOGGLE_MAX))
+    {
+        r->clicks[r->click_count++] = event->timestamp;
+    }
+}
+
+static void stress_reference_init(stress_reference_t *r, uint32_t now)
+{
+    const gesture_config_t config = {
+        .click_gap = ESWGPIO_CLICK_GAP_MS * STRESS_PER_MS,
+        .long_press = ESWGPIO_LONG_PRESS_MS * STRESS_PER_MS,
+        .repeat = ESWGPIO_HOLD_REPEAT_MS * STRESS_PER_MS,
+        .max_clicks = ESWGPIO_MAX_CLICKS};
+
+    memset(r, 0, sizeof(stress_reference_t));
+    debounce_init(&r->debounce, ESWGPIO_DEBOUNCE_MS * STRESS_PER_MS, 1, now);
+    gesture_init(&r->gesture, &config);
+    gesture_subscribe(&r->gesture, stress_click, r, GESTURE_MASK(GESTURE_CLICK));
+    r->now = now;
+    r->last_due = now - STRESS_LATE;
+    r->quiet_end = now;
+    r->level = 1;
+}
+
+// Handle the settle polls and gesture deadlines before until, as button_loop would.
+static void stress_reference_advance(stress_reference_t *r, uint32_t until)
+{
+    debounce_t *d = &r->debounce;
+
+    for (;;)
+    {
+        uint32_t remaining;
+        uint32_t next = until;
+        bool settle = false;
+
+        if (debounce_settling(d) && ((int32_t)(d->last_change + d->window - next) < 0))
+        {
+            next = d->last_change + d->window;
+            settle = true;
+        }
+        if (gesture_next_deadline(&r->gesture, r->now, &remaining) && ((int32_t)(r->now + remaining - next) < 0))
+        {
+            next = r->now + remaining;
+            settle = false;
+        }
+        if (next == until)
+        {
+            break;
+        }
+
+        r->now = next;
+        r->last_due = next;
+        if (settle)
+        {
+            if (debounce_poll(d, next, d->raw))
+            {
+                r->slack += d->window + STRESS_LATE;
+                gesture_edge(&r->gesture, 0, next, 0 == d->raw);
+            }
+        }
+        else
+        {
+            gesture_timeout(&r->gesture, next);
+        }
+    }
+    r->now = until;
+}
+
+// True if an edge to level at now would be decided the same way by the firmware.
+static bool stress_reference_clear(stress_reference_t *r, uint32_t now, uint8_t level)
+{
+    debounce_t *d = &r->debounce;
+    uint32_t remaining;
+
+    if ((level == r->level) || ((int32_t)(now - r->quiet_end) < 0) || (now - r->last_due < STRESS_LATE + r->slack))
+    {
+        return false;
+    }
+    // The end of the lockout, anywhere in [last_change, last_change + slack] + window for the firmware
+    if ((uint32_t)(now - (d->last_change + d->window) + STRESS_GUARD) < r->slack + 2 * STRESS_GUARD)
+    {
+        return false;
+    }
+    return !gesture_next_deadline(&r->gesture, now, &remaining) || (remaining > STRESS_GUARD);
+}
+
+static void stress_reference_edge(stress_reference_t *r, uint32_t now, uint8_t level)
+{
+    r->level = level;
+    if (debounce_edge(&r->debounce, now, level))
+    {
+        r->quiet_end = now + STRESS_GUARD;
+        r->slack = 0;
+        gesture_edge(&r->gesture, 0, now, 0 == level);
+    }
+}
+
+// __________________________________ Runs ___________________________________
+
+static void stress_run(uint32_t rate, bool last)
+{
+    static stress_reference_t ref;
+    host_irq_stats_t irq;
+    uint64_t start_ns = host_now_ns() + 1000000ULL;
+    uint64_t first_ns = 0;
+    uint64_t last_ns = 0;
+    uint32_t fired = 0;
+    uint32_t guarded = 0;
+    uint32_t toggles;
+    uint32_t matched = 0;
+    uint32_t worst = 0;
+    uint64_t total = 0;
+
+    stress_plan(rate, start_ns);
+
+    pthread_mutex_lock(&m_toggle_lock);
+    m_toggle_count = 0;
+    pthread_mutex_unlock(&m_toggle_lock);
+    host_irq_stats(GPIO_EVEN_IRQn, &irq, true);
+    stress_reference_init(&ref, host_cycles());
+
+    for (uint32_t i = 0; i < m_edge_count; i++)
+    {
+        uint32_t now;
+
+        stress_sleep_until(m_edges[i].at_ns);
+        now = host_cycles();
+        stress_reference_advance(&ref, now);
+        if (!stress_reference_clear(&ref, now, m_edges[i].level))
+        {
+            guarded += (m_edges[i].level != ref.level);
+            continue;
+        }
+        stress_reference_edge(&ref, now, m_edges[i].level);
+        host_gpio_input(gpioPortF, 4, m_edges[i].level);
+
+        last_ns = host_now_ns();
+        first_ns = (0 == fired) ? last_ns : first_ns;
+        fired++;
+    }
+
+    // Released for the rest, every gesture ends
+    while (0 == ref.level)
+    {
+        uint32_t now;
+
+        stress_sleep_until(host_now_ns() + STRESS_GUARD_NS);
+        now = host_cycles();
+        stress_reference_advance(&ref, now);
+        if (stress_reference_clear(&ref, now, 1))
+        {
+            stress_reference_edge(&ref, now, 1);
+            host_gpio_input(gpioPortF, 4, 1);
+            fired++;
+        }
+    }
+    stress_sleep_until(host_now_ns() + STRESS_QUIET_MS * 1000000ULL);
+    stress_reference_advance(&ref, host_cycles());
+    host_irq_stats(GPIO_EVEN_IRQn, &irq, true);
+
+    pthread_mutex_lock(&m_toggle_lock);
+    toggles = m_toggle_count;
+
+    // Each expected click is matched with the first transition after it
+    for (uint32_t i = 0, j = 0; (i < ref.click_count) && (j < toggles); i++)
+    {
+        while ((j < toggles) && ((int32_t)(m_toggles[j] - ref.clicks[i]) < 0))
+        {
+            j++;
+        }
+        if ((j < toggles) && ((i + 1 == ref.click_count) || ((int32_t)(m_toggles[j] - ref.clicks[i + 1]) < 0)))
+        {
+            uint32_t latency = m_toggles[j] - ref.clicks[i];
+
+            worst = (latency > worst) ? latency : worst;
+            total += latency;
+            matched++;
+            j++;
+        }
+    }
+    pthread_mutex_unlock(&m_toggle_lock);
+
+    fprintf(m_report, "    {\"rate_hz\": %" PRIu32 ", \"edges_planned\": %" PRIu32 ", \"edges_guarded\": %" PRIu32
+            ", \"edges_fired\": %" PRIu32 ", \"achieved_edge_rate_hz\": %.1f,\n",
+            rate, m_edge_count, guarded, fired,
+            (last_ns == first_ns) ? 0.0 : (fired - 1) * 1e9 / (last_ns - first_ns));
+    fprintf(m_report, "     \"irqs_raised\": %" PRIu32 ", \"irqs_delivered\": %" PRIu32 ", \"edge_loss_rate\": %.6f,"
+            " \"worst_irq_latency_us\": %.3f,\n",
+            irq.raised, irq.delivered, (0 == fired) ? 0.0 : 1.0 - (double)irq.delivered / fired, irq.worst_ns / 1000.0);
+    fprintf(m_report, "     \"debounced_edges\": %" PRIu32 ", \"expected_transitions\": %" PRIu32
+            ", \"transitions\": %" PRIu32 ", \"missed\": %" PRIu32 ", \"spurious\": %" PRIu32 ",\n",
+            ref.debounce.accepted, ref.click_count, toggles, ref.click_count - matched, toggles - matched);
+    if (0 != ref.click_count)
+    {
+        fprintf(m_report, "     \"loss_rate\": %.6f, ", (double)(ref.click_count - matched) / ref.click_count);
+    }
+    else
+    {
+        fprintf(m_report, "     \"loss_rate\": null, ");
+    }
+    if (0 != matched)
+    {
+        fprintf(m_report, "\"worst_latency_us\": %.3f, \"mean_latency_us\": %.3f}%s\n",
+                worst * 1e6 / HOST_CORE_CLOCK_HZ, total * 1e6 / HOST_CORE_CLOCK_HZ / matched, last ? "" : ",");
+    }
+    else
+    {
+        fprintf(m_report, "\"worst_latency_us\": null, \"mean_latency_us\": null}%s\n", last ? "" : ",");
+    }
+    fflush(m_report);
+}
+
+static void *stress_main(void *argument)
+{
+    stress_sleep_until(host_now_ns() + STRESS_BOOT_MS * 1000000ULL);
+
+    fprintf(m_report, "{\"seed\": %" PRIu32 ", \"seconds\": %" PRIu32 ", \"max_presses\": %" PRIu32
+            ", \"bounces\": %" PRIu32 ", \"bounce_us\": %" PRIu32 ", \"press_ms\": %" PRIu32 ",\n \"runs\": [\n",
+            m_seed, m_seconds, m_presses, m_bounces, m_bounce_us, m_press_ms);
+    for (uint32_t i = 0; i < m_rate_count; i++)
+    {
+        stress_run(m_rates[i], i + 1 == m_rate_count);
+    }
+    fprintf(m_report, " ]\n}\n");
+    fflush(m_report);
+    exit(0);
+    return NULL;
+}
+
+static bool stress_parse_rates(char *list)
+{
+    m_rate_count = 0;
+    for (char *tok = strtok(list, ","); NULL != tok; tok = strtok(NULL, ","))
+    {
+        unsigned long rate = strtoul(tok, NULL, 0);
+
+        if ((m_rate_count == STRESS_RATES_MAX) || (rate < 1) || (rate > 1000000))
+        {
+            return false;
+        }
+        m_rates[m_rate_count++] = rate;
+    }
+    return 0 != m_rate_count;
+}
+
+int main(int argc, char *argv[])
+{
+    char default_rates[] = "1,2,10,100,1000,10000,100000,1000000";
+    const char *report = NULL;
+    bool verbose = false;
+    pthread_t thread;
+    int opt;
+
+    host_init();
+    stress_parse_rates(default_rates);
+
+    while (-1 != (opt = getopt(argc, argv, "r:d:n:b:w:p:s:o:vh")))
+    {
+        switch (opt)
+        {
+            case 'r':
+                if (!stress_parse_rates(optarg))
+                {
+                    fprintf(stderr, "rates are 1 to 1000000 Hz, at most %u\n", STRESS_RATES_MAX);
+                    return 1;
+                }
+                break;
+            case 'd':
+                m_seconds = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                m_presses = strtoul(optarg, NULL, 0);
+                break;
+            case 'b':
+                m_bounces = strtoul(optarg, NULL, 0);
+                m_bounces = (m_bounces > 64) ? 64 : m_bounces;
+                break;
+            case 'w':
+                m_bounce_us = strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                m_press_ms = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                m_seed = strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                report = optarg;
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-r rates] [-d seconds] [-n presses] [-b bounces] [-w bounce_us]"
+                        " [-p press_ms] [-s seed] [-o report] [-v]\n", argv[0]);
+                return 'h' == opt ? 0 : 1;
+        }
+    }
+
+    // The report keeps stdout, the firmware output goes elsewhere
+    m_report = (NULL != report) ? fopen(report, "w") : fdopen(dup(STDOUT_FILENO), "w");
+    if (NULL == m_report)
+    {
+        perror((NULL != report) ? report : "stdout");
+        return 1;
+    }
+    if (verbose ? (-1 == dup2(STDERR_FILENO, STDOUT_FILENO)) : (NULL == freopen("/dev/null", "w", stdout)))
+    {
+        perror("stdout");
+        return 1;
+    }
+
+    srand(m_seed);
+    host_on_event_flags(stress_on_gate);
+    host_periph_start();
+    pthread_create(&thread, NULL, stress_main, NULL);
+    pthread_detach(thread);
+
+    return firmware_main();
+}
@@ -0,0 +1,64 @@
+/**
+ * @brief FreeRTOS task state query for the host build, see host/os.c.
+ *
+ * Run time counters are in host_cycles, the DWT rate. The stack high water
+ * mark is what the thread has used of its pthread stack, counted against
+ * the stack_size it was created with. x86-64 frames and glibc printf take
+ * several times the stack of the target, firmware threads show as full.
+ *
+ * The kernel tick is host time, a tickless idle has no tick to step.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef TASK_H_
+#define TASK_H_
+
+#include "FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+
+typedef enum
+{
+    eRunning,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted,
+    eInvalid
+} eTaskState;
+
+typedef struct xTASK_STATUS
+{
+    TaskHandle_t xHandle;
+    const char *pcTaskName;
+    UBaseType_t xTaskNumber;
+    eTaskState eCurrentState;
+    UBaseType_t uxCurrentPriority;
+    UBaseType_t uxBasePriority;
+    uint32_t ulRunTimeCounter;
+    StackType_t *pxStackBase;
+    configSTACK_DEPTH_TYPE usStackHighWaterMark; // Words never used
+} TaskStatus_t;
+
+typedef enum
+{
+    eAbortSleep,
+    eStandardSleep,
+    eNoTasksWaitingTimeout
+} eSleepModeStatus;
+
+// Fill in up to uxArraySize tasks, the idle loop included, 0 if they do not fit.
+UBaseType_t uxTaskGetSystemState(TaskStatus_t * const pxTaskStatusArray, const UBaseType_t uxArraySize,
+                                 uint32_t * const pulTotalRunTime);
+
+// In vPortSuppressTicksAndSleep, eAbortSleep if a thread became ready.
+eSleepModeStatus eTaskConfirmSleepModeStatus(void);
+
+// Account for ticks slept, nothing to do on the host.
+void vTaskStepTick(TickType_t xTicksToJump);
+
+// Provided by the firmware for configUSE_TICKLESS_IDLE 2, the idle loop calls it.
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime);
+
+#endif//TASK_H_
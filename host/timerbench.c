@@ -0,0 +1,253 @@
+/**
+ * @brief Timer service benchmark, periodic pin toggles as one thread each
+ * against one timer each on the timer service of swtimer.c.
+ *
+ *   esw-gpio-timerbench [-n counts] [-t seconds] [-o report]
+ *
+ * For each count of periodic toggles, 2,8,32,128,512 by default, both
+ * designs run for -t seconds of virtual time, 60 by default, each in a
+ * forked process with a fresh kernel. Thread number i sleeps with osDelay
+ * and toggles PA0 every BENCH_PERIODS[i % 8] ticks, the first two are the
+ * buzzer tones of main.c. The timer design runs the same periods as
+ * periodic timers with the dispatch thread of swtimer.c at osPriorityHigh.
+ *
+ * The JSON report has per count and design the toggles made, the context
+ * switches (the CPU handed to a thread, from idle or another thread), the
+ * switches per toggle and the RAM the design reserves: a BENCH_STACK stack
+ * and a control block per thread, or a timer per toggle plus the wheel and
+ * the dispatch thread. Sizes are those of this build, pointers are twice
+ * as wide as on the device. Both designs must make the same toggles, a
+ * mismatch is reported as an error.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "host.h"
+#include "em_gpio.h"
+#include "cmsis_os2.h"
+#include "FreeRTOS.h"
+
+#include "../sleep.h"
+#include "../swtimer.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define BENCH_COUNTS_MAX     16
+#define BENCH_TIMERS_MAX     4096
+#define BENCH_STACK          1024 // Stack of a buzzer thread in main.c, bytes
+#define BENCH_DISPATCH_STACK 768  // Stack of the timers thread in main.c, bytes
+
+// Buzzer tone periods of main.c first, ticks
+static const uint32_t BENCH_PERIODS[] = {70, 40, 25, 33, 100, 57, 250, 13};
+
+typedef enum bench_design
+{
+    BENCH_THREADS,
+    BENCH_TIMERS
+} bench_design_t;
+
+typedef struct bench_result
+{
+    uint32_t toggles;
+    uint32_t switches;
+    uint32_t ram;
+} bench_result_t;
+
+static uint32_t m_counts[BENCH_COUNTS_MAX];
+static uint32_t m_count_count;
+static uint32_t m_seconds = 60;
+
+// Child process state
+static int m_pipe = -1;
+static uint32_t m_toggles;
+static uint32_t m_ram;
+static swtimer_t m_timers[BENCH_TIMERS_MAX];
+
+static uint32_t bench_period(uint32_t i)
+{
+    return BENCH_PERIODS[i % (sizeof(BENCH_PERIODS) / sizeof(BENCH_PERIODS[0]))];
+}
+
+static void bench_toggle(void *user)
+{
+    GPIO_PinOutToggle(gpioPortA, 0);
+    m_toggles++;
+}
+
+static void bench_thread(void *argument)
+{
+    uint32_t period = (uint32_t)(uintptr_t)argument;
+
+    for (;;)
+    {
+        osDelay(period);
+        bench_toggle(NULL);
+    }
+}
+
+// The simulation ends with exit, the counts go to the parent from here
+static void bench_report(void)
+{
+    bench_result_t r = {.toggles = m_toggles, .switches = host_switch_count(), .ram = m_ram};
+
+    if (sizeof(r) != write(m_pipe, &r, sizeof(r)))
+    {
+        perror("pipe");
+    }
+}
+
+static void bench_child(bench_design_t design, uint32_t count)
+{
+    host_init();
+    host_sim_enable(m_seconds * 1000000000ULL);
+    osKernelInitialize();
+    sleep_init();
+    GPIO_PinModeSet(gpioPortA, 0, gpioModePushPull, 0);
+
+    if (BENCH_THREADS == design)
+    {
+        const osThreadAttr_t attr = {.name = "tone", .priority = osPriorityNormal};
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            osThreadNew(bench_thread, (void *)(uintptr_t)bench_period(i), &attr);
+        }
+        m_ram = count * (BENCH_STACK + sizeof(StaticTask_t));
+    }
+    else
+    {
+        const osThreadAttr_t attr = {.name = "timers", .priority = osPriorityHigh};
+
+        osThreadNew(swtimer_loop, NULL, &attr);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            swtimer_setup(&m_timers[i], bench_toggle, NULL);
+            swtimer_start(&m_timers[i], bench_period(i), bench_period(i));
+        }
+        m_ram = count * sizeof(swtimer_t) + SWTIMER_LEVELS * SWTIMER_SLOTS * sizeof(swtimer_t *)
+                + BENCH_DISPATCH_STACK + sizeof(StaticTask_t);
+    }
+
+    atexit(bench_report);
+    osKernelStart();
+}
+
+static bool bench_run(bench_design_t design, uint32_t count, bench_result_t *r)
+{
+    int fds[2];
+    int status;
+    pid_t pid;
+
+    fflush(NULL);
+    if ((0 != pipe(fds)) || (-1 == (pid = fork())))
+    {
+        perror("fork");
+        return false;
+    }
+    if (0 == pid)
+    {
+        close(fds[0]);
+        m_pipe = fds[1];
+        bench_child(design, count);
+        _exit(1);
+    }
+
+    close(fds[1]);
+    bool ok = (sizeof(*r) == read(fds[0], r, sizeof(*r)));
+    close(fds[0]);
+    waitpid(pid, &status, 0);
+    return ok && WIFEXITED(status) && (0 == WEXITSTATUS(status));
+}
+
+static bool bench_parse_counts(char *list)
+{
+    m_count_count = 0;
+    for (char *tok = strtok(list, ","); NULL != tok; tok = strtok(NULL, ","))
+    {
+        unsigned long count = strtoul(tok, NULL, 0);
+
+        if ((m_count_count == BENCH_COUNTS_MAX) || (count < 1) || (count > BENCH_TIMERS_MAX))
+        {
+            return false;
+        }
+        m_counts[m_count_count++] = count;
+    }
+    return 0 != m_count_count;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char * const names[] = {"threads", "timers"};
+    char default_counts[] = "2,8,32,128,512";
+    const char *path = NULL;
+    FILE *report = stdout;
+    bool failed = false;
+    int opt;
+
+    bench_parse_counts(default_counts);
+
+    while (-1 != (opt = getopt(argc, argv, "n:t:o:h")))
+    {
+        switch (opt)
+        {
+            case 'n':
+                if (!bench_parse_counts(optarg))
+                {
+                    fprintf(stderr, "counts are 1 to %u, at most %u\n", BENCH_TIMERS_MAX, BENCH_COUNTS_MAX);
+                    return 1;
+                }
+                break;
+            case 't':
+                m_seconds = strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                path = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n counts] [-t seconds] [-o report]\n", argv[0]);
+                return 'h' == opt ? 0 : 1;
+        }
+    }
+
+    if ((NULL != path) && (NULL == (report = fopen(path, "w"))))
+    {
+        perror(path);
+        return 1;
+    }
+
+    fprintf(report, "{\"seconds\": %" PRIu32 ",\n \"runs\": [\n", m_seconds);
+    for (uint32_t i = 0; i < m_count_count; i++)
+    {
+        bench_result_t r[2];
+
+        for (uint32_t d = BENCH_THREADS; d <= BENCH_TIMERS; d++)
+        {
+            if (!bench_run((bench_design_t)d, m_counts[i], &r[d]))
+            {
+                fprintf(stderr, "%s %" PRIu32 " failed\n", names[d], m_counts[i]);
+                return 1;
+            }
+            fprintf(report, "    {\"count\": %" PRIu32 ", \"design\": \"%s\", \"toggles\": %" PRIu32
+                    ", \"switches\": %" PRIu32 ", \"switches_per_toggle\": %.3f, \"ram_bytes\": %" PRIu32 "}%s\n",
+                    m_counts[i], names[d], r[d].toggles, r[d].switches,
+                    (0 == r[d].toggles) ? 0.0 : (double)r[d].switches / r[d].toggles, r[d].ram,
+                    ((i + 1 == m_count_count) && (BENCH_TIMERS == d)) ? "" : ",");
+        }
+        if (r[BENCH_THREADS].toggles != r[BENCH_TIMERS].toggles)
+        {
+            fprintf(stderr, "%" PRIu32 ": threads toggled %" PRIu32 " times, timers %" PRIu32 "\n",
+                    m_counts[i], r[BENCH_THREADS].toggles, r[BENCH_TIMERS].toggles);
+            failed = true;
+        }
+    }
+    fprintf(report, " ]\n}\n");
+    fclose(report);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,235 @@
+/**
+ * @brief Tone test, the TIMER0 registers tone.c programs for a frequency on
+ * the TIMER model of em.c.
+ *
+ *   esw-gpio-tonetest [-v]
+ *
+ * Each case starts a tone and checks the prescaler, TOP and CC0 against
+ * values worked out by hand for the 38.4 MHz HFXO of the host, along with
+ * the frequency tone_frequency reports. A change that keeps the prescaler
+ * must go to the buffers and leave the timer running, TOP and CC0 taking
+ * the new values at the next overflow and not a nanosecond before, one
+ * that does not must restart it. A change buffered before a stop must not
+ * latch over the next tone. Frequencies out of range must be refused and the stop
+ * must leave the pin low and unrouted. -v prints every case. Exits 1 on
+ * any mismatch.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../tone.h"
+#include "host.h"
+#include "em_gpio.h"
+#include "em_timer.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <unistd.h>
+
+typedef struct test_tone
+{
+    uint32_t freq_hz;
+    uint32_t prescale; // Exponent, timerPrescale1 is 0
+    uint32_t top;
+    uint32_t cc;
+    uint32_t produced; // What tone_frequency must report, Hz
+} test_tone_t;
+
+// 38400000 / (2^prescale * freq_hz) counts, TOP one less, CC0 half of the counts
+static const test_tone_t TEST_TONES[] = {
+    {20, 5, 59999, 30000, 20},    // Lowest, prescaled to fit
+    {25, 5, 47999, 24000, 25},
+    {440, 1, 43635, 21818, 440},  // A4
+    {585, 1, 32819, 16410, 585},  // 65640 counts, just over 16 bits
+    {587, 0, 65416, 32708, 587},  // 65417 counts, just under
+    {1000, 0, 38399, 19200, 1000},
+    {3000, 0, 12799, 6400, 3000},
+    {7000, 0, 5484, 2742, 7000},  // 5485.7 counts, rounded down
+    {20000, 0, 1919, 960, 20000}, // Highest
+};
+
+static const uint32_t TEST_REFUSED[] = {0, 19, 20001, 1000000};
+
+static bool m_verbose;
+
+static bool test_report(bool ok, const char *name, uint32_t freq_hz)
+{
+    uint32_t prescale = (TIMER0->CTRL & _TIMER_CTRL_PRESC_MASK) >> _TIMER_CTRL_PRESC_SHIFT;
+
+    if (!ok || m_verbose)
+    {
+        fprintf(ok ? stdout : stderr,
+                "%s %s %" PRIu32 " Hz: prescale %" PRIu32 " top %" PRIu32 " topb %" PRIu32 " cc %" PRIu32
+                " ccb %" PRIu32 " running %d routed %d produced %" PRIu32 "\n",
+                ok ? "ok" : "FAIL", name, freq_hz, prescale, TIMER0->TOP, TIMER0->TOPB, TIMER0->CC[0].CCV,
+                TIMER0->CC[0].CCVB,
+                0 != (TIMER0->STATUS & TIMER_STATUS_RUNNING), 0 != (TIMER0->ROUTEPEN & TIMER_ROUTEPEN_CC0PEN),
+                tone_frequency());
+    }
+    return ok;
+}
+
+// Period of a tone of t in ns, as the TIMER model of em.c works it out
+static uint64_t test_period_ns(const test_tone_t *t)
+{
+    return ((uint64_t)(t->top + 1) << t->prescale) * 1000000000ULL / HOST_CORE_CLOCK_HZ;
+}
+
+// Arms the overflow of a timer just started, a period from now
+static void test_overflow_arm(void)
+{
+    host_periph_advance(host_now_ns());
+}
+
+// The registers of a running tone of t, counting with the TOP and CC0 of shown
+static bool test_counting(const test_tone_t *t, const test_tone_t *shown)
+{
+    return (t->prescale == (TIMER0->CTRL & _TIMER_CTRL_PRESC_MASK) >> _TIMER_CTRL_PRESC_SHIFT)
+           && (shown->top == TIMER0->TOP) && (shown->cc == TIMER0->CC[0].CCV)
+           && (0 != (TIMER0->STATUS & TIMER_STATUS_RUNNING)) && (0 != (TIMER0->ROUTEPEN & TIMER_ROUTEPEN_CC0PEN))
+           && tone_active() && (t->produced == tone_frequency());
+}
+
+static bool test_registers(const test_tone_t *t)
+{
+    return test_counting(t, t);
+}
+
+static bool test_start(const test_tone_t *t)
+{
+    bool ok = tone_start(t->freq_hz) && test_registers(t) && (0 == TIMER0->CNT);
+
+    ok = test_report(ok, "start", t->freq_hz);
+    tone_stop();
+    return ok;
+}
+
+// Same prescaler, through the buffers without a restart, latched at the overflow
+static bool test_buffered(const test_tone_t *from, const test_tone_t *to)
+{
+    uint64_t overflow_ns;
+    bool ok;
+
+    tone_start(from->freq_hz);
+    test_overflow_arm();
+    overflow_ns = host_now_ns() + test_period_ns(from);
+    TIMER0->CNT = 1234; // Where the running timer might be
+    ok = tone_set_frequency(to->freq_hz) && test_counting(to, from) && (to->top == TIMER0->TOPB)
+         && (to->cc == TIMER0->CC[0].CCVB) && (1234 == TIMER0->CNT);
+    host_periph_advance(overflow_ns - 1);
+    ok = ok && test_counting(to, from);
+    host_periph_advance(overflow_ns);
+    ok = ok && test_registers(to);
+    ok = test_report(ok, "buffered change to", to->freq_hz);
+    tone_stop();
+    return ok;
+}
+
+// A buffered change, a stop and a start of another tone, which must keep its values past the overflow
+static bool test_stale(const test_tone_t *from, const test_tone_t *to, const test_tone_t *next)
+{
+    bool ok;
+
+    tone_start(from->freq_hz);
+    tone_set_frequency(to->freq_hz);
+    tone_stop();
+    ok = tone_start(next->freq_hz) && test_registers(next);
+    test_overflow_arm();
+    host_periph_advance(host_now_ns() + test_period_ns(next));
+    ok = ok && test_registers(next);
+    ok = test_report(ok, "stale buffers, then start", next->freq_hz);
+    tone_stop();
+    return ok;
+}
+
+// Another prescaler, restarted from 0
+static bool test_restart(const test_tone_t *from, const test_tone_t *to)
+{
+    bool ok;
+
+    tone_start(from->freq_hz);
+    TIMER0->CNT = 1234;
+    ok = tone_set_frequency(to->freq_hz) && test_registers(to) && (0 == TIMER0->CNT);
+    ok = test_report(ok, "restarted change to", to->freq_hz);
+    tone_stop();
+    return ok;
+}
+
+static bool test_refused(uint32_t freq_hz)
+{
+    bool ok;
+
+    ok = !tone_start(freq_hz) && !tone_active();
+    tone_start(1000);
+    ok = ok && !tone_set_frequency(freq_hz) && (1000 == tone_frequency()) && (38399 == TIMER0->TOP);
+    ok = test_report(ok, "refused", freq_hz);
+    tone_stop();
+    return ok;
+}
+
+static bool test_stop(void)
+{
+    bool ok;
+
+    tone_start(440);
+    GPIO_PinOutSet(gpioPortA, 0);
+    tone_stop();
+    ok = !tone_active() && (0 == (TIMER0->STATUS & TIMER_STATUS_RUNNING))
+         && (0 == (TIMER0->ROUTEPEN & TIMER_ROUTEPEN_CC0PEN)) && (0 == host_gpio_level(gpioPortA, 0))
+         && !tone_set_frequency(440);
+    return test_report(ok, "stopped, then change to", 440);
+}
+
+int main(int argc, char *argv[])
+{
+    const uint32_t tones = sizeof(TEST_TONES) / sizeof(TEST_TONES[0]);
+    uint32_t failed = 0;
+    uint32_t count = 0;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "vh")))
+    {
+        if ('v' != opt)
+        {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 'h' == opt ? 0 : 1;
+        }
+        m_verbose = true;
+    }
+
+    host_init();
+    host_sim_enable(UINT64_MAX); // Virtual time, so overflows come exactly when advanced to
+    tone_init();
+    if ((timerCCModePWM != TIMER0->CC[0].CTRL) || (TIMER_ROUTELOC0_CC0LOC_LOC0 != TIMER0->ROUTELOC0))
+    {
+        fprintf(stderr, "FAIL init: CC0 mode %" PRIu32 " location %" PRIu32 "\n", TIMER0->CC[0].CTRL,
+                TIMER0->ROUTELOC0);
+        failed++;
+    }
+    count++;
+
+    for (uint32_t i = 0; i < tones; i++, count++)
+    {
+        failed += test_start(&TEST_TONES[i]) ? 0 : 1;
+    }
+
+    // 1000 Hz to 3000 Hz keeps timerPrescale1, 587 Hz to 585 Hz does not
+    failed += test_buffered(&TEST_TONES[5], &TEST_TONES[6]) ? 0 : 1;
+    failed += test_buffered(&TEST_TONES[6], &TEST_TONES[tones - 1]) ? 0 : 1;
+    failed += test_restart(&TEST_TONES[4], &TEST_TONES[3]) ? 0 : 1;
+    failed += test_restart(&TEST_TONES[2], &TEST_TONES[0]) ? 0 : 1;
+    failed += test_stale(&TEST_TONES[5], &TEST_TONES[6], &TEST_TONES[7]) ? 0 : 1;
+    count += 5;
+
+    for (uint32_t i = 0; i < sizeof(TEST_REFUSED) / sizeof(TEST_REFUSED[0]); i++, count++)
+    {
+        failed += test_refused(TEST_REFUSED[i]) ? 0 : 1;
+    }
+    failed += test_stop() ? 0 : 1;
+    count++;
+
+    printf("tone: %" PRIu32 " of %" PRIu32 " cases failed\n", failed, count);
+    return (0 == failed) ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+/**
+ * @brief Event trace of the host build, see host.h.
+ *
+ * One line per event, time in ns, RTOS tick, kind and subject:
+ *
+ *   70000000 70 run BUZZER_thread_attr
+ *   70000000 70 pin PA0 1
+ *   1500000000 1500 input PF4 0
+ *   1500000000 1500 irq 10
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "host.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+static FILE *m_trace;
+
+bool host_trace_open(const char *path)
+{
+    m_trace = fopen(path, "w");
+    if (NULL == m_trace)
+    {
+        perror(path);
+    }
+    return NULL != m_trace;
+}
+
+void host_trace_close(void)
+{
+    if (NULL != m_trace)
+    {
+        fclose(m_trace);
+        m_trace = NULL;
+    }
+}
+
+void host_trace(const char *kind, const char *fmt, ...)
+{
+    if (NULL != m_trace)
+    {
+        uint64_t ns = host_now_ns();
+        va_list args;
+
+        flockfile(m_trace);
+        fprintf(m_trace, "%" PRIu64 " %" PRIu64 " %s ", ns, (uint64_t)(ns / (1000000000ULL / HOST_TICK_FREQ)), kind);
+        va_start(args, fmt);
+        vfprintf(m_trace, fmt, args);
+        va_end(args);
+        fputc('\n', m_trace);
+        funlockfile(m_trace);
+    }
+}
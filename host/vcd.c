@@ -0,0 +1,95 @@
+/**
+ * @brief VCD of every pin change in the GPIO model, see host.h.
+ *
+ * Unlike the firmware recorder in pinrec.c this sees the pins driven by the
+ * LDMA as well, and the inputs as host_gpio_input drives them. Changes are
+ * streamed to a temporary file, the header with the pins that did change
+ * and then the changes are written to the VCD at exit, so memory use does
+ * not grow with the length of the run.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "host.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static pthread_mutex_t m_vcd_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE *m_vcd;
+static FILE *m_body;
+static uint16_t m_seen[GPIO_PORT_COUNT];
+static uint64_t m_last_ns = UINT64_MAX;
+
+static void host_vcd_close(void)
+{
+    char buf[4096];
+    size_t len;
+
+    pthread_mutex_lock(&m_vcd_lock);
+    fprintf(m_vcd, "$version esw-gpio-host $end\n$timescale 1 ns $end\n$scope module gpio $end\n");
+    for (uint8_t port = 0; port < GPIO_PORT_COUNT; port++)
+    {
+        for (uint8_t pin = 0; pin < 16; pin++)
+        {
+            if (m_seen[port] & (1U << pin))
+            {
+                fprintf(m_vcd, "$var wire 1 %c%X P%c%u $end\n", 'A' + port, pin, 'A' + port, pin);
+            }
+        }
+    }
+    fprintf(m_vcd, "$upscope $end\n$enddefinitions $end\n");
+
+    rewind(m_body);
+    while (0 != (len = fread(buf, 1, sizeof(buf), m_body)))
+    {
+        fwrite(buf, 1, len, m_vcd);
+    }
+    fclose(m_body);
+    fclose(m_vcd);
+    m_vcd = NULL;
+    pthread_mutex_unlock(&m_vcd_lock);
+}
+
+bool host_vcd_open(const char *path)
+{
+    m_vcd = fopen(path, "w");
+    if (NULL == m_vcd)
+    {
+        perror(path);
+        return false;
+    }
+    m_body = tmpfile();
+    if (NULL == m_body)
+    {
+        perror("tmpfile");
+        fclose(m_vcd);
+        m_vcd = NULL;
+        return false;
+    }
+    atexit(host_vcd_close);
+    return true;
+}
+
+void host_vcd_pin(uint8_t port, uint8_t pin, uint8_t level)
+{
+    uint64_t ns;
+
+    pthread_mutex_lock(&m_vcd_lock);
+    if (NULL != m_vcd)
+    {
+        ns = host_now_ns();
+        if (ns != m_last_ns)
+        {
+            fprintf(m_body, "#%" PRIu64 "\n", ns);
+            m_last_ns = ns;
+        }
+        fprintf(m_body, "%u%c%X\n", level, 'A' + port, pin);
+        m_seen[port] |= 1U << pin;
+    }
+    pthread_mutex_unlock(&m_vcd_lock);
+}
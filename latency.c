@@ -0,0 +1,120 @@
+/**
+ * @brief Interrupt-to-thread latency instrumentation, see latency.h.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "latency.h"
+
+#if ESWGPIO_LATENCY_TRACE
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "em_core.h"
+
+#include "loglevels.h"
+#define __MODUUL__ "lat"
+#define __LOG_LEVEL__ LOG_MODULE_LEVEL(latency)
+#include "log.h"
+
+volatile uint32_t latency_irq_stamp;
+
+static volatile uint32_t m_set_irq; // IRQ stamp of the interrupt that set the flag
+static volatile uint32_t m_set;
+static volatile bool m_armed;
+
+static latency_histogram_t m_hist[LATENCY_PATHS];
+
+static const char * const m_names[LATENCY_PATHS] = {"irq->set", "set->wake", "irq->wake"};
+
+static void latency_add(latency_histogram_t *h, uint32_t cycles)
+{
+    uint32_t bucket = (0 == cycles) ? 0 : 32 - __CLZ(cycles);
+
+    if (bucket >= LATENCY_BUCKETS)
+    {
+        bucket = LATENCY_BUCKETS - 1;
+    }
+    h->buckets[bucket]++;
+    h->count++;
+    if (cycles > h->max)
+    {
+        h->max = cycles;
+    }
+}
+
+void latency_init(void)
+{
+    // Not reset, the kernel run time stats count on it too, see prof.h
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    for (uint8_t p = 0; p < LATENCY_PATHS; p++)
+    {
+        m_hist[p] = (latency_histogram_t){0};
+    }
+    m_armed = false;
+    CORE_EXIT_ATOMIC();
+}
+
+void latency_flag_set(void)
+{
+    m_set_irq = latency_irq_stamp;
+    m_set = DWT->CYCCNT;
+    m_armed = true;
+}
+
+void latency_thread_wake(void)
+{
+    uint32_t wake = DWT->CYCCNT;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    if (m_armed)
+    {
+        m_armed = false;
+        latency_add(&m_hist[LATENCY_IRQ_TO_SET], m_set - m_set_irq);
+        latency_add(&m_hist[LATENCY_SET_TO_WAKE], wake - m_set);
+        latency_add(&m_hist[LATENCY_IRQ_TO_WAKE], wake - m_set_irq);
+    }
+    CORE_EXIT_ATOMIC();
+}
+
+void latency_get(latency_path_t path, latency_histogram_t *out)
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    *out = m_hist[path];
+    CORE_EXIT_ATOMIC();
+}
+
+void latency_dump(void)
+{
+    latency_histogram_t h;
+    char line[160];
+
+    for (uint8_t p = 0; p < LATENCY_PATHS; p++)
+    {
+        int len;
+
+        latency_get((latency_path_t)p, &h);
+        len = snprintf(line, sizeof(line), "%s n=%" PRIu32 " max=%" PRIu32 " |",
+                       m_names[p], h.count, h.max);
+
+        // Only non-empty buckets, as <2^n:count
+        for (uint8_t b = 0; (b < LATENCY_BUCKETS) && (len > 0) && (len < (int)sizeof(line)); b++)
+        {
+            if (0 != h.buckets[b])
+            {
+                len += snprintf(&line[len], sizeof(line) - len, " <2^%u:%" PRIu32, b, h.buckets[b]);
+            }
+        }
+        info1("%s", line);
+    }
+}
+
+#endif//ESWGPIO_LATENCY_TRACE
@@ -0,0 +1,77 @@
+/**
+ * @brief Interrupt-to-thread latency instrumentation on the DWT cycle counter.
+ *
+ * Three stamps are taken on the button path: GPIO interrupt entry, the
+ * osThreadFlagsSet that wakes the thread, and the return from
+ * osThreadFlagsWait in the thread. Each wake adds the intervals
+ * irq->set, set->wake and irq->wake to log2 histograms (bucket n counts
+ * intervals of 2^(n-1) .. 2^n - 1 cycles), which latency_dump prints.
+ *
+ * A stamp is one load and one store, so the instrumentation is meant to
+ * stay enabled. Building with LATENCY_TRACE=0 compiles the stamps out.
+ * When several interrupts arrive before the thread runs, the wake is
+ * attributed to the interrupt that set the flag last.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdint.h>
+
+#include "em_device.h"
+
+#define LATENCY_BUCKETS 32
+
+typedef enum latency_path
+{
+    LATENCY_IRQ_TO_SET,
+    LATENCY_SET_TO_WAKE,
+    LATENCY_IRQ_TO_WAKE,
+    LATENCY_PATHS
+} latency_path_t;
+
+typedef struct latency_histogram
+{
+    uint32_t buckets[LATENCY_BUCKETS];
+    uint32_t count;
+    uint32_t max;
+} latency_histogram_t;
+
+#if ESWGPIO_LATENCY_TRACE
+
+extern volatile uint32_t latency_irq_stamp;
+
+// Start the DWT cycle counter and clear the histograms.
+void latency_init(void);
+
+// First thing in the interrupt handler.
+static inline void latency_irq_entry(void)
+{
+    latency_irq_stamp = DWT->CYCCNT;
+}
+
+// Right before osThreadFlagsSet, in the same interrupt.
+void latency_flag_set(void);
+
+// Right after osThreadFlagsWait returns with the flag.
+void latency_thread_wake(void);
+
+// Copy one histogram out, for example for a heartbeat record.
+void latency_get(latency_path_t path, latency_histogram_t *out);
+
+// Print all histograms to the log.
+void latency_dump(void);
+
+#else
+
+static inline void latency_init(void) {}
+static inline void latency_irq_entry(void) {}
+static inline void latency_flag_set(void) {}
+static inline void latency_thread_wake(void) {}
+static inline void latency_dump(void) {}
+
+#endif//ESWGPIO_LATENCY_TRACE
+
+#endif//LATENCY_H_
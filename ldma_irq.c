@@ -0,0 +1,101 @@
+/**
+ * @brief Dispatch table for the LDMA channel done interrupts, see ldma_irq.h.
+ *
+ * LDMA_Init resets every channel, so it runs once for all owners instead of
+ * once per owner, and no owner goes on before it is done.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "ldma_irq.h"
+
+#include "em_cmu.h"
+#include "em_core.h"
+#include "em_ldma.h"
+
+typedef struct ldma_irq_entry
+{
+    ldma_irq_handler_f handler;
+    void *context;
+} ldma_irq_entry_t;
+
+static ldma_irq_entry_t m_table[LDMA_IRQ_CHANNELS];
+static volatile uint32_t m_spurious;
+static bool m_initialized;
+
+void ldma_irq_init(void)
+{
+    LDMA_Init_t init = LDMA_INIT_DEFAULT;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    if (!m_initialized)
+    {
+        CMU_ClockEnable(cmuClock_LDMA, true);
+        LDMA_Init(&init);
+        m_initialized = true;
+    }
+    CORE_EXIT_ATOMIC();
+}
+
+bool ldma_irq_register(uint8_t ch, ldma_irq_handler_f handler, void *context)
+{
+    bool ok = false;
+
+    if ((ch >= LDMA_IRQ_CHANNELS) || (NULL == handler))
+    {
+        return false;
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    if (NULL == m_table[ch].handler)
+    {
+        m_table[ch].context = context;
+        m_table[ch].handler = handler;
+        ok = true;
+    }
+    CORE_EXIT_ATOMIC();
+    return ok;
+}
+
+void ldma_irq_unregister(uint8_t ch)
+{
+    if (ch < LDMA_IRQ_CHANNELS)
+    {
+        LDMA_IntDisable(1UL << ch);
+
+        CORE_DECLARE_IRQ_STATE;
+        CORE_ENTER_ATOMIC();
+        m_table[ch].handler = NULL;
+        m_table[ch].context = NULL;
+        CORE_EXIT_ATOMIC();
+    }
+}
+
+uint32_t ldma_irq_spurious(void)
+{
+    return m_spurious;
+}
+
+void LDMA_IRQHandler(void)
+{
+    uint32_t pending = LDMA_IntGetEnabled() & ((1UL << LDMA_IRQ_CHANNELS) - 1);
+
+    LDMA_IntClear(pending);
+    while (0 != pending)
+    {
+        uint8_t ch = 31 - __CLZ(pending);
+        ldma_irq_entry_t *e = &m_table[ch];
+
+        pending &= ~(1UL << ch);
+        if (NULL != e->handler)
+        {
+            e->handler(ch, e->context);
+        }
+        else
+        {
+            m_spurious++;
+        }
+    }
+}
@@ -0,0 +1,34 @@
+/**
+ * @brief Dispatch table for the LDMA channel done interrupts.
+ *
+ * LDMA_IRQHandler is defined here and calls the handler of every pending
+ * channel, so the buzzer playback and the log sink can each own a channel
+ * without knowing about each other. Like exti.h, registering installs the
+ * handler only, enabling the channel interrupt stays with the owner.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef LDMA_IRQ_H_
+#define LDMA_IRQ_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LDMA_IRQ_CHANNELS 8
+
+// Called in interrupt context with the channel flag already cleared.
+typedef void (*ldma_irq_handler_f)(uint8_t ch, void *context);
+
+// Enable the LDMA clock and initialize the LDMA, only the first call does anything.
+void ldma_irq_init(void);
+
+// Install handler for channel ch, false if taken.
+bool ldma_irq_register(uint8_t ch, ldma_irq_handler_f handler, void *context);
+
+void ldma_irq_unregister(uint8_t ch);
+
+// Pending channels that had no handler installed.
+uint32_t ldma_irq_spurious(void);
+
+#endif//LDMA_IRQ_H_
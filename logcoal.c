@@ -0,0 +1,219 @@
+/**
+ * @brief Coalescing of repeated log lines, see logcoal.h.
+ *
+ * The table is updated with interrupts masked, the lines go to the output
+ * after that, a summary before the line that caused it.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "logcoal.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "cmsis_os2.h"
+#include "em_core.h"
+
+#define LOGCOAL_MASK       (LOGCOAL_SITES - 1)
+#define LOGCOAL_STAMP_MAX  16 // "HH:MM:SS.mmm " and some slack
+#define LOGCOAL_SUMMARY    (LOGCOAL_STAMP_MAX + LOGCOAL_SITE_MAX + 32)
+
+typedef struct logcoal_site
+{
+    uint32_t hash;  // Call site field hash
+    uint32_t text;  // Text hash of the last line
+    uint16_t text_len;
+    uint8_t site_len; // 0 for a free entry
+    char site[LOGCOAL_SITE_MAX];
+    uint32_t count; // Repeats not written out
+    uint32_t first; // ms of the first counted repeat
+    uint32_t last;  // ms of the last line
+} logcoal_site_t;
+
+typedef struct logcoal_summary
+{
+    uint32_t count;
+    uint32_t span;
+    uint8_t site_len;
+    char site[LOGCOAL_SITE_MAX];
+} logcoal_summary_t;
+
+static logcoal_site_t m_sites[LOGCOAL_SITES];
+static uint32_t m_window;
+static logcoal_output_f m_output;
+
+void logcoal_init(uint32_t window_ms, logcoal_output_f output)
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    memset(m_sites, 0, sizeof(m_sites));
+    m_window = window_ms;
+    m_output = output;
+    CORE_EXIT_ATOMIC();
+}
+
+void logcoal_set_window(uint32_t window_ms)
+{
+    m_window = window_ms;
+}
+
+static uint32_t logcoal_now(void)
+{
+    return (uint32_t)((uint64_t)osKernelGetTickCount() * 1000 / osKernelGetTickFreq());
+}
+
+// FNV-1a
+static uint32_t logcoal_hash(const char *ptr, uint32_t len)
+{
+    uint32_t h = 2166136261UL;
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        h = (h ^ (uint8_t)ptr[i]) * 16777619UL;
+    }
+    return h;
+}
+
+// Length of the call site field at ptr, "I|main: 332|", 0 if there is none.
+static uint32_t logcoal_site_len(const char *ptr, uint32_t len)
+{
+    if ((len < 3) || ('|' != ptr[1]))
+    {
+        return 0;
+    }
+    for (uint32_t i = 2; (i < len) && (i < LOGCOAL_SITE_MAX); i++)
+    {
+        if ('|' == ptr[i])
+        {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// Move the pending count of e into s, called with interrupts masked.
+static void logcoal_take(logcoal_site_t *e, logcoal_summary_t *s)
+{
+    s->count = e->count;
+    if (0 != e->count)
+    {
+        s->span = e->last - e->first;
+        s->site_len = e->site_len;
+        memcpy(s->site, e->site, e->site_len);
+        e->count = 0;
+    }
+}
+
+static void logcoal_emit(const logcoal_summary_t *s, uint32_t now)
+{
+    char line[LOGCOAL_SUMMARY];
+    int len;
+
+    if (0 == s->count)
+    {
+        return;
+    }
+    len = snprintf(line, sizeof(line), "%02u:%02u:%02u.%03u %.*sx %" PRIu32 " in %" PRIu32 " ms\n",
+                   (unsigned)(now / 3600000 % 100), (unsigned)(now / 60000 % 60),
+                   (unsigned)(now / 1000 % 60), (unsigned)(now % 1000),
+                   (int)s->site_len, s->site, s->count, s->span);
+    if (len > (int)sizeof(line) - 1)
+    {
+        len = sizeof(line) - 1;
+    }
+    m_output(line, len);
+}
+
+int logcoal_write(const char *ptr, int len)
+{
+    logcoal_summary_t summary = {.count = 0};
+    const char *stamp_end = memchr(ptr, ' ', (len < LOGCOAL_STAMP_MAX) ? len : LOGCOAL_STAMP_MAX);
+    const char *site;
+    uint32_t site_len;
+    bool write = true;
+
+    if ((0 == m_window) || (NULL == stamp_end))
+    {
+        return m_output(ptr, len);
+    }
+    site = stamp_end + 1;
+    site_len = logcoal_site_len(site, len - (site - ptr));
+    if (0 == site_len)
+    {
+        return m_output(ptr, len);
+    }
+
+    uint32_t hash = logcoal_hash(site, site_len);
+    uint32_t text_len = len - (site - ptr) - site_len;
+    uint32_t text = logcoal_hash(site + site_len, text_len);
+    uint32_t now = logcoal_now();
+    logcoal_site_t *e = &m_sites[hash & LOGCOAL_MASK];
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    if ((e->hash != hash) || (e->site_len != site_len) || (0 != memcmp(e->site, site, site_len)))
+    {
+        // A new call site, or another one that shares the entry
+        logcoal_take(e, &summary);
+        e->hash = hash;
+        e->site_len = site_len;
+        memcpy(e->site, site, site_len);
+        e->text = text;
+        e->text_len = text_len;
+    }
+    else if ((e->text != text) || (e->text_len != text_len) || (now - e->last > m_window))
+    {
+        logcoal_take(e, &summary);
+        e->text = text;
+        e->text_len = text_len;
+    }
+    else
+    {
+        if (0 == e->count)
+        {
+            e->first = now;
+        }
+        e->count++;
+        write = false;
+
+        // The summary takes the place of the repeat that completes the window
+        if (now - e->first >= m_window)
+        {
+            e->last = now;
+            logcoal_take(e, &summary);
+        }
+    }
+    e->last = now;
+    CORE_EXIT_ATOMIC();
+
+    logcoal_emit(&summary, now);
+    if (write)
+    {
+        m_output(ptr, len);
+    }
+    return len;
+}
+
+void logcoal_poll(void)
+{
+    uint32_t now = logcoal_now();
+
+    for (uint32_t i = 0; i < LOGCOAL_SITES; i++)
+    {
+        logcoal_summary_t summary = {.count = 0};
+        logcoal_site_t *e = &m_sites[i];
+
+        CORE_DECLARE_IRQ_STATE;
+        CORE_ENTER_ATOMIC();
+        if ((0 != e->count) && (now - e->last > m_window))
+        {
+            logcoal_take(e, &summary);
+        }
+        CORE_EXIT_ATOMIC();
+
+        logcoal_emit(&summary, now);
+    }
+}
@@ -0,0 +1,47 @@
+/**
+ * @brief Coalescing of repeated log lines, an output stage between log_init
+ * and the real output.
+ *
+ * A call site is the level, module and line field lll writes into every
+ * line ("I|main: 332|"). The first line of a call site goes out as is,
+ * repeats of the same text from the same call site are counted instead and
+ * once they span the window a single summary line goes out in their place:
+ *
+ *   00:00:01.070 I|main: 332|x 14 in 910 ms
+ *
+ * A different text from the call site, or the call site coming back after
+ * a quiet window, first flushes the count and then goes out as is. Sites
+ * that went quiet with repeats pending are flushed by logcoal_poll.
+ *
+ * Call sites are kept in a small direct-mapped table indexed by a hash of
+ * the call site field, so a line costs one lookup. Two sites that land in
+ * the same entry take turns, each change flushes the count of the other.
+ * Texts are compared by length and hash.
+ *
+ * Lines without a call site field, like the pin recorder VCD, pass through.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef LOGCOAL_H_
+#define LOGCOAL_H_
+
+#include <stdint.h>
+
+#define LOGCOAL_SITES    16 // Table entries, power of two
+#define LOGCOAL_SITE_MAX 24 // Longest call site field, longer ones pass through
+
+typedef int (*logcoal_output_f)(const char *ptr, int len);
+
+// Coalesce repeats within window_ms, 0 passes everything through, and write to output.
+void logcoal_init(uint32_t window_ms, logcoal_output_f output);
+
+void logcoal_set_window(uint32_t window_ms);
+
+// Log output function for log_init. Safe in interrupt context.
+int logcoal_write(const char *ptr, int len);
+
+// Flush the counts of call sites that have been quiet for a window.
+void logcoal_poll(void);
+
+#endif//LOGCOAL_H_
@@ -0,0 +1,134 @@
+/**
+ * @brief Per-module log levels that can be changed at run time, see logctl.h.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "logctl.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "console.h"
+
+#include "loglevels.h"
+#define __MODUUL__ "log"
+#define __LOG_LEVEL__ 0
+#include "log.h"
+
+typedef struct logctl_level
+{
+    const char *name;
+    uint16_t mask;
+} logctl_level_t;
+
+volatile uint16_t g_log_masks[LOG_MODULES] = {[0 ... LOG_MODULES - 1] = LOG_LEVEL_DEBUG};
+
+// Names in the log lines
+static const char * const m_names[LOG_MODULES] = {
+    [LOG_MODULE_main] = "main",
+    [LOG_MODULE_latency] = "lat",
+    [LOG_MODULE_tasks] = "task",
+    [LOG_MODULE_prof] = "prof",
+};
+
+// Levels in the image, the runtime masks cannot bring back more
+static const uint16_t m_built[LOG_MODULES] = {
+    [LOG_MODULE_main] = LOG_LEVEL_main & BASE_LOG_LEVEL,
+    [LOG_MODULE_latency] = LOG_LEVEL_latency & BASE_LOG_LEVEL,
+    [LOG_MODULE_tasks] = LOG_LEVEL_tasks & BASE_LOG_LEVEL,
+    [LOG_MODULE_prof] = LOG_LEVEL_prof & BASE_LOG_LEVEL,
+};
+
+static const logctl_level_t m_levels[] = {
+    {"debug", LOG_LEVEL_DEBUG},
+    {"info", LOG_LEVEL_INFO},
+    {"warn", LOG_LEVEL_WARN},
+    {"error", LOG_LEVEL_ERROR},
+    {"none", LOG_LEVEL_NONE},
+};
+
+#define LOGCTL_LEVELS (sizeof(m_levels) / sizeof(m_levels[0]))
+
+bool logctl_set(const char *module, uint16_t mask)
+{
+    bool all = (0 == strcmp(module, "all"));
+    bool found = false;
+
+    for (uint8_t i = 0; i < LOG_MODULES; i++)
+    {
+        if (all || (0 == strcmp(module, m_names[i])))
+        {
+            g_log_masks[i] = mask;
+            found = true;
+        }
+    }
+    return found;
+}
+
+static const char *logctl_level_name(uint16_t mask)
+{
+    for (uint8_t i = 0; i < LOGCTL_LEVELS; i++)
+    {
+        if (m_levels[i].mask == mask)
+        {
+            return m_levels[i].name;
+        }
+    }
+    return "custom";
+}
+
+static bool logctl_parse(const char *text, uint16_t *mask)
+{
+    char *end;
+    unsigned long value;
+
+    for (uint8_t i = 0; i < LOGCTL_LEVELS; i++)
+    {
+        if (0 == strcmp(text, m_levels[i].name))
+        {
+            *mask = m_levels[i].mask;
+            return true;
+        }
+    }
+    value = strtoul(text, &end, 0);
+    if (('\0' == *text) || ('\0' != *end) || (value > 0xFFFF))
+    {
+        return false;
+    }
+    *mask = (uint16_t)value;
+    return true;
+}
+
+static void logctl_command(int argc, char **argv)
+{
+    uint16_t mask;
+
+    if (1 == argc)
+    {
+        for (uint8_t i = 0; i < LOG_MODULES; i++)
+        {
+            uint16_t current = g_log_masks[i];
+
+            console_printf("%-6s %-6s 0x%04X, built with %s 0x%04X", m_names[i], logctl_level_name(current),
+                           current, logctl_level_name(m_built[i]), m_built[i]);
+        }
+    }
+    else if ((3 != argc) || !logctl_parse(argv[2], &mask))
+    {
+        console_printf("usage: log [module|all debug|info|warn|error|none|mask]");
+    }
+    else if (!logctl_set(argv[1], mask))
+    {
+        console_printf("log: no module %s", argv[1]);
+    }
+    else
+    {
+        logctl_command(1, argv);
+    }
+}
+
+void logctl_init(void)
+{
+    console_register("log", logctl_command, "show or set the log level of a module");
+}
@@ -0,0 +1,30 @@
+/**
+ * @brief Per-module log levels that can be changed at run time, from the
+ * serial console with the log command.
+ *
+ * Every module that logs has an entry in the LOG_MODULE_x list of
+ * loglevels.h and defines __LOG_LEVEL__ as LOG_MODULE_LEVEL(x). A call then
+ * checks g_log_masks[LOG_MODULE_x] at run time, on top of the compile time
+ * LOG_LEVEL_x and BASE_LOG_LEVEL, which still strip their levels from the
+ * image. Masks start with every level on.
+ *
+ *   log                    list the modules and their levels
+ *   log main warn          warnings and errors of main only
+ *   log all 0xFFF0         a raw mask, here info and up everywhere
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef LOGCTL_H_
+#define LOGCTL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Register the log console command.
+void logctl_init(void);
+
+// Set the runtime mask of module, by its log line name or "all", false if there is no such module.
+bool logctl_set(const char *module, uint16_t mask);
+
+#endif//LOGCTL_H_
@@ -1,6 +1,27 @@
 #ifndef LOGLEVELS_H_
 #define LOGLEVELS_H_
 
+#include <stdint.h>
+
 #define LOG_LEVEL_main            LOG_LEVEL_DEBUG
+#define LOG_LEVEL_latency         LOG_LEVEL_DEBUG
+#define LOG_LEVEL_tasks           LOG_LEVEL_DEBUG
+#define LOG_LEVEL_prof            LOG_LEVEL_DEBUG
+
+// Modules with a runtime mask, see logctl.h
+enum
+{
+    LOG_MODULE_main,
+    LOG_MODULE_latency,
+    LOG_MODULE_tasks,
+    LOG_MODULE_prof,
+    LOG_MODULES
+};
+
+extern volatile uint16_t g_log_masks[LOG_MODULES];
+
+// __LOG_LEVEL__ of a module. Levels clear in LOG_LEVEL_x or BASE_LOG_LEVEL
+// fold to 0 and are compiled out, the rest cost one load and one AND.
+#define LOG_MODULE_LEVEL(module) (LOG_LEVEL_##module & BASE_LOG_LEVEL & g_log_masks[LOG_MODULE_##module])
 
 #endif//LOGLEVELS_H_
@@ -0,0 +1,336 @@
+/**
+ * @brief Asynchronous serial log output, see logsink.h.
+ *
+ * The ring is the bounded multi-producer multi-consumer queue where every
+ * slot carries a sequence number. For the lap that starts at position pos
+ * a slot is free while its sequence is pos and complete once it is pos + 1,
+ * taking it sets pos + LOGSINK_SLOTS, which frees it for the next lap.
+ * Claiming and taking are compare-and-swap on the enqueue and dequeue
+ * positions, a slot is only written by the one that claimed it and only
+ * read by the one that took it. All slots of a message are claimed and
+ * taken with one compare-and-swap, so a message is never interleaved with
+ * another one and the dequeue position is always at the start of one.
+ *
+ * Producers that drop the oldest messages take them like the consumer
+ * does. The consumer is whoever wins m_busy, it stays busy until the LDMA
+ * transfer it started is done and the done interrupt looks for more.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "logsink.h"
+
+#include <string.h>
+
+#include "cmsis_os2.h"
+#include "em_core.h"
+#include "em_device.h"
+#include "em_ldma.h"
+
+#include "ldma_irq.h"
+
+#define LOGSINK_MASK      (LOGSINK_SLOTS - 1)
+#define LOGSINK_PIECE_SLOTS (LOGSINK_BOUNCE / LOGSINK_SLOT_DATA)
+#define LOGSINK_PIECE     (LOGSINK_PIECE_SLOTS * LOGSINK_SLOT_DATA) // Longest message, fits the bounce buffer
+#define LOGSINK_USART     USART0
+#define LOGSINK_SIGNAL    ldmaPeripheralSignal_USART0_TXBL
+
+typedef struct logsink_slot
+{
+    uint32_t seq;
+    uint16_t len;
+    uint16_t count; // Slots of the message, in its first slot
+    char data[LOGSINK_SLOT_DATA];
+} logsink_slot_t;
+
+static logsink_slot_t m_slots[LOGSINK_SLOTS];
+static uint32_t m_enqueue; // Next position to claim
+static uint32_t m_dequeue; // Next position to take
+static bool m_busy;        // Consumer running or its transfer in flight
+static bool m_ready;
+
+static uint8_t m_bounce[LOGSINK_BOUNCE];
+static LDMA_Descriptor_t m_desc;
+
+static logsink_policy_t m_policy = LOGSINK_POLICY;
+static logsink_stats_t m_stats;
+
+static void logsink_irq(uint8_t ch, void *context);
+
+void logsink_init(void)
+{
+    for (uint32_t i = 0; i < LOGSINK_SLOTS; i++)
+    {
+        m_slots[i].seq = i;
+    }
+    m_enqueue = 0;
+    m_dequeue = 0;
+    m_busy = false;
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    ldma_irq_init();
+    ldma_irq_register(LOGSINK_CH, logsink_irq, NULL);
+    __atomic_store_n(&m_ready, true, __ATOMIC_RELEASE);
+}
+
+void logsink_set_policy(logsink_policy_t policy)
+{
+    __atomic_store_n(&m_policy, policy, __ATOMIC_RELAXED);
+}
+
+void logsink_get_stats(logsink_stats_t *stats)
+{
+    stats->written = __atomic_load_n(&m_stats.written, __ATOMIC_RELAXED);
+    stats->dropped_bytes = __atomic_load_n(&m_stats.dropped_bytes, __ATOMIC_RELAXED);
+    stats->dropped_messages = __atomic_load_n(&m_stats.dropped_messages, __ATOMIC_RELAXED);
+    stats->blocked = __atomic_load_n(&m_stats.blocked, __ATOMIC_RELAXED);
+}
+
+static uint32_t logsink_seq(uint32_t pos)
+{
+    return __atomic_load_n(&m_slots[pos & LOGSINK_MASK].seq, __ATOMIC_ACQUIRE);
+}
+
+// Claim count consecutive slots, false when they are not all free.
+static bool logsink_claim(uint32_t count, uint32_t *first)
+{
+    uint32_t pos = __atomic_load_n(&m_enqueue, __ATOMIC_RELAXED);
+
+    for (;;)
+    {
+        uint32_t i = 0;
+
+        while ((i < count) && (logsink_seq(pos + i) == pos + i))
+        {
+            i++;
+        }
+        if (i == count)
+        {
+            // Fails and reloads pos when another writer got there first
+            if (__atomic_compare_exchange_n(&m_enqueue, &pos, pos + count, false,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                *first = pos;
+                return true;
+            }
+            continue;
+        }
+
+        // A slot of this lap that is not free is still queued, unless a writer moved on
+        uint32_t now = __atomic_load_n(&m_enqueue, __ATOMIC_RELAXED);
+        if (now == pos)
+        {
+            return false;
+        }
+        pos = now;
+    }
+}
+
+// Slots and bytes of the message at pos, 0 when it is not complete. The
+// values are only trusted once a compare-and-swap from pos succeeds.
+static uint32_t logsink_message(uint32_t pos, uint32_t *bytes)
+{
+    uint32_t count;
+
+    if (logsink_seq(pos) != pos + 1)
+    {
+        return 0;
+    }
+    count = __atomic_load_n(&m_slots[pos & LOGSINK_MASK].count, __ATOMIC_RELAXED);
+    if (count > LOGSINK_PIECE_SLOTS)
+    {
+        return 0;
+    }
+
+    *bytes = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (logsink_seq(pos + i) != pos + i + 1)
+        {
+            return 0;
+        }
+        *bytes += __atomic_load_n(&m_slots[(pos + i) & LOGSINK_MASK].len, __ATOMIC_RELAXED);
+    }
+    return count;
+}
+
+static bool logsink_take(uint32_t pos, uint32_t count)
+{
+    return __atomic_compare_exchange_n(&m_dequeue, &pos, pos + count, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+static void logsink_release(uint32_t pos, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        __atomic_store_n(&m_slots[(pos + i) & LOGSINK_MASK].seq, pos + i + LOGSINK_SLOTS, __ATOMIC_RELEASE);
+    }
+}
+
+// Drop the oldest queued message, false when it is not complete.
+static bool logsink_drop_oldest(void)
+{
+    for (;;)
+    {
+        uint32_t pos = __atomic_load_n(&m_dequeue, __ATOMIC_RELAXED);
+        uint32_t bytes;
+        uint32_t count = logsink_message(pos, &bytes);
+
+        if (0 == count)
+        {
+            return false;
+        }
+        if (logsink_take(pos, count))
+        {
+            logsink_release(pos, count);
+            __atomic_fetch_add(&m_stats.dropped_bytes, bytes, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&m_stats.dropped_messages, 1, __ATOMIC_RELAXED);
+            return true;
+        }
+    }
+}
+
+// Move complete messages into the bounce buffer while they fit, returns the bytes.
+static uint32_t logsink_fill(void)
+{
+    uint32_t n = 0;
+
+    for (;;)
+    {
+        uint32_t pos = __atomic_load_n(&m_dequeue, __ATOMIC_RELAXED);
+        uint32_t bytes;
+        uint32_t count = logsink_message(pos, &bytes);
+
+        if ((0 == count) || (n + bytes > LOGSINK_BOUNCE))
+        {
+            break;
+        }
+        if (logsink_take(pos, count))
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                logsink_slot_t *s = &m_slots[(pos + i) & LOGSINK_MASK];
+
+                memcpy(&m_bounce[n], s->data, s->len);
+                n += s->len;
+            }
+            logsink_release(pos, count);
+        }
+    }
+    return n;
+}
+
+// Start a transfer unless one is running, whoever sees m_busy set leaves the work to its owner.
+static void logsink_kick(void)
+{
+    for (;;)
+    {
+        if (__atomic_exchange_n(&m_busy, true, __ATOMIC_ACQUIRE))
+        {
+            return;
+        }
+
+        uint32_t n = logsink_fill();
+        if (0 != n)
+        {
+            LDMA_TransferCfg_t cfg = LDMA_TRANSFER_CFG_PERIPHERAL(LOGSINK_SIGNAL);
+
+            m_desc = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_SINGLE_M2P_BYTE(m_bounce, &LOGSINK_USART->TXDATA, n);
+            LDMA_StartTransfer(LOGSINK_CH, &cfg, &m_desc);
+            return;
+        }
+
+        __atomic_store_n(&m_busy, false, __ATOMIC_RELEASE);
+
+        // A message completed after the fill looked would be left behind by its writer
+        uint32_t bytes;
+        if (0 == logsink_message(__atomic_load_n(&m_dequeue, __ATOMIC_RELAXED), &bytes))
+        {
+            return;
+        }
+    }
+}
+
+// Transfer done, the USART still shifts out the last bytes.
+static void logsink_irq(uint8_t ch, void *context)
+{
+    __atomic_store_n(&m_busy, false, __ATOMIC_RELEASE);
+    logsink_kick();
+}
+
+// Only threads wait, and only once the kernel can switch to the others.
+static bool logsink_can_block(void)
+{
+    return !CORE_InIrqContext() && (osKernelRunning == osKernelGetState());
+}
+
+// Bytes of the next message, longer ones are cut after their last line end.
+static uint32_t logsink_piece(const char *ptr, uint32_t left)
+{
+    uint32_t piece = LOGSINK_PIECE;
+
+    if (left <= LOGSINK_PIECE)
+    {
+        return left;
+    }
+    while ((piece > 1) && ('\n' != ptr[piece - 1]))
+    {
+        piece--;
+    }
+    return (piece > 1) ? piece : LOGSINK_PIECE;
+}
+
+int logsink_write(const char *ptr, int len)
+{
+    uint32_t left = (len > 0) ? (uint32_t)len : 0;
+    uint32_t pos;
+
+    if (!__atomic_load_n(&m_ready, __ATOMIC_ACQUIRE))
+    {
+        return 0;
+    }
+
+    while (0 != left)
+    {
+        uint32_t piece = logsink_piece(ptr, left);
+        uint32_t count = (piece + LOGSINK_SLOT_DATA - 1) / LOGSINK_SLOT_DATA;
+        logsink_policy_t policy = __atomic_load_n(&m_policy, __ATOMIC_RELAXED);
+
+        if (!logsink_claim(count, &pos))
+        {
+            if ((LOGSINK_DROP_OLDEST == policy) && logsink_drop_oldest())
+            {
+                continue;
+            }
+            if ((LOGSINK_BLOCK == policy) && logsink_can_block())
+            {
+                __atomic_fetch_add(&m_stats.blocked, 1, __ATOMIC_RELAXED);
+                logsink_kick();
+                osDelay(1);
+                continue;
+            }
+
+            __atomic_fetch_add(&m_stats.dropped_bytes, left, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&m_stats.dropped_messages, 1, __ATOMIC_RELAXED);
+            break;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            logsink_slot_t *s = &m_slots[(pos + i) & LOGSINK_MASK];
+            uint32_t n = (piece < LOGSINK_SLOT_DATA) ? piece : LOGSINK_SLOT_DATA;
+
+            memcpy(s->data, ptr, n);
+            __atomic_store_n(&s->len, n, __ATOMIC_RELAXED);
+            __atomic_store_n(&s->count, (0 == i) ? count : 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&s->seq, pos + i + 1, __ATOMIC_RELEASE);
+            ptr += n;
+            piece -= n;
+            left -= n;
+            __atomic_fetch_add(&m_stats.written, n, __ATOMIC_RELAXED);
+        }
+    }
+
+    logsink_kick();
+    return len - (int)left;
+}
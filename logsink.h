@@ -0,0 +1,65 @@
+/**
+ * @brief Asynchronous serial log output, messages are queued in a lock-free
+ * ring and written to the USART by the LDMA in the background.
+ *
+ * logsink_write is a log output function for log_init, blog_drain and
+ * pinrec_vcd_drain. It copies the message into the ring and returns, the
+ * caller never waits for the serial port. Any number of threads and
+ * interrupt handlers may write at the same time without masking interrupts,
+ * slots are claimed with compare-and-swap and each message keeps its bytes
+ * together on the wire.
+ *
+ * The ring is a bounded queue of fixed size slots, each with a sequence
+ * number that tells producers and the consumer whether the slot is free or
+ * holds a complete piece of a message for the current lap. A message longer
+ * than a slot takes consecutive slots, one longer than the bounce buffer is
+ * queued as several, cut at line ends. The consumer copies complete messages
+ * into a bounce buffer and hands that to one LDMA channel paced by the
+ * USART TX buffer level, the channel done interrupt starts the next batch.
+ *
+ * When the ring is full the overflow policy decides, see logsink_policy_t.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef LOGSINK_H_
+#define LOGSINK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LOGSINK_SLOTS     64  // Ring slots, power of two
+#define LOGSINK_SLOT_DATA 56  // Message bytes per slot, a slot is 64 bytes
+#define LOGSINK_BOUNCE    512 // Bytes per LDMA transfer, also the longest message
+#define LOGSINK_CH        1   // LDMA channel, playback has 0
+
+typedef enum logsink_policy
+{
+    LOGSINK_DROP_NEWEST, // The message that does not fit is dropped
+    LOGSINK_DROP_OLDEST, // Queued messages are dropped to make room
+    LOGSINK_BLOCK        // Threads wait for room, interrupts drop the newest
+} logsink_policy_t;
+
+#ifndef LOGSINK_POLICY
+#define LOGSINK_POLICY LOGSINK_DROP_NEWEST
+#endif
+
+typedef struct logsink_stats
+{
+    uint32_t written;          // Message bytes queued
+    uint32_t dropped_bytes;    // Message bytes lost to the overflow policy
+    uint32_t dropped_messages; // Messages lost
+    uint32_t blocked;          // Waits for room by LOGSINK_BLOCK writers
+} logsink_stats_t;
+
+// Set up the LDMA channel, the USART is the one RETARGET_SerialInit set up.
+void logsink_init(void);
+
+// Queue len bytes of ptr, returns the bytes queued, less than len when some were dropped.
+int logsink_write(const char *ptr, int len);
+
+void logsink_set_policy(logsink_policy_t policy);
+
+void logsink_get_stats(logsink_stats_t *stats);
+
+#endif//LOGSINK_H_
@@ -27,6 +27,7 @@
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 #include <inttypes.h>
 
@@ -38,82 +39,305 @@
 #include "DeviceSignature.h"
 
 #include "loggers_ext.h"
-#include "logger_fwrite.h"
 
 #include "em_cmu.h"
+#include "em_core.h"
 #include "em_gpio.h"
 
+#include "tone.h"
+#include "cyclic.h"
+#include "playback.h"
+#include "mixer.h"
+#include "dds.h"
+#include "melody.h"
+#include "edge_ring.h"
+#include "debounce.h"
+#include "gesture.h"
+#include "button_timing.h"
+#include "exti.h"
+#include "latency.h"
+#include "pinrec.h"
+#include "logsink.h"
+#include "logcoal.h"
+#include "logctl.h"
+#include "console.h"
+#include "tasks.h"
+#include "prof.h"
+#include "sleep.h"
+#include "swtimer.h"
+#include "gate.h"
+#include "periodic.h"
+
 #include "loglevels.h"
 #define __MODUUL__ "main"
-#define __LOG_LEVEL__ (LOG_LEVEL_main & BASE_LOG_LEVEL)
+#define __LOG_LEVEL__ LOG_MODULE_LEVEL(main)
 #include "log.h"
+#include "blog.h"
 
 // Include the information header binary
 #include "incbin.h"
 INCBIN(Header, "header.bin");
 
+#if defined(ESWGPIO_BUZZER_MELODY)
+// Score compiled from MELODY_SCORE by tools/melodyc.py, played in place from flash
+INCBIN(Melody, "melody.bin");
+#endif
+
 #define ESWGPIO_EXTI_INDEX 4         // External interrupt number 4.
 #define ESWGPIO_EXTI_IF 0x00000010UL // Interrupt flag for external interrupt
 
-// declare setup functions
+#define ESWGPIO_EDGE_BATCH 8   // Button edges handled per ring read
+
+#define ESWGPIO_TONE_FREQ 2700 // Buzzer tone frequency in TONE mode, Hz
+
+#define ESWGPIO_BUZZER_PERIOD_ONE 70 // Buzzer tone one toggle period, os ticks
+#define ESWGPIO_BUZZER_PERIOD_TWO 40 // Buzzer tone two toggle period, os ticks
+
+#define ESWGPIO_PLAYBACK_BLOCK 256 // LDMA playback buffer length, samples
+#define ESWGPIO_MIXER_RATE 8000    // Mixer output sample rate, Hz
+
+#define ESWGPIO_DDS_RATE 32000        // DDS output sample rate, Hz
+#define ESWGPIO_DDS_SWEEP_LOW 1000000  // Siren sweep start, mHz
+#define ESWGPIO_DDS_SWEEP_HIGH 3000000 // Siren sweep end, mHz
+#define ESWGPIO_DDS_SWEEP_MS 700       // Siren sweep length, ms
+
+#define ESWGPIO_PINREC_DRAIN_MS 50 // Pin recorder drain interval, ms
+#define ESWGPIO_BLOG_DRAIN_MS 20   // Binary log drain interval, ms
+#define ESWGPIO_LOG_COALESCE_MS 1000 // Repeats of a log line are summarized per window, ms
+#define ESWGPIO_CONSOLE_HOLD_MS 30000 // No EM2 after console input or a button press, it loses serial input, ms
+
+// declare heartbeat and setup functions
+void hp_loop();
 void set_up_pins();
 void set_up_tasks();
 
 // declare buzzer functions
 void buzzer_loop();
 void buzzer_loop_two();
+void buzzer_start();
+void buzzer_stop();
+void buzzer_schedule_action(uint32_t mask, void *user);
+void buzzer_timer_toggle(void *user);
+void buzzer_idle(void *user);
+uint32_t buzzer_pattern_refill(uint32_t *buf, uint32_t len, void *user);
+uint32_t buzzer_mixer_refill(uint32_t *buf, uint32_t len, void *user);
+uint32_t buzzer_dds_refill(uint32_t *buf, uint32_t len, void *user);
+
+// declare pin recorder and binary log drains
+void pinrec_loop();
+void blog_loop();
+void log_coalesce_timer(void *argument);
+void console_loop();
+
+// retargetserial.c fills its receive buffer from this one, the Makefile renames its USART0_RX_IRQHandler
+void RETARGET_RX_IRQHandler(void);
 
 // declare button function
 void button_loop();
+void button_gesture(const gesture_event_t *event, void *user);
 
 // declare initGPIOButton funtion
 void initGPIOButton();
 void buttonIntEnable();
+void buttonExtiHandler(uint8_t line, void *context);
 
 // initialize var to hold button task id
 osThreadId_t button_task_id;
 
-// initialize var to hold buzzer task id (which will be used later to suspend the buzzer task)
+// console task id, woken by the receive interrupt
+osThreadId_t console_task_id;
+
+// initialize var to hold buzzer task id
 osThreadId_t buzzer_task_id;
 osThreadId_t buzzer_task_two_id;
 
+#if defined(ESWGPIO_BUZZER_CYCLIC)
+// merged toggle schedule of both buzzer tones
+static cyclic_t buzzer_schedule;
+#elif defined(ESWGPIO_BUZZER_LDMA)
+// LDMA ping-pong buffers and the sample position of the next refill
+static uint32_t buzzer_block[2][ESWGPIO_PLAYBACK_BLOCK];
+static uint32_t buzzer_sample;
+#elif defined(ESWGPIO_BUZZER_MIXER)
+// Both buzzer tones are voices of one mixer, streamed by the LDMA
+static uint32_t buzzer_block[2][ESWGPIO_PLAYBACK_BLOCK];
+static mixer_t buzzer_mixer;
+#elif defined(ESWGPIO_BUZZER_DDS)
+// Phase accumulator synthesizer, streamed by the LDMA
+static uint32_t buzzer_block[2][ESWGPIO_PLAYBACK_BLOCK];
+static dds_t buzzer_dds;
+#elif defined(ESWGPIO_BUZZER_MELODY)
+// Bytecode interpreter for the embedded score
+static melody_t buzzer_melody;
+#elif defined(ESWGPIO_BUZZER_TIMERS)
+// Both tones are periodic timers of the timer service
+static swtimer_t buzzer_timer_one;
+static swtimer_t buzzer_timer_two;
+#elif defined(ESWGPIO_BUZZER_THREADS)
+// Both tone threads stop at a period boundary and restart on a common origin
+static gate_t buzzer_gate;
+static periodic_t buzzer_period_one;
+static periodic_t buzzer_period_two;
+#endif
+
+// heartbeat deadlines, lateness shown by the periods console command
+static periodic_t hp_period;
+
+// button edges queued by the interrupt handler, drained by button_loop
+static edge_ring_t button_edges;
+
+// button debouncer, only confirmed level changes reach the ring
+static debounce_t button_debounce;
+
+// button_loop knows the input is settling and has its poll armed, the interrupt need not wake it
+static volatile bool button_settle_armed;
+
+// click, long press and hold recognizer fed with the debounced edges
+static gesture_t button_gestures;
+
 // declare flag to resume thread
 static const uint32_t buttonExtIntThreadFlag = 0x00000001;
 
-// Declaration of enum of boolean values
-typedef enum
-{
-    F,
-    T
-} boolean;
-
-// declare variable to keep buzzer task state
-boolean buzzer_task_started = F;
+// flag of the console thread for received bytes
+static const uint32_t consoleRxThreadFlag = 0x00000001;
+
+// buzzer state, written by buzzer_start and buzzer_stop from the button and heartbeat threads
+static bool buzzer_task_started = false;
+
+// Task storage, stack sizes in bytes
+TASK_STORAGE(hp, 2048);
+#if defined(ESWGPIO_BUZZER_THREADS)
+TASK_STORAGE(buzzer, 1024);
+TASK_STORAGE(buzzer_two, 1024);
+#elif defined(ESWGPIO_BUZZER_TIMERS)
+TASK_STORAGE(timers, 768);
+#endif
+TASK_STORAGE(button, 1536);
+#if ESWGPIO_PIN_RECORD
+TASK_STORAGE(pinrec, 1024);
+#endif
+#if ESWGPIO_LOG_BINARY
+TASK_STORAGE(blog, 768);
+#endif
+TASK_STORAGE(console, 1536);
+
+// Every thread of the application. main starts the first ESWGPIO_BOOT_TASKS,
+// the heartbeat thread starts the rest once the pins are set up.
+static const task_def_t m_tasks[] = {
+    TASK_DEF(hp, "hp", hp_loop, osPriorityNormal, NULL),
+#if defined(ESWGPIO_BUZZER_THREADS)
+    TASK_DEF(buzzer, "BUZZER_thread_attr", buzzer_loop, osPriorityNormal, &buzzer_task_id),
+    TASK_DEF(buzzer_two, "BUZZER_thread_two_attr", buzzer_loop_two, osPriorityNormal, &buzzer_task_two_id),
+#elif defined(ESWGPIO_BUZZER_TIMERS)
+    // Runs the timer callbacks, above everything it serves
+    TASK_DEF(timers, "timers", swtimer_loop, osPriorityHigh, NULL),
+#endif
+    TASK_DEF(button, "button", button_loop, osPriorityNormal, &button_task_id),
+#if ESWGPIO_PIN_RECORD
+    // The recorder streams below everything else, it only takes idle time
+    TASK_DEF(pinrec, "pinrec", pinrec_loop, osPriorityLow, NULL),
+#endif
+#if ESWGPIO_LOG_BINARY
+    // Log records are only formatted on the host, the drain just copies bytes out
+    TASK_DEF(blog, "blog", blog_loop, osPriorityLow, NULL),
+#endif
+    // Commands are typed rarely, the console only takes idle time
+    TASK_DEF(console, "console", console_loop, osPriorityLow, &console_task_id),
+};
+
+#define ESWGPIO_TASKS (sizeof(m_tasks) / sizeof(m_tasks[0]))
+#define ESWGPIO_BOOT_TASKS 1
+
+TASK_TIMER_CB(log_coalesce_cb);
 
 // Heartbeat thread, initialize GPIO and print heartbeat messages.
 void hp_loop()
 {
 #define ESWGPIO_HB_DELAY 10 // Heartbeat message delay, seconds
+#define ESWGPIO_LATENCY_DUMP_HB 6 // Heartbeats between latency histogram dumps
 
     // TODO Initialize GPIO.
     CMU_ClockEnable(cmuClock_GPIO, true);
 
+    // Record pin activity from the first mode change on
+    pinrec_init();
+
     // Set up pins to be used for interrupt and buzzer
     set_up_pins();
 
     // set up threads/tasks
     set_up_tasks();
 
+#if defined(ESWGPIO_BUZZER_TONE)
+    // Buzzer output is generated by TIMER0, start it right away like the threads
+    tone_init();
+    buzzer_start();
+#elif defined(ESWGPIO_BUZZER_CYCLIC)
+    // Both tones are merged into one table, replacing the two buzzer threads
+    const uint32_t buzzer_periods[] = {ESWGPIO_BUZZER_PERIOD_ONE, ESWGPIO_BUZZER_PERIOD_TWO};
+    if (cyclic_build(&buzzer_schedule, buzzer_periods, 2, buzzer_schedule_action, NULL) < 0)
+    {
+        err1("cyclic_build, periods %u and %u ticks", ESWGPIO_BUZZER_PERIOD_ONE, ESWGPIO_BUZZER_PERIOD_TWO);
+    }
+    buzzer_start();
+#elif defined(ESWGPIO_BUZZER_LDMA)
+    // The merged pattern is rendered one block ahead and streamed by the LDMA
+    playback_init();
+    buzzer_start();
+#elif defined(ESWGPIO_BUZZER_MIXER) || defined(ESWGPIO_BUZZER_DDS)
+    playback_init();
+    buzzer_start();
+#elif defined(ESWGPIO_BUZZER_MELODY)
+    tone_init();
+    if (!melody_load(&buzzer_melody, gMelodyData, gMelodySize))
+    {
+        err1("melody_load");
+    }
+    buzzer_start();
+#elif defined(ESWGPIO_BUZZER_TIMERS)
+    // One dispatch thread instead of a thread per tone
+    swtimer_setup(&buzzer_timer_one, buzzer_timer_toggle, NULL);
+    swtimer_setup(&buzzer_timer_two, buzzer_timer_toggle, NULL);
+    buzzer_start();
+#else
+    // Both tone threads are waiting on the gate
+    buzzer_start();
+#endif
+
+    // Cycle counter for the button path latency histograms
+    latency_init();
+
     // Initialize GPIO interrupt for button
     initGPIOButton();
 
     // Enable button interrupt
     buttonIntEnable();
 
-    for (;;)
+    // Beats on absolute deadlines, the work of one does not push the next
+    periodic_setup(&hp_period, "hp", ESWGPIO_HB_DELAY * osKernelGetTickFreq());
+    periodic_start(&hp_period, osKernelGetTickCount());
+
+    uint32_t reported_log_drops = 0;
+    for (uint32_t beats = 1;; beats++)
     {
-        osDelay(ESWGPIO_HB_DELAY * osKernelGetTickFreq());
-        info1("Heartbeat");
+        logsink_stats_t log_stats;
+
+        periodic_wait(&hp_period);
+        sleep_thread_wake();
+        prof_sample();
+        prof_heartbeat();
+
+        logsink_get_stats(&log_stats);
+        if (log_stats.dropped_bytes != reported_log_drops)
+        {
+            reported_log_drops = log_stats.dropped_bytes;
+            warn1("Log dropped %" PRIu32 " bytes, %" PRIu32 " messages", log_stats.dropped_bytes, log_stats.dropped_messages);
+        }
+
+        if (0 == beats % ESWGPIO_LATENCY_DUMP_HB)
+        {
+            latency_dump();
+        }
     }
 }
 
@@ -127,90 +351,371 @@ void set_up_pins()
 
 void set_up_tasks()
 {
-    // create a thread/task for buzzer
-    const osThreadAttr_t BUZZER_thread_attr = {.name = "BUZZER_thread_attr"};
-    buzzer_task_id = osThreadNew(buzzer_loop, NULL, &BUZZER_thread_attr);
+    tasks_start(&m_tasks[ESWGPIO_BOOT_TASKS], ESWGPIO_TASKS - ESWGPIO_BOOT_TASKS);
+    tasks_report(m_tasks, ESWGPIO_TASKS);
+
+    // Repeat counts of log lines that stopped coming go out a window later
+    const osTimerAttr_t log_coalesce_timer_attr = {.name = "logcoal", .cb_mem = &log_coalesce_cb,
+                                                   .cb_size = sizeof(log_coalesce_cb)};
+    osTimerId_t log_coalesce = osTimerNew(log_coalesce_timer, osTimerPeriodic, NULL, &log_coalesce_timer_attr);
+    if (NULL == log_coalesce)
+    {
+        // Without it the repeats of a site that went quiet are only summed up when it logs again
+        err1("%s not created", log_coalesce_timer_attr.name);
+    }
+    else
+    {
+        osTimerStart(log_coalesce, ESWGPIO_LOG_COALESCE_MS * osKernelGetTickFreq() / 1000);
+    }
+}
 
-    // create a thread/task for buzzer tone two
-    const osThreadAttr_t BUZZER_thread_two_attr = {.name = "BUZZER_thread_two_attr"};
-    buzzer_task_two_id = osThreadNew(buzzer_loop_two, NULL, &BUZZER_thread_two_attr);
+void log_coalesce_timer(void *argument)
+{
+    logcoal_poll();
+}
 
-    // Create a thread/task.
-    const osThreadAttr_t button_thread_attr = {.name = "button"};
-    button_task_id = osThreadNew(button_loop, NULL, &button_thread_attr);
+// Serial console, "log main warn" and the like, "help" lists the commands
+void console_loop()
+{
+    for (;;)
+    {
+        // Whatever came before the thread was there is read on the first pass
+        if (console_poll())
+        {
+            sleep_em2_hold(ESWGPIO_CONSOLE_HOLD_MS);
+        }
+        osThreadFlagsWait(consoleRxThreadFlag, osFlagsWaitAny, osWaitForever);
+    }
 }
 
-// buzzer task.
-void buzzer_loop()
+// VCOM receive interrupt, retargetserial.c buffers the byte and the console thread reads it.
+void USART0_RX_IRQHandler(void)
+{
+    RETARGET_RX_IRQHandler();
+    osThreadFlagsSet(console_task_id, consoleRxThreadFlag);
+}
+
+#if ESWGPIO_PIN_RECORD
+// Pin recorder drain, the VCD goes out on the serial port between the log lines
+void pinrec_loop()
 {
     for (;;)
     {
-        // wait for 70 os ticks
-        osDelay(70);
+        osDelay(ESWGPIO_PINREC_DRAIN_MS * osKernelGetTickFreq() / 1000);
+        pinrec_vcd_drain(&logsink_write);
+    }
+}
+#endif
 
-        // toggle buzzer pin
-        GPIO_PinOutToggle(gpioPortA, 0);
+#if ESWGPIO_LOG_BINARY
+// Binary log drain, decode the serial capture with tools/blogdec.py
+void blog_loop()
+{
+    for (;;)
+    {
+        osDelay(ESWGPIO_BLOG_DRAIN_MS * osKernelGetTickFreq() / 1000);
+        blog_drain(&logsink_write);
+    }
+}
+#endif
 
-        // set start to true
-        buzzer_task_started = T;
+#if defined(ESWGPIO_BUZZER_THREADS)
+// buzzer task.
+void buzzer_loop()
+{
+    periodic_setup(&buzzer_period_one, "buzzer", ESWGPIO_BUZZER_PERIOD_ONE);
+    for (;;)
+    {
+        uint32_t ticket;
 
-        // log out for debugging
-        info1("Buzzer tone played");
+        periodic_start(&buzzer_period_one, gate_enter(&buzzer_gate, &ticket));
+        for (;;)
+        {
+            // wait for the next 70 os tick boundary from the common origin
+            periodic_wait(&buzzer_period_one);
+            if (!gate_pass(&buzzer_gate, ticket))
+            {
+                break;
+            }
+            sleep_thread_wake();
+
+            // toggle buzzer pin
+            GPIO_PinOutToggle(gpioPortA, 0);
+
+            // log out for debugging
+            info1("Buzzer tone played");
+        }
     }
 }
 
 // buzzer task tone two.
 void buzzer_loop_two()
 {
+    periodic_setup(&buzzer_period_two, "buzzer_two", ESWGPIO_BUZZER_PERIOD_TWO);
     for (;;)
     {
-        // wait for 40 os ticks
-        osDelay(40);
+        uint32_t ticket;
+
+        periodic_start(&buzzer_period_two, gate_enter(&buzzer_gate, &ticket));
+        for (;;)
+        {
+            // wait for the next 40 os tick boundary from the common origin
+            periodic_wait(&buzzer_period_two);
+            if (!gate_pass(&buzzer_gate, ticket))
+            {
+                break;
+            }
+            sleep_thread_wake();
+
+            // toggle buzzer pin
+            GPIO_PinOutToggle(gpioPortA, 0);
+
+            // log out for debugging
+            info1("Buzzer tone two played");
+        }
+    }
+}
+
+// Gate idle action, the last tone thread out leaves the buzzer pin low
+void buzzer_idle(void *user)
+{
+    GPIO_PinOutClear(gpioPortA, 0);
+}
+#endif
 
-        // toggle buzzer pin
+// Cyclic executive frame, every released tone toggles the buzzer pin once
+void buzzer_schedule_action(uint32_t mask, void *user)
+{
+    // Simultaneous toggles cancel out, only an odd number changes the pin
+    if (__builtin_parity(mask))
+    {
         GPIO_PinOutToggle(gpioPortA, 0);
+    }
+}
+
+// Timer service callback, each expiry of either tone toggles the buzzer pin once
+void buzzer_timer_toggle(void *user)
+{
+    GPIO_PinOutToggle(gpioPortA, 0);
+}
+
+// LDMA refill, one sample per os tick with the same toggles as the two buzzer threads
+uint32_t buzzer_pattern_refill(uint32_t *buf, uint32_t len, void *user)
+{
+#if defined(ESWGPIO_BUZZER_LDMA)
+    for (uint32_t i = 0; i < len; i++)
+    {
+        uint32_t t = ++buzzer_sample;
+        bool one = (0 == t % ESWGPIO_BUZZER_PERIOD_ONE);
+        bool two = (0 == t % ESWGPIO_BUZZER_PERIOD_TWO);
 
-        // log out for debugging
-        info1("Buzzer tone two played");
+        buf[i] = (one != two) ? PLAYBACK_TOGGLE : 0;
+    }
+#endif
+    return len;
+}
+
+// LDMA refill with the XOR mix of all mixer voices
+uint32_t buzzer_mixer_refill(uint32_t *buf, uint32_t len, void *user)
+{
+#if defined(ESWGPIO_BUZZER_MIXER)
+    mixer_render_toggles(&buzzer_mixer, buf, len);
+#endif
+    return len;
+}
+
+// LDMA refill with the DDS voices
+uint32_t buzzer_dds_refill(uint32_t *buf, uint32_t len, void *user)
+{
+#if defined(ESWGPIO_BUZZER_DDS)
+    dds_render_toggles(&buzzer_dds, buf, len);
+#endif
+    return len;
+}
+
+// Start buzzer output with the selected backend
+void buzzer_start()
+{
+#if defined(ESWGPIO_BUZZER_TONE)
+    tone_start(ESWGPIO_TONE_FREQ);
+#elif defined(ESWGPIO_BUZZER_CYCLIC)
+    cyclic_start(&buzzer_schedule);
+#elif defined(ESWGPIO_BUZZER_LDMA)
+    buzzer_sample = 0;
+    playback_start(buzzer_block[0], buzzer_block[1], ESWGPIO_PLAYBACK_BLOCK,
+                   osKernelGetTickFreq(), buzzer_pattern_refill, NULL, NULL);
+#elif defined(ESWGPIO_BUZZER_MIXER)
+    // A tone period of N ticks is a voice with a half period of N ticks
+    uint32_t samples_per_tick = ESWGPIO_MIXER_RATE / osKernelGetTickFreq();
+    mixer_init(&buzzer_mixer);
+    mixer_add_voice(&buzzer_mixer, ESWGPIO_BUZZER_PERIOD_ONE * samples_per_tick * 256);
+    mixer_add_voice(&buzzer_mixer, ESWGPIO_BUZZER_PERIOD_TWO * samples_per_tick * 256);
+    playback_start(buzzer_block[0], buzzer_block[1], ESWGPIO_PLAYBACK_BLOCK,
+                   ESWGPIO_MIXER_RATE, buzzer_mixer_refill, NULL, NULL);
+#elif defined(ESWGPIO_BUZZER_DDS)
+    // Repeating exponential chirp, an equal number of octaves per second
+    dds_init(&buzzer_dds, ESWGPIO_DDS_RATE);
+    dds_sweep(&buzzer_dds, 0, ESWGPIO_DDS_SWEEP_LOW, ESWGPIO_DDS_SWEEP_HIGH,
+              ESWGPIO_DDS_RATE / 1000 * ESWGPIO_DDS_SWEEP_MS, DDS_SWEEP_EXPONENTIAL, true);
+    playback_start(buzzer_block[0], buzzer_block[1], ESWGPIO_PLAYBACK_BLOCK,
+                   ESWGPIO_DDS_RATE, buzzer_dds_refill, NULL, NULL);
+#elif defined(ESWGPIO_BUZZER_MELODY)
+    melody_play(&buzzer_melody);
+#elif defined(ESWGPIO_BUZZER_TIMERS)
+    swtimer_start(&buzzer_timer_one, ESWGPIO_BUZZER_PERIOD_ONE, ESWGPIO_BUZZER_PERIOD_ONE);
+    swtimer_start(&buzzer_timer_two, ESWGPIO_BUZZER_PERIOD_TWO, ESWGPIO_BUZZER_PERIOD_TWO);
+#else
+    // let the buzzer tasks through the gate, together on a fresh origin
+    gate_open(&buzzer_gate);
+#endif
+    __atomic_store_n(&buzzer_task_started, true, __ATOMIC_RELAXED);
+}
+
+// Stop buzzer output with the selected backend
+void buzzer_stop()
+{
+#if defined(ESWGPIO_BUZZER_TONE)
+    tone_stop();
+#elif defined(ESWGPIO_BUZZER_CYCLIC)
+    cyclic_stop(&buzzer_schedule);
+    GPIO_PinOutClear(gpioPortA, 0);
+#elif defined(ESWGPIO_BUZZER_LDMA) || defined(ESWGPIO_BUZZER_MIXER) || defined(ESWGPIO_BUZZER_DDS)
+    playback_stop();
+#elif defined(ESWGPIO_BUZZER_MELODY)
+    melody_stop(&buzzer_melody);
+#elif defined(ESWGPIO_BUZZER_TIMERS)
+    swtimer_cancel(&buzzer_timer_one);
+    swtimer_cancel(&buzzer_timer_two);
+    GPIO_PinOutClear(gpioPortA, 0);
+#else
+    // the buzzer tasks leave the gate at their next period boundary, the last one clears the pin
+    gate_close(&buzzer_gate);
+#endif
+    __atomic_store_n(&buzzer_task_started, false, __ATOMIC_RELAXED);
+}
+
+// Convert a system timer interval to kernel ticks, rounded up
+static uint32_t sys_to_ticks(uint32_t count)
+{
+    uint32_t per_tick = osKernelGetSysTimerFreq() / osKernelGetTickFreq();
+
+    return (count + per_tick - 1) / per_tick;
+}
+
+// Recognized button gestures, a single click toggles the buzzer
+void button_gesture(const gesture_event_t *event, void *user)
+{
+    switch (event->type)
+    {
+        case GESTURE_CLICK:
+            if (1 != event->count)
+            {
+                info1("Button %u-click", event->count);
+                break;
+            }
+
+            // do smt
+            info1("Button Interrupt toggled");
+
+            // stop and start the buzzer based on the previous state of buzzer_task_started
+            if (__atomic_load_n(&buzzer_task_started, __ATOMIC_RELAXED))
+            {
+                buzzer_stop();
+                info1("Buzzer stopped");
+            }
+            else
+            {
+                buzzer_start();
+                info1("Buzzer started");
+            }
+            break;
+
+        case GESTURE_LONG_PRESS:
+            info1("Button long press");
+            latency_dump();
+            break;
+
+        case GESTURE_HOLD_REPEAT:
+            debug1("Button held %u", event->count);
+            break;
+
+        default:
+            debug1("Button hold end");
+            break;
     }
 }
 
 // button interrupt task
 void button_loop(void *args)
 {
+    edge_event_t edges[ESWGPIO_EDGE_BATCH];
+    uint32_t reported_drops = 0;
+    uint32_t count;
+
     for (;;)
     {
-        osThreadFlagsClear(buttonExtIntThreadFlag);
-        osThreadFlagsWait(buttonExtIntThreadFlag, osFlagsWaitAny, osWaitForever);
+        uint32_t timeout = osWaitForever;
+        uint32_t remaining;
 
-        // do smt
-        info1("Button Interrupt toggled");
+        // Sleep until the next gesture deadline instead of polling
+        if (gesture_next_deadline(&button_gestures, osKernelGetSysTimerCount(), &remaining))
+        {
+            timeout = sys_to_ticks(remaining);
+        }
 
-        // suspend and resume buzzer tasks based on the previous state of buzzer_task_started
-        if (buzzer_task_started)
+        // A pulse shorter than the debounce window needs one more look at the pin
+        CORE_DECLARE_IRQ_STATE;
+        CORE_ENTER_ATOMIC();
+        button_settle_armed = debounce_settling(&button_debounce);
+        CORE_EXIT_ATOMIC();
+        if (button_settle_armed)
         {
-            // suspend buzzer tasks if they are running/allowed to run
-            osThreadSuspend(buzzer_task_id);
-            osThreadSuspend(buzzer_task_two_id);
-            buzzer_task_started = F;
-            info1("Buzzer tasks suspended");
+            uint32_t settle = ESWGPIO_DEBOUNCE_MS * osKernelGetTickFreq() / 1000 + 1;
+
+            timeout = (settle < timeout) ? settle : timeout;
         }
-        else
+
+        // The flag is cleared when the wait returns, edges queued after that set it again
+        uint32_t flags = osThreadFlagsWait(buttonExtIntThreadFlag, osFlagsWaitAny, timeout);
+        sleep_thread_wake();
+        if (0 == (flags & osFlagsError))
         {
-            // resume buzzer tasks if they are suspended
-            osThreadResume(buzzer_task_id);
-            osThreadResume(buzzer_task_two_id);
-            buzzer_task_started = T;
-            info1("Buzzer tasks resumed");
+            latency_thread_wake();
+
+            // Someone is at the board, let the console hear them
+            sleep_em2_hold(ESWGPIO_CONSOLE_HOLD_MS);
+        }
+        if ((flags & osFlagsError) && debounce_settling(&button_debounce))
+        {
+            CORE_ENTER_ATOMIC();
+            uint32_t now = osKernelGetSysTimerCount();
+            uint8_t level = GPIO_PinInGet(gpioPortF, 4);
+            if (debounce_poll(&button_debounce, now, level))
+            {
+                edge_ring_push(&button_edges, now, gpioPortF, 4, level);
+            }
+            CORE_EXIT_ATOMIC();
         }
-    }
-}
 
-int logger_fwrite_boot(const char *ptr, int len)
-{
-    fwrite(ptr, len, 1, stdout);
-    fflush(stdout);
-    return len;
+        while ((count = edge_ring_pop(&button_edges, edges, ESWGPIO_EDGE_BATCH)) > 0)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                debug1("edge %" PRIu32 " level %u", edges[i].timestamp, edges[i].level);
+
+                // Pull-up input, a low level means pressed
+                gesture_edge(&button_gestures, 0, edges[i].timestamp, 0 == edges[i].level);
+            }
+        }
+
+        gesture_timeout(&button_gestures, osKernelGetSysTimerCount());
+
+        if (button_edges.dropped != reported_drops)
+        {
+            reported_drops = button_edges.dropped;
+            warn1("Button edges dropped %" PRIu32, reported_drops);
+        }
+    }
 }
 
 int main()
@@ -219,23 +724,42 @@ int main()
 
     // Configure log message output
     RETARGET_SerialInit();
-    log_init(BASE_LOG_LEVEL, &logger_fwrite_boot, NULL);
+    // Queued and sent by the LDMA, safe from threads and interrupts from here on
+    logsink_init();
+    logcoal_init(ESWGPIO_LOG_COALESCE_MS, &logsink_write);
+    log_init(BASE_LOG_LEVEL, &logcoal_write, NULL);
+    blog_init(BASE_LOG_LEVEL);
+    console_init(&logsink_write);
+    logctl_init();
 
     info1("ESW-GPIO " VERSION_STR " (%d.%d.%d)", VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH);
 
     // Initialize OS kernel.
     osKernelInitialize();
 
-    // Create a thread.
-    const osThreadAttr_t hp_thread_attr = {.name = "hp"};
-    osThreadNew(hp_loop, NULL, &hp_thread_attr);
+    // Per-task CPU and stack use, reported with the heartbeat
+    prof_init(m_tasks, ESWGPIO_TASKS);
 
-    if (osKernelReady == osKernelGetState())
+    // RTCC wakeups for the tickless idle
+    sleep_init();
+
+    // Deadline and lateness counters of the periodic threads
+    periodic_init();
+
+#if defined(ESWGPIO_BUZZER_TIMERS)
+    swtimer_init();
+#elif defined(ESWGPIO_BUZZER_THREADS)
+    if (!gate_init(&buzzer_gate, "buzzer", buzzer_idle, NULL))
     {
-        // Switch to a thread-safe logger
-        logger_fwrite_init();
-        log_init(BASE_LOG_LEVEL, &logger_fwrite, NULL);
+        err1("gate_init");
+    }
+#endif
+
+    // Create the heartbeat thread, it starts the others.
+    tasks_start(m_tasks, ESWGPIO_BOOT_TASKS);
 
+    if (osKernelReady == osKernelGetState())
+    {
         // Start the kernel
         osKernelStart();
     }
@@ -253,7 +777,21 @@ void initGPIOButton()
 {
     GPIO_IntDisable(ESWGPIO_EXTI_IF); // Disable before config to avoid unwanted interrupt trigerring
 
-    GPIO_ExtIntConfig(gpioPortF, 4, ESWGPIO_EXTI_INDEX, false, true, false); //  port , pin, EXTI number, rising edge, falling edge enabled
+    edge_ring_init(&button_edges);
+    debounce_init(&button_debounce, ESWGPIO_DEBOUNCE_MS * (osKernelGetSysTimerFreq() / 1000),
+                  GPIO_PinInGet(gpioPortF, 4), osKernelGetSysTimerCount());
+
+    const uint32_t per_ms = osKernelGetSysTimerFreq() / 1000;
+    const gesture_config_t gestures = {
+        .click_gap = ESWGPIO_CLICK_GAP_MS * per_ms,
+        .long_press = ESWGPIO_LONG_PRESS_MS * per_ms,
+        .repeat = ESWGPIO_HOLD_REPEAT_MS * per_ms,
+        .max_clicks = ESWGPIO_MAX_CLICKS};
+    gesture_init(&button_gestures, &gestures);
+    gesture_subscribe(&button_gestures, button_gesture, NULL, GESTURE_MASK_ALL);
+
+    // Both edges, the debouncer needs to see releases to accept the next press
+    GPIO_ExtIntConfig(gpioPortF, 4, ESWGPIO_EXTI_INDEX, true, true, false); //  port , pin, EXTI number, rising edge, falling edge enabled
 
     GPIO_InputSenseSet(GPIO_INSENSE_INT, GPIO_INSENSE_INT);
 }
@@ -262,26 +800,36 @@ void buttonIntEnable()
 {
     GPIO_IntClear(ESWGPIO_EXTI_IF);
 
-    NVIC_EnableIRQ(GPIO_EVEN_IRQn);
-    NVIC_SetPriority(GPIO_EVEN_IRQn, 3);
+    // The dispatch table owns GPIO_EVEN_IRQHandler and enables the NVIC interrupt
+    if (!exti_register(ESWGPIO_EXTI_INDEX, buttonExtiHandler, NULL))
+    {
+        err1("exti_register");
+    }
 
     GPIO_IntEnable(ESWGPIO_EXTI_IF);
 }
 
-void GPIO_EVEN_IRQHandler(void)
+// Button EXTI line handler, called from the GPIO interrupt with the flag cleared.
+void buttonExtiHandler(uint8_t line, void *context)
 {
-    // Get all pending and enabled interrupts.
-    uint32_t pending = GPIO_IntGetEnabled();
+    uint32_t now = osKernelGetSysTimerCount();
+    uint8_t level = GPIO_PinInGet(gpioPortF, 4);
 
-    // Check if button interrupt is enabled
-    if (pending & ESWGPIO_EXTI_IF)
+    // Bounces end here, only confirmed changes are queued and wake the thread.
+    if (debounce_edge(&button_debounce, now, level))
     {
-        // clear interrupt flag.
-        GPIO_IntClear(ESWGPIO_EXTI_IF);
+        // Queue the edge, the thread may still be busy with earlier ones.
+        edge_ring_push(&button_edges, now, gpioPortF, 4, level);
 
         // Trigger button thread to resume.
+        latency_flag_set();
+        osThreadFlagsSet(button_task_id, buttonExtIntThreadFlag);
+    }
+    else if (debounce_settling(&button_debounce) && !button_settle_armed)
+    {
+        // A rejected edge left the pin changed, the thread has to arm its settle poll.
+        // Once, the bounces after it until the poll cost no wake-up.
+        button_settle_armed = true;
         osThreadFlagsSet(button_task_id, buttonExtIntThreadFlag);
     }
-    else
-        ; // This was not a button interrupt.
 }
@@ -0,0 +1,300 @@
+/**
+ * @brief Melody player for compiled scores, see melody.h.
+ *
+ * The score is fully validated when loaded, so the timer callback can
+ * interpret it without bounds checks. Note lengths are converted to
+ * kernel ticks with the remainder carried over, so long scores do not
+ * drift from the tempo because of tick rounding.
+ *
+ * The timer callback runs in the timer service task, which must never
+ * block, so it steps the score in a critical section instead of under a
+ * mutex, and play and stop change the state in one too. A callback that
+ * was already due when the melody is stopped sees it stopped and arms
+ * nothing. The timer is armed after the critical section, a play or stop
+ * in between counts up the generation and the callback then repeats
+ * their timer command, so theirs is always the last one.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "melody.h"
+
+#include "tone.h"
+
+#include "em_core.h"
+
+#define MELODY_HEADER_SIZE 4
+
+// Octave of MIDI notes 120..131 in Hz, lower octaves are shifted down
+static const uint16_t m_top_octave[12] = {
+    8372, 8870, 9397, 9956, 10548, 11175, 11840, 12544, 13290, 14080, 14917, 15804
+};
+
+uint32_t melody_note_frequency(uint8_t note)
+{
+    uint32_t shift = 10 - (note & 0x7F) / 12;
+    uint32_t freq = m_top_octave[note % 12];
+
+    if (0 == shift)
+    {
+        return freq;
+    }
+    return (freq + (1UL << (shift - 1))) >> shift;
+}
+
+// Check opcodes, arguments and repeat nesting of the whole score.
+static bool melody_validate(const uint8_t *data, uint32_t size)
+{
+    bool timed[MELODY_MAX_DEPTH + 1] = {false};
+    uint8_t depth = 0;
+    uint32_t i = MELODY_HEADER_SIZE;
+
+    if ((size < MELODY_HEADER_SIZE + 1) || ('M' != data[0]) || ('E' != data[1])
+        || ('L' != data[2]) || (MELODY_VERSION != data[3]))
+    {
+        return false;
+    }
+
+    while (i < size)
+    {
+        uint8_t op = data[i++];
+
+        if (MELODY_OP_END == op)
+        {
+            return 0 == depth;
+        }
+        if ((op & MELODY_OP_NOTE) || (MELODY_OP_TEMPO == op) || (MELODY_OP_REST == op)
+            || (MELODY_OP_REPEAT == op))
+        {
+            // Every one of these carries one argument byte
+            if ((i >= size) || ((MELODY_OP_REPEAT != op) && (0 == data[i])))
+            {
+                return false;
+            }
+            i++;
+        }
+
+        if (op & MELODY_OP_NOTE)
+        {
+            // The tone generator could not play it
+            uint32_t freq = melody_note_frequency(op & 0x7F);
+
+            if ((freq < TONE_FREQ_MIN) || (freq > TONE_FREQ_MAX))
+            {
+                return false;
+            }
+            timed[depth] = true;
+        }
+        else if (MELODY_OP_REST == op)
+        {
+            timed[depth] = true;
+        }
+        else if (MELODY_OP_REPEAT == op)
+        {
+            if (depth >= MELODY_MAX_DEPTH)
+            {
+                return false;
+            }
+            timed[++depth] = false;
+        }
+        else if (MELODY_OP_LOOP == op)
+        {
+            // An empty block would spin forever in the timer callback
+            if ((0 == depth) || !timed[depth])
+            {
+                return false;
+            }
+            timed[--depth] = true;
+        }
+        else if (MELODY_OP_TEMPO != op)
+        {
+            return false;
+        }
+    }
+    return false; // No end opcode
+}
+
+// Ticks of len sixteenth notes at the current tempo.
+static uint32_t melody_wait(melody_t *m, uint8_t len)
+{
+    uint32_t units = (uint32_t)len * 15 * osKernelGetTickFreq() + m->frac;
+    uint32_t ticks = units / m->bpm;
+
+    m->frac = units % m->bpm;
+    return (0 == ticks) ? 1 : ticks;
+}
+
+// Run opcodes up to the next note, rest or end of score. Returns the ticks to the
+// next step, 0 at the end.
+static uint32_t melody_step(melody_t *m)
+{
+    for (;;)
+    {
+        uint8_t op = *m->pc++;
+
+        if (op & MELODY_OP_NOTE)
+        {
+            uint32_t freq = melody_note_frequency(op & 0x7F);
+
+            // A frequency the tone generator rejects is a rest, not the previous note held
+            if (!tone_set_frequency(freq) && !tone_start(freq))
+            {
+                tone_stop();
+            }
+            return melody_wait(m, *m->pc++);
+        }
+
+        switch (op)
+        {
+            case MELODY_OP_TEMPO:
+                m->bpm = *m->pc++;
+                break;
+
+            case MELODY_OP_REST:
+                tone_stop();
+                return melody_wait(m, *m->pc++);
+
+            case MELODY_OP_REPEAT:
+                m->repeats[m->depth].left = *m->pc++;
+                m->repeats[m->depth].pc = m->pc;
+                m->depth++;
+                break;
+
+            case MELODY_OP_LOOP:
+            {
+                melody_repeat_t *r = &m->repeats[m->depth - 1];
+
+                if ((0 == r->left) || (0 != --r->left))
+                {
+                    m->pc = r->pc;
+                }
+                else
+                {
+                    m->depth--;
+                }
+                break;
+            }
+
+            default: // MELODY_OP_END
+                tone_stop();
+                m->playing = false;
+                return 0;
+        }
+    }
+}
+
+// The timer command of the last play or stop, the first step of a play is due now.
+static void melody_arm(melody_t *m)
+{
+    if (m->playing)
+    {
+        osTimerStart(m->timer, 1);
+    }
+    else
+    {
+        osTimerStop(m->timer);
+    }
+}
+
+static void melody_timer_cb(void *argument)
+{
+    melody_t *m = (melody_t *)argument;
+    uint32_t generation;
+    uint32_t ticks = 0;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    generation = m->generation;
+    if (m->playing)
+    {
+        ticks = melody_step(m);
+    }
+    CORE_EXIT_ATOMIC();
+
+    if (0 != ticks)
+    {
+        osTimerStart(m->timer, ticks);
+    }
+    if (generation != m->generation)
+    {
+        melody_arm(m);
+    }
+}
+
+// Silence and count up the generation, in a critical section. The timer follows with melody_arm.
+static void melody_halt(melody_t *m)
+{
+    m->playing = false;
+    m->generation++;
+    tone_stop();
+}
+
+bool melody_load(melody_t *m, const uint8_t *data, uint32_t size)
+{
+    if (!melody_validate(data, size))
+    {
+        return false;
+    }
+
+    if (NULL == m->timer)
+    {
+        const osTimerAttr_t attr = {.name = "melody", .cb_mem = &m->timer_cb, .cb_size = sizeof(m->timer_cb)};
+        m->timer = osTimerNew(melody_timer_cb, osTimerOnce, m, &attr);
+        if (NULL == m->timer)
+        {
+            return false;
+        }
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    melody_halt(m);
+    m->score = data;
+    CORE_EXIT_ATOMIC();
+    melody_arm(m);
+    return true;
+}
+
+bool melody_play(melody_t *m)
+{
+    if ((NULL == m->score) || (NULL == m->timer))
+    {
+        return false;
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    melody_halt(m);
+    m->pc = m->score + MELODY_HEADER_SIZE;
+    m->bpm = 120;
+    m->depth = 0;
+    m->frac = 0;
+    m->playing = true;
+    CORE_EXIT_ATOMIC();
+
+    // The first note starts from the timer service like all the others
+    if (osOK != osTimerStart(m->timer, 1))
+    {
+        melody_stop(m);
+        return false;
+    }
+    return true;
+}
+
+void melody_stop(melody_t *m)
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    melody_halt(m);
+    CORE_EXIT_ATOMIC();
+
+    if (NULL != m->timer)
+    {
+        melody_arm(m);
+    }
+}
+
+bool melody_playing(melody_t *m)
+{
+    return m->playing;
+}
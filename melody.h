@@ -0,0 +1,77 @@
+/**
+ * @brief Melody player for compiled scores embedded in flash.
+ *
+ * Scores are compiled on the host by tools/melodyc.py into a compact
+ * bytecode and linked into the image with INCBIN. The player interprets
+ * the bytecode in place, nothing is copied and no heap is used. Notes are
+ * played by the TIMER0 tone generator and note lengths are timed with a
+ * one-shot osTimer, so no thread sleeps between notes.
+ *
+ * Binary format, all lengths are in sixteenth notes:
+ *   header  'M' 'E' 'L' MELODY_VERSION
+ *   0x00             end of score
+ *   0x01 bpm         set tempo in quarter notes per minute
+ *   0x02 len         rest
+ *   0x03 count       start of a repeated block, count plays, 0 is forever
+ *   0x04             end of a repeated block
+ *   0x80|note len    MIDI note number 0..127, within the tone range
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef MELODY_H_
+#define MELODY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cmsis_os2.h"
+#include "FreeRTOS.h"
+
+#define MELODY_VERSION   1
+#define MELODY_MAX_DEPTH 4 // Nested repeat blocks
+
+#define MELODY_OP_END    0x00
+#define MELODY_OP_TEMPO  0x01
+#define MELODY_OP_REST   0x02
+#define MELODY_OP_REPEAT 0x03
+#define MELODY_OP_LOOP   0x04
+#define MELODY_OP_NOTE   0x80
+
+typedef struct melody_repeat
+{
+    const uint8_t *pc; // First opcode of the block
+    uint8_t left;      // Plays left, 0 is forever
+} melody_repeat_t;
+
+typedef struct melody
+{
+    const uint8_t *score;
+    const uint8_t *pc;
+    uint8_t bpm;
+    uint8_t depth;
+    melody_repeat_t repeats[MELODY_MAX_DEPTH];
+    uint32_t frac; // Tick remainder carried between notes
+    volatile bool playing;
+    volatile uint32_t generation; // Counted up by every load, play and stop
+    osTimerId_t timer;
+    StaticTimer_t timer_cb; // Control block of timer, no heap
+} melody_t;
+
+// Validate a compiled score, it is referenced in place and must stay valid. Notes
+// outside TONE_FREQ_MIN .. TONE_FREQ_MAX are rejected, MIDI 16 (E0) is the lowest.
+// The structure must be zeroed before the first load, static storage is fine.
+bool melody_load(melody_t *m, const uint8_t *data, uint32_t size);
+
+// Play from the beginning, tone_init must have been called.
+bool melody_play(melody_t *m);
+
+// Stop playback and silence the tone.
+void melody_stop(melody_t *m);
+
+bool melody_playing(melody_t *m);
+
+// Tone frequency of a MIDI note, Hz.
+uint32_t melody_note_frequency(uint8_t note);
+
+#endif//MELODY_H_
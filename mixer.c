@@ -0,0 +1,184 @@
+/**
+ * @brief Multi-voice square wave mixer, see mixer.h.
+ *
+ * Removed voices are only marked and get unlinked from the wheel when
+ * their slot comes up, so add and remove never walk a slot list. Voice
+ * edges are unlinked while a slot is walked and re-inserted after it, a
+ * half period that is a multiple of the wheel size lands back in the
+ * same slot and must not be seen twice.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "mixer.h"
+
+#include <string.h>
+
+#include "em_core.h"
+
+#include "playback.h"
+
+#define MIXER_NONE       0xFF
+#define MIXER_WHEEL_MASK (MIXER_WHEEL_SIZE - 1)
+
+enum
+{
+    MIXER_FREE,
+    MIXER_ACTIVE,
+    MIXER_REMOVED // Still linked in the wheel
+};
+
+void mixer_init(mixer_t *m)
+{
+    memset(m, 0, sizeof(mixer_t));
+    memset(m->wheel, MIXER_NONE, sizeof(m->wheel));
+}
+
+uint32_t mixer_half_period(uint32_t sample_rate, uint32_t freq_mhz)
+{
+    if (0 == freq_mhz)
+    {
+        return 0;
+    }
+    // rate / (2 * f) samples, f in mHz and result in Q8
+    return (uint32_t)(((uint64_t)sample_rate * 1000 * 256) / (2 * (uint64_t)freq_mhz));
+}
+
+static void mixer_link(mixer_t *m, uint8_t id)
+{
+    mixer_voice_t *v = &m->voices[id];
+    uint32_t slot = v->due & MIXER_WHEEL_MASK;
+
+    v->next = m->wheel[slot];
+    m->wheel[slot] = id;
+}
+
+int mixer_add_voice(mixer_t *m, uint32_t half_q8)
+{
+    int id = -1;
+
+    // Edges closer than one sample apart can not be represented
+    if (half_q8 < 256)
+    {
+        return -1;
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    for (uint8_t i = 0; i < MIXER_MAX_VOICES; i++)
+    {
+        mixer_voice_t *v = &m->voices[i];
+
+        if (MIXER_FREE == v->state)
+        {
+            v->half_q8 = half_q8;
+            v->due = m->now + (half_q8 >> 8);
+            v->frac = half_q8 & 0xFF;
+            v->level = 0;
+            v->state = MIXER_ACTIVE;
+            mixer_link(m, i);
+            m->count++;
+            id = i;
+            break;
+        }
+    }
+    CORE_EXIT_ATOMIC();
+    return id;
+}
+
+void mixer_remove_voice(mixer_t *m, int id)
+{
+    if ((id < 0) || (id >= MIXER_MAX_VOICES))
+    {
+        return;
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    mixer_voice_t *v = &m->voices[id];
+    if (MIXER_ACTIVE == v->state)
+    {
+        m->parity ^= v->level;
+        m->high -= v->level;
+        m->count--;
+        v->state = MIXER_REMOVED;
+    }
+    CORE_EXIT_ATOMIC();
+}
+
+uint8_t mixer_voices(mixer_t *m)
+{
+    return m->count;
+}
+
+// Advance one sample, applying all voice edges that fall on it.
+static inline void mixer_step(mixer_t *m)
+{
+    uint32_t t = m->now++;
+    uint8_t *link = &m->wheel[t & MIXER_WHEEL_MASK];
+    uint8_t pending = MIXER_NONE;
+
+    while (MIXER_NONE != *link)
+    {
+        uint8_t id = *link;
+        mixer_voice_t *v = &m->voices[id];
+
+        if (MIXER_REMOVED == v->state)
+        {
+            *link = v->next;
+            v->state = MIXER_FREE;
+        }
+        else if (v->due != t)
+        {
+            link = &v->next; // Due in a later turn of the wheel
+        }
+        else
+        {
+            uint32_t acc = v->frac + v->half_q8;
+
+            *link = v->next;
+            v->level ^= 1;
+            m->parity ^= 1;
+            if (v->level)
+            {
+                m->high++;
+            }
+            else
+            {
+                m->high--;
+            }
+            v->due += acc >> 8;
+            v->frac = acc & 0xFF;
+            v->next = pending;
+            pending = id;
+        }
+    }
+
+    while (MIXER_NONE != pending)
+    {
+        uint8_t id = pending;
+
+        pending = m->voices[id].next;
+        mixer_link(m, id);
+    }
+}
+
+void mixer_render_toggles(mixer_t *m, uint32_t *buf, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        mixer_step(m);
+        // Compared against the pin, so a removed high voice also shows up here
+        buf[i] = (m->parity != m->out) ? PLAYBACK_TOGGLE : 0;
+        m->out = m->parity;
+    }
+}
+
+void mixer_render_levels(mixer_t *m, uint8_t *buf, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        mixer_step(m);
+        buf[i] = m->high;
+    }
+}
@@ -0,0 +1,82 @@
+/**
+ * @brief Multi-voice square wave mixer for the buzzer output stream.
+ *
+ * Each voice is a square wave given by its half period in samples (Q8, so
+ * pitches are not limited to whole samples). Voices are kept in a timing
+ * wheel indexed by the sample number of their next edge, so producing a
+ * sample only looks at one wheel slot instead of every voice. The mixed
+ * output is maintained incrementally on every voice edge:
+ *  - XOR of all voices, rendered as PA0 toggle words for playback.h
+ *  - number of voices currently high, the duty numerator for summed PWM
+ *
+ * The cost per sample is one slot lookup plus one update per voice edge
+ * falling on that sample, O(voice edges per sample) rather than O(voices).
+ * Silent samples are cheap, but every voice still costs one update per
+ * half period, so the mean grows with the voices and their pitch:
+ * mixerbench measures some 6 to 9, 20 to 30 and 130 to 180 host cycles
+ * per sample for 2, 8 and 32 voices at its pitches.
+ *
+ * The worst case is MIXER_MAX_VOICES voices at the shortest half period of
+ * one sample, an edge of every voice on every sample. A refill of len
+ * samples then makes len * MIXER_MAX_VOICES voice updates, 8192 for the
+ * 256 sample block of main.c, and the refill interrupt must absorb them
+ * within one block time, 32 ms at 8 kHz. The slowest blocks mixerbench
+ * reports, up to millions of host cycles, include preemption of the host
+ * and bound nothing on the device.
+ *
+ * Rendering is meant to run in the playback refill interrupt, adding and
+ * removing voices from threads is safe against it.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef MIXER_H_
+#define MIXER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MIXER_MAX_VOICES 32
+#define MIXER_WHEEL_SIZE 1024 // Power of two, in samples
+
+typedef struct mixer_voice
+{
+    uint32_t half_q8; // Half period, samples Q24.8
+    uint32_t due;     // Sample of the next edge
+    uint8_t frac;     // Fractional part of due
+    uint8_t level;
+    uint8_t state;
+    uint8_t next;     // Next voice in the same wheel slot
+} mixer_voice_t;
+
+typedef struct mixer
+{
+    mixer_voice_t voices[MIXER_MAX_VOICES];
+    uint8_t wheel[MIXER_WHEEL_SIZE];
+    uint32_t now;   // Next sample to render
+    uint8_t parity; // XOR of all voice levels
+    uint8_t out;    // Parity last rendered to the pin
+    uint8_t high;   // Number of voices at high level
+    uint8_t count;  // Number of active voices
+} mixer_t;
+
+void mixer_init(mixer_t *m);
+
+// Half period in Q8 samples for freq_mhz (milli-Hz) at sample_rate Hz.
+uint32_t mixer_half_period(uint32_t sample_rate, uint32_t freq_mhz);
+
+// Add a voice starting low, first edge half a period from now. Returns id or -1.
+int mixer_add_voice(mixer_t *m, uint32_t half_q8);
+
+// Remove a voice, its level is taken out of the mix immediately.
+void mixer_remove_voice(mixer_t *m, int id);
+
+uint8_t mixer_voices(mixer_t *m);
+
+// Render len samples as PA0 toggle words, for use in a playback refill.
+void mixer_render_toggles(mixer_t *m, uint32_t *buf, uint32_t len);
+
+// Render len samples as the number of high voices, the summed PWM duty.
+void mixer_render_levels(mixer_t *m, uint8_t *buf, uint32_t len);
+
+#endif//MIXER_H_
@@ -0,0 +1,155 @@
+/**
+ * @brief Periodic thread helper on absolute deadlines, see periodic.h.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "periodic.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "em_device.h"
+#include "em_core.h"
+#include "cmsis_os2.h"
+
+#include "console.h"
+
+static periodic_t *m_list[PERIODIC_MAX];
+static uint32_t m_count;
+static uint32_t m_per_tick; // Sys timer cycles per kernel tick
+
+static void periodic_command(int argc, char **argv);
+
+void periodic_init(void)
+{
+    m_per_tick = osKernelGetSysTimerFreq() / osKernelGetTickFreq();
+    console_register("periods", periodic_command, "periodic thread deadlines and lateness");
+}
+
+bool periodic_setup(periodic_t *p, const char *name, uint32_t period)
+{
+    bool listed = false;
+
+    p->name = name;
+    p->period = period;
+    p->next = 0;
+    memset(&p->stats, 0, sizeof(p->stats));
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    if (m_count < PERIODIC_MAX)
+    {
+        m_list[m_count++] = p;
+        listed = true;
+    }
+    CORE_EXIT_ATOMIC();
+    return listed;
+}
+
+void periodic_start(periodic_t *p, uint32_t origin)
+{
+    p->next = origin + p->period;
+}
+
+uint32_t periodic_wait(periodic_t *p)
+{
+    uint32_t deadline = p->next;
+    uint32_t late = osKernelGetTickCount() - deadline;
+    uint32_t missed = 0;
+    bool overrun = !(late >> 31);
+
+    if (overrun)
+    {
+        // Whole periods gone are skipped, the latest deadline passed is run now
+        missed = late / p->period;
+        deadline += missed * p->period;
+    }
+    else
+    {
+        osDelayUntil(deadline);
+    }
+
+    // The sys timer is the kernel tick times the cycles per tick plus the cycles since
+    uint32_t cycles = osKernelGetSysTimerCount() - deadline * m_per_tick;
+    uint32_t bucket = (0 == cycles) ? 0 : 32 - __CLZ(cycles);
+
+    if (bucket >= PERIODIC_BUCKETS)
+    {
+        bucket = PERIODIC_BUCKETS - 1;
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    p->stats.periods++;
+    p->stats.overruns += overrun ? 1 : 0;
+    p->stats.missed += missed;
+    p->stats.buckets[bucket]++;
+    p->stats.max_late = (cycles > p->stats.max_late) ? cycles : p->stats.max_late;
+    CORE_EXIT_ATOMIC();
+
+    p->next = deadline + p->period;
+    return deadline;
+}
+
+void periodic_get_stats(const periodic_t *p, periodic_stats_t *out)
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    *out = p->stats;
+    CORE_EXIT_ATOMIC();
+}
+
+static void periodic_print(const periodic_t *p, const periodic_stats_t *s)
+{
+    char line[120];
+    int len;
+
+    console_printf("%s period %" PRIu32 " ticks periods %" PRIu32 " overruns %" PRIu32 " missed %" PRIu32,
+                   p->name, p->period, s->periods, s->overruns, s->missed);
+    len = snprintf(line, sizeof(line), "%s late max %" PRIu32 " |", p->name, s->max_late);
+
+    // Only non-empty buckets, as <2^n:count
+    for (uint8_t b = 0; (b < PERIODIC_BUCKETS) && (len > 0) && (len < (int)sizeof(line)); b++)
+    {
+        if (0 != s->buckets[b])
+        {
+            len += snprintf(&line[len], sizeof(line) - len, " <2^%u:%" PRIu32, b, s->buckets[b]);
+        }
+    }
+    console_printf("%s", line);
+}
+
+static void periodic_command(int argc, char **argv)
+{
+    uint32_t count;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    count = m_count;
+    CORE_EXIT_ATOMIC();
+
+    if ((2 == argc) && (0 == strcmp(argv[1], "clear")))
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            CORE_ENTER_ATOMIC();
+            memset(&m_list[i]->stats, 0, sizeof(m_list[i]->stats));
+            CORE_EXIT_ATOMIC();
+        }
+    }
+    else if (1 != argc)
+    {
+        console_printf("usage: periods [clear]");
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        periodic_stats_t s;
+
+        periodic_get_stats(m_list[i], &s);
+        periodic_print(m_list[i], &s);
+    }
+}
@@ -0,0 +1,70 @@
+/**
+ * @brief Periodic thread helper on absolute deadlines with overrun, miss
+ * and lateness counters.
+ *
+ * A periodic thread sleeps with osDelayUntil to deadlines that are a whole
+ * number of periods from its origin, so the time its work takes is not
+ * added to the period and errors do not add up:
+ *
+ *   periodic_setup(&p, "hp", 10000);
+ *   periodic_start(&p, osKernelGetTickCount());
+ *   for (;;)
+ *   {
+ *       periodic_wait(&p);
+ *       ...
+ *   }
+ *
+ * When the work of a period runs into the next deadline, that is an
+ * overrun and the wait returns right away. When it runs past whole
+ * periods those deadlines are missed, skipped and counted, and the thread
+ * goes on at the latest one, still on the phase of its origin.
+ *
+ * Each wait adds the lateness, the sys timer cycles from the deadline tick
+ * to the thread running again, to a log2 histogram (bucket n counts
+ * 2^(n-1) .. 2^n - 1 cycles). The periods console command prints every
+ * registered thread, "periods clear" starts the counts over.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef PERIODIC_H_
+#define PERIODIC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PERIODIC_BUCKETS 24 // Lateness histogram buckets, 2^23 cycles is 218 ms
+#define PERIODIC_MAX     4  // Threads listed by the console command
+
+typedef struct periodic_stats
+{
+    uint32_t periods;  // Deadlines reached
+    uint32_t overruns; // Work still running at the next deadline
+    uint32_t missed;   // Deadlines skipped
+    uint32_t max_late; // Cycles
+    uint32_t buckets[PERIODIC_BUCKETS];
+} periodic_stats_t;
+
+typedef struct periodic
+{
+    const char *name;
+    uint32_t period; // Ticks
+    uint32_t next;   // Next deadline, kernel tick
+    periodic_stats_t stats;
+} periodic_t;
+
+// Register the console command, before osKernelStart.
+void periodic_init(void);
+
+// Set up p with its period in ticks and list it on the console, false if the list is full.
+bool periodic_setup(periodic_t *p, const char *name, uint32_t period);
+
+// First deadline one period after the origin tick.
+void periodic_start(periodic_t *p, uint32_t origin);
+
+// Sleep until the next deadline and return it, in the thread that owns p.
+uint32_t periodic_wait(periodic_t *p);
+
+void periodic_get_stats(const periodic_t *p, periodic_stats_t *out);
+
+#endif//PERIODIC_H_
@@ -0,0 +1,315 @@
+/**
+ * @brief GPIO pin activity recorder, see pinrec.h.
+ *
+ * Producers are serialised with interrupts masked for the few stores of a
+ * record, the drain is the only consumer. Stamps are 32 bit system timer
+ * counts, the drain widens them to 64 bits by adding up the differences
+ * between records. A sync record carrying the tick count goes in before
+ * the first record, after every gap and whenever records are further apart
+ * than PINREC_SYNC_S, well within the 2^32 count wrap, so the widening
+ * never misses a wrap.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "pinrec.h"
+
+#if ESWGPIO_PIN_RECORD
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "cmsis_os2.h"
+#include "em_core.h"
+
+#define PINREC_MASK (PINREC_SIZE - 1)
+#define PINREC_SYNC_S 30 // Longest time between records without a sync, s
+#define PINREC_VCD_BUF 160 // Drain output is written in chunks of this size
+
+enum
+{
+    PINREC_PIN,
+    PINREC_SYNC, // stamp is osKernelGetTickCount
+    PINREC_GAP   // stamp is the number of records dropped here
+};
+
+#define PINREC_LEVEL_Z 2 // Pin disabled
+
+typedef struct pinrec_entry
+{
+    uint32_t stamp;
+    uint8_t kind;
+    uint8_t port;
+    uint8_t pin;
+    uint8_t level;
+} pinrec_entry_t;
+
+typedef struct pinrec_vcd
+{
+    pinrec_output_f output;
+    char buf[PINREC_VCD_BUF];
+    int len;
+} pinrec_vcd_t;
+
+static pinrec_entry_t m_ring[PINREC_SIZE];
+static volatile uint32_t m_head;
+static volatile uint32_t m_tail;
+static volatile uint32_t m_dropped;
+static uint32_t m_gap;           // Dropped since the last gap record
+static bool m_synced;
+static uint32_t m_sync_ticks;    // Tick count of the last record
+static uint32_t m_sync_period;   // PINREC_SYNC_S in ticks
+
+// Drain side
+static bool m_header;
+static uint64_t m_base;          // Widened stamp of the last record
+static uint64_t m_last_ns;
+static bool m_timed;
+
+void pinrec_init(void)
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    m_head = 0;
+    m_tail = 0;
+    m_dropped = 0;
+    m_gap = 0;
+    m_synced = false;
+    m_sync_period = PINREC_SYNC_S * osKernelGetTickFreq();
+    m_header = false;
+    m_timed = false;
+    CORE_EXIT_ATOMIC();
+}
+
+static void pinrec_put(uint32_t index, uint8_t kind, uint32_t stamp, uint8_t port, uint8_t pin, uint8_t level)
+{
+    pinrec_entry_t *e = &m_ring[index & PINREC_MASK];
+
+    e->stamp = stamp;
+    e->kind = kind;
+    e->port = port;
+    e->pin = pin;
+    e->level = level;
+}
+
+void pinrec_record(uint8_t port, uint8_t pin, uint8_t level)
+{
+    if (0 == (PINREC_PORT_MASK & (1UL << port)))
+    {
+        return;
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+
+    uint32_t head = m_head;
+    uint32_t ticks = osKernelGetTickCount();
+    bool sync = !m_synced || (ticks - m_sync_ticks >= m_sync_period);
+    uint32_t needed = 1 + (sync ? 1 : 0) + ((0 != m_gap) ? 1 : 0);
+
+    if (PINREC_SIZE - (head - m_tail) < needed)
+    {
+        // The records after a gap start from a fresh sync
+        m_dropped++;
+        m_gap++;
+        m_synced = false;
+    }
+    else
+    {
+        if (0 != m_gap)
+        {
+            pinrec_put(head++, PINREC_GAP, m_gap, 0, 0, 0);
+            m_gap = 0;
+        }
+        if (sync)
+        {
+            pinrec_put(head++, PINREC_SYNC, ticks, 0, 0, 0);
+            m_synced = true;
+        }
+        pinrec_put(head++, PINREC_PIN, osKernelGetSysTimerCount(), port, pin, level);
+        m_sync_ticks = ticks;
+
+        // The records must be complete before the drain can see the new head
+        __DMB();
+        m_head = head;
+    }
+
+    CORE_EXIT_ATOMIC();
+}
+
+void pinrec_exti(uint8_t line)
+{
+    uint32_t psel = (line < 8) ? GPIO->EXTIPSELL : GPIO->EXTIPSELH;
+    uint32_t isel = (line < 8) ? GPIO->EXTIPINSELL : GPIO->EXTIPINSELH;
+    uint8_t shift = 4 * (line & 7);
+    uint8_t port = (psel >> shift) & 0xF;
+    uint8_t pin = (line & 0xC) + ((isel >> shift) & 0x3);
+
+    // EXTI lines select a pin within their group of four
+    pinrec_record(port, pin, GPIO_PinInGet(port, pin));
+}
+
+uint32_t pinrec_dropped(void)
+{
+    return m_dropped;
+}
+
+// ________________________________ Wrappers _________________________________
+
+// The emlib calls themselves, not the wrappers
+#undef GPIO_PinModeSet
+#undef GPIO_PinOutSet
+#undef GPIO_PinOutClear
+#undef GPIO_PinOutToggle
+
+void pinrec_mode_set(GPIO_Port_TypeDef port, unsigned int pin, GPIO_Mode_TypeDef mode, unsigned int out)
+{
+    GPIO_PinModeSet(port, pin, mode, out);
+    pinrec_record(port, pin, (gpioModeDisabled == mode) ? PINREC_LEVEL_Z : GPIO_PinInGet(port, pin));
+}
+
+void pinrec_out_set(GPIO_Port_TypeDef port, unsigned int pin)
+{
+    GPIO_PinOutSet(port, pin);
+    pinrec_record(port, pin, 1);
+}
+
+void pinrec_out_clear(GPIO_Port_TypeDef port, unsigned int pin)
+{
+    GPIO_PinOutClear(port, pin);
+    pinrec_record(port, pin, 0);
+}
+
+void pinrec_out_toggle(GPIO_Port_TypeDef port, unsigned int pin)
+{
+    // Read back inside the same critical section, a concurrent toggle would
+    // otherwise record the same level twice
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    GPIO_PinOutToggle(port, pin);
+    pinrec_record(port, pin, GPIO_PinOutGet(port, pin));
+    CORE_EXIT_ATOMIC();
+}
+
+// ___________________________________ VCD ___________________________________
+
+static void pinrec_vcd_flush(pinrec_vcd_t *v)
+{
+    if (0 != v->len)
+    {
+        v->output(v->buf, v->len);
+        v->len = 0;
+    }
+}
+
+static void pinrec_vcd_put(pinrec_vcd_t *v, const char *text)
+{
+    while ('\0' != *text)
+    {
+        if (v->len == PINREC_VCD_BUF)
+        {
+            pinrec_vcd_flush(v);
+        }
+        v->buf[v->len++] = *text++;
+    }
+}
+
+// Decimal without the 64 bit printf support that newlib-nano lacks.
+static void pinrec_vcd_u64(pinrec_vcd_t *v, uint64_t value)
+{
+    char digits[21];
+    int i = sizeof(digits) - 1;
+
+    digits[i] = '\0';
+    do
+    {
+        digits[--i] = '0' + (value % 10);
+        value /= 10;
+    }
+    while (0 != value);
+    pinrec_vcd_put(v, &digits[i]);
+}
+
+static void pinrec_vcd_header(pinrec_vcd_t *v)
+{
+    char line[48];
+
+    pinrec_vcd_put(v, "$version esw-gpio pinrec $end\n$timescale 1 ns $end\n$scope module gpio $end\n");
+    for (uint8_t port = 0; port < 16; port++)
+    {
+        if (PINREC_PORT_MASK & (1UL << port))
+        {
+            for (uint8_t pin = 0; pin < 16; pin++)
+            {
+                snprintf(line, sizeof(line), "$var wire 1 %c%X P%c%u $end\n", 'A' + port, pin, 'A' + port, pin);
+                pinrec_vcd_put(v, line);
+            }
+        }
+    }
+    pinrec_vcd_put(v, "$upscope $end\n$enddefinitions $end\n");
+}
+
+static void pinrec_vcd_entry(pinrec_vcd_t *v, const pinrec_entry_t *e)
+{
+    static const char levels[] = {'0', '1', 'z'};
+    uint32_t freq = osKernelGetSysTimerFreq();
+    char line[8];
+    uint64_t ns;
+
+    switch (e->kind)
+    {
+        case PINREC_SYNC:
+            m_base = (uint64_t)e->stamp * (freq / osKernelGetTickFreq());
+            return;
+        case PINREC_GAP:
+            pinrec_vcd_put(v, "$comment dropped ");
+            pinrec_vcd_u64(v, e->stamp);
+            pinrec_vcd_put(v, " $end\n");
+            return;
+        default:
+            break;
+    }
+
+    m_base += (uint32_t)(e->stamp - (uint32_t)m_base);
+    ns = (m_base / freq) * 1000000000ULL + (m_base % freq) * 1000000000ULL / freq;
+    if (!m_timed || (ns != m_last_ns))
+    {
+        pinrec_vcd_put(v, "#");
+        pinrec_vcd_u64(v, ns);
+        pinrec_vcd_put(v, "\n");
+        m_last_ns = ns;
+        m_timed = true;
+    }
+    snprintf(line, sizeof(line), "%c%c%X\n", levels[e->level], 'A' + e->port, e->pin);
+    pinrec_vcd_put(v, line);
+}
+
+uint32_t pinrec_vcd_drain(pinrec_output_f output)
+{
+    pinrec_vcd_t v = {.output = output, .len = 0};
+    uint32_t tail = m_tail;
+    uint32_t count = m_head - tail;
+
+    if (!m_header)
+    {
+        pinrec_vcd_header(&v);
+        m_header = true;
+    }
+
+    // Records up to head are complete once head has been read
+    __DMB();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        pinrec_vcd_entry(&v, &m_ring[(tail + i) & PINREC_MASK]);
+    }
+
+    // Slots are only handed back after they have been formatted
+    __DMB();
+    m_tail = tail + count;
+
+    pinrec_vcd_flush(&v);
+    return count;
+}
+
+#endif//ESWGPIO_PIN_RECORD
@@ -0,0 +1,75 @@
+/**
+ * @brief Recorder of GPIO pin activity with VCD export, a logic analyzer in
+ * RAM.
+ *
+ * With PIN_RECORD=1 this header replaces GPIO_PinOutSet, GPIO_PinOutClear,
+ * GPIO_PinOutToggle and GPIO_PinModeSet in every file that includes it after
+ * em_gpio.h, and the EXTI dispatch records the input level of every line it
+ * serves. Each change goes into a fixed ring of 8 byte records stamped with
+ * osKernelGetSysTimerCount, from threads and interrupts alike.
+ *
+ * pinrec_vcd_drain turns the records into VCD text for an output function,
+ * the application drains the ring to the serial port from a low priority
+ * thread, so a recording can run for any length of time in the memory of
+ * the ring. When the drain falls behind, new records are dropped and the
+ * count shows up as a $comment in the VCD. Pins driven by the LDMA or by a
+ * TIMER do not go through software and are not recorded, the host build
+ * writes those directly, see host/vcd.c.
+ *
+ * Only the pins of the ports in PINREC_PORT_MASK are recorded and declared.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef PINREC_H_
+#define PINREC_H_
+
+#include <stdint.h>
+
+#include "em_gpio.h"
+
+#define PINREC_SIZE 1024 // Records, power of two, 8 bytes each
+
+#ifndef PINREC_PORT_MASK
+#define PINREC_PORT_MASK ((1UL << gpioPortA) | (1UL << gpioPortF))
+#endif//PINREC_PORT_MASK
+
+typedef int (*pinrec_output_f)(const char *ptr, int len);
+
+#if ESWGPIO_PIN_RECORD
+
+// Clear the ring, before the first pin is configured.
+void pinrec_init(void);
+
+// Record a pin level, safe in interrupt context.
+void pinrec_record(uint8_t port, uint8_t pin, uint8_t level);
+
+// Record the input pin selected for an EXTI line, from its interrupt handler.
+void pinrec_exti(uint8_t line);
+
+// Write the VCD header on the first call and the records since the last call,
+// returns the number of records written. Single consumer.
+uint32_t pinrec_vcd_drain(pinrec_output_f output);
+
+// Records lost because the ring was full.
+uint32_t pinrec_dropped(void);
+
+void pinrec_mode_set(GPIO_Port_TypeDef port, unsigned int pin, GPIO_Mode_TypeDef mode, unsigned int out);
+void pinrec_out_set(GPIO_Port_TypeDef port, unsigned int pin);
+void pinrec_out_clear(GPIO_Port_TypeDef port, unsigned int pin);
+void pinrec_out_toggle(GPIO_Port_TypeDef port, unsigned int pin);
+
+#define GPIO_PinModeSet(port, pin, mode, out) pinrec_mode_set((port), (pin), (mode), (out))
+#define GPIO_PinOutSet(port, pin)             pinrec_out_set((port), (pin))
+#define GPIO_PinOutClear(port, pin)           pinrec_out_clear((port), (pin))
+#define GPIO_PinOutToggle(port, pin)          pinrec_out_toggle((port), (pin))
+
+#else
+
+static inline void pinrec_init(void) {}
+static inline void pinrec_exti(uint8_t line) {}
+static inline uint32_t pinrec_vcd_drain(pinrec_output_f output) { return 0; }
+
+#endif//ESWGPIO_PIN_RECORD
+
+#endif//PINREC_H_
@@ -0,0 +1,236 @@
+/**
+ * @brief LDMA waveform playback on the buzzer pin, see playback.h.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "playback.h"
+
+#include <string.h>
+
+#include "em_cmu.h"
+#include "em_gpio.h"
+#include "em_ldma.h"
+#include "em_timer.h"
+
+#include "ldma_irq.h"
+#include "pinrec.h"
+
+#define PLAYBACK_CH          0
+#define PLAYBACK_CH_MASK     (1UL << PLAYBACK_CH)
+#define PLAYBACK_TIMER       TIMER1
+#define PLAYBACK_TIMER_CLOCK cmuClock_TIMER1
+#define PLAYBACK_PORT        gpioPortA
+#define PLAYBACK_PIN         0
+#define PLAYBACK_TOP_MAX     0xFFFFUL
+#define PLAYBACK_PRESCALE_MAX 10 // timerPrescale1024
+
+static LDMA_Descriptor_t m_desc[2];
+static uint32_t *m_buf[2];
+static uint32_t m_valid[2];
+static bool m_ready[2]; // Refilled and not reached by the LDMA since
+static uint32_t m_len;
+static uint8_t m_playing; // Buffer the LDMA was in at the last interrupt
+static volatile bool m_active;
+static bool m_eos;
+
+static playback_refill_f m_refill;
+static playback_done_f m_done;
+static void *m_user;
+
+static playback_stats_t m_stats;
+
+static void playback_irq(uint8_t ch, void *context);
+
+// Ask the producer for the next block of buffer b, pad with no-toggle words.
+static void playback_fill(uint8_t b)
+{
+    uint32_t n = 0;
+
+    if (!m_eos)
+    {
+        n = m_refill(m_buf[b], m_len, m_user);
+        if (n > m_len)
+        {
+            n = m_len;
+        }
+        if (0 == n)
+        {
+            m_eos = true;
+        }
+        else if (n < m_len)
+        {
+            m_stats.underruns++;
+        }
+        m_stats.buffers++;
+    }
+
+    if (n < m_len)
+    {
+        memset(&m_buf[b][n], 0, (m_len - n) * sizeof(uint32_t));
+    }
+    m_valid[b] = n;
+    m_ready[b] = true;
+}
+
+// Buffer the LDMA is in, from the source address of the channel. Once a buffer
+// is done the address is already that of the next one.
+static uint8_t playback_current(void)
+{
+    uintptr_t src = LDMA->CH[PLAYBACK_CH].SRC;
+    uintptr_t start = (uintptr_t)m_buf[1];
+
+    return ((src >= start) && (src < start + m_len * sizeof(uint32_t))) ? 1 : 0;
+}
+
+static bool playback_timer_start(uint32_t sample_rate)
+{
+    TIMER_Init_TypeDef init = TIMER_INIT_DEFAULT;
+    uint32_t clock = CMU_ClockFreqGet(PLAYBACK_TIMER_CLOCK);
+
+    for (uint32_t p = 0; p <= PLAYBACK_PRESCALE_MAX; p++)
+    {
+        uint32_t counts = (clock >> p) / sample_rate;
+
+        if ((counts >= 2) && (counts - 1 <= PLAYBACK_TOP_MAX))
+        {
+            init.enable = false;
+            init.prescale = (TIMER_Prescale_TypeDef)p;
+            init.dmaClrAct = true; // Overflow request is cleared when the LDMA serves it
+            TIMER_Init(PLAYBACK_TIMER, &init);
+            TIMER_TopSet(PLAYBACK_TIMER, counts - 1);
+            TIMER_CounterSet(PLAYBACK_TIMER, 0);
+            TIMER_Enable(PLAYBACK_TIMER, true);
+            return true;
+        }
+    }
+    return false;
+}
+
+void playback_init(void)
+{
+    ldma_irq_init();
+    CMU_ClockEnable(PLAYBACK_TIMER_CLOCK, true);
+    ldma_irq_register(PLAYBACK_CH, playback_irq, NULL);
+    m_active = false;
+}
+
+bool playback_start(uint32_t *buf0, uint32_t *buf1, uint32_t len, uint32_t sample_rate,
+                    playback_refill_f refill, playback_done_f done, void *user)
+{
+    LDMA_TransferCfg_t cfg = LDMA_TRANSFER_CFG_PERIPHERAL(ldmaPeripheralSignal_TIMER1_UFOF);
+    volatile uint32_t *dst = &GPIO->P[PLAYBACK_PORT].DOUTTGL;
+
+    if ((NULL == refill) || (0 == len) || (len > PLAYBACK_MAX_BLOCK) || (0 == sample_rate))
+    {
+        return false;
+    }
+
+    playback_stop();
+
+    m_buf[0] = buf0;
+    m_buf[1] = buf1;
+    m_len = len;
+    m_refill = refill;
+    m_done = done;
+    m_user = user;
+    m_eos = false;
+    m_playing = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    playback_fill(0);
+    playback_fill(1);
+    if (0 == m_valid[0])
+    {
+        return false;
+    }
+    m_ready[0] = false; // The LDMA starts in it
+
+    // Ping-pong loop, each descriptor raises the channel done interrupt
+    m_desc[0] = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_LINKREL_M2P_BYTE(buf0, dst, len, 1);
+    m_desc[1] = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_LINKREL_M2P_BYTE(buf1, dst, len, -1);
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        m_desc[i].xfer.size = ldmaCtrlSizeWord;
+        m_desc[i].xfer.doneIfs = 1;
+    }
+
+    m_active = true;
+    LDMA_IntEnable(PLAYBACK_CH_MASK);
+    LDMA_StartTransfer(PLAYBACK_CH, &cfg, &m_desc[0]);
+
+    if (!playback_timer_start(sample_rate))
+    {
+        playback_stop();
+        return false;
+    }
+    return true;
+}
+
+void playback_stop(void)
+{
+    TIMER_Enable(PLAYBACK_TIMER, false);
+    LDMA_StopTransfer(PLAYBACK_CH);
+    LDMA_IntClear(PLAYBACK_CH_MASK);
+    GPIO_PinOutClear(PLAYBACK_PORT, PLAYBACK_PIN);
+    m_active = false;
+}
+
+bool playback_active(void)
+{
+    return m_active;
+}
+
+void playback_get_stats(playback_stats_t *stats)
+{
+    *stats = m_stats;
+}
+
+void playback_pack_levels(const uint8_t *bits, uint32_t nbits, uint32_t *words, uint8_t *level)
+{
+    uint8_t current = *level;
+
+    for (uint32_t i = 0; i < nbits; i++)
+    {
+        uint8_t next = (bits[i / 8] >> (i % 8)) & 1;
+
+        words[i] = (next != current) ? PLAYBACK_TOGGLE : 0;
+        current = next;
+    }
+    *level = current;
+}
+
+// Channel done, the LDMA moved on to the other buffer. When the interrupt is
+// late, done interrupts of both buffers merge and the LDMA is back in the
+// buffer it was in last time, which it reached before the refill.
+static void playback_irq(uint8_t ch, void *context)
+{
+    uint8_t playing = playback_current();
+    uint8_t entered = (playing != m_playing) ? 1 : 2;
+
+    for (uint8_t i = 1; i <= entered; i++)
+    {
+        uint8_t b = m_playing ^ (i & 1);
+
+        if (!m_ready[b])
+        {
+            m_stats.late++;
+        }
+        m_ready[b] = false;
+    }
+    m_playing = playing;
+
+    // Stop if it moved on to an empty buffer
+    if (m_eos && (0 == m_valid[playing]))
+    {
+        playback_stop();
+        if (NULL != m_done)
+        {
+            m_done(m_user);
+        }
+    }
+    else
+    {
+        playback_fill(playing ^ 1);
+    }
+}
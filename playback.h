@@ -0,0 +1,62 @@
+/**
+ * @brief LDMA waveform playback on the buzzer pin.
+ *
+ * A stream of toggle words is written to the port A DOUTTGL register by
+ * the LDMA, one word per TIMER1 overflow. Each word is a toggle mask for
+ * the port, so 0 keeps the pin level and PLAYBACK_TOGGLE flips PA0 without
+ * disturbing the other port A pins (the blue LED is on PA5).
+ *
+ * Two buffers are linked into a ping-pong descriptor loop. When the LDMA
+ * finishes one buffer it continues with the other and the finished one is
+ * handed to the refill callback, so edges cost no CPU at all and the CPU
+ * only runs once per buffer. Which buffer is done comes from the source
+ * address of the channel, so an interrupt that runs late, after both done
+ * interrupts merged, still refills the buffer the LDMA is not in and
+ * counts the one it reached too early.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef PLAYBACK_H_
+#define PLAYBACK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PLAYBACK_TOGGLE    (1UL << 0) // Toggle word for PA0
+#define PLAYBACK_MAX_BLOCK 2048       // LDMA XFERCNT limit per descriptor
+
+// Fill buf with up to len toggle words, called from the LDMA interrupt.
+// Returning less than len is an underrun and the rest is padded with 0,
+// returning 0 ends the stream once the other buffer has played out.
+typedef uint32_t (*playback_refill_f)(uint32_t *buf, uint32_t len, void *user);
+
+// Called from the LDMA interrupt after the last buffer has played out.
+typedef void (*playback_done_f)(void *user);
+
+typedef struct playback_stats
+{
+    uint32_t buffers;   // Buffers handed to the refill callback
+    uint32_t underruns; // Refills that returned less than a full buffer
+    uint32_t late;      // Buffers the LDMA reached before they were refilled, played stale
+} playback_stats_t;
+
+// Enable LDMA and TIMER1 clocks, nothing is started.
+void playback_init(void);
+
+// Prime both buffers and start streaming len words each at sample_rate Hz.
+bool playback_start(uint32_t *buf0, uint32_t *buf1, uint32_t len, uint32_t sample_rate,
+                    playback_refill_f refill, playback_done_f done, void *user);
+
+// Stop streaming immediately and drive the buzzer pin low.
+void playback_stop(void);
+
+bool playback_active(void);
+
+void playback_get_stats(playback_stats_t *stats);
+
+// Convert nbits of a level bitstream (LSB first) into toggle words.
+// level holds the pin level between calls, start with 0 for an idle pin.
+void playback_pack_levels(const uint8_t *bits, uint32_t nbits, uint32_t *words, uint8_t *level);
+
+#endif//PLAYBACK_H_
@@ -0,0 +1,293 @@
+/**
+ * @brief Per-task CPU time and stack high water marks, see prof.h.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "prof.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "em_device.h"
+#include "em_core.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "console.h"
+#include "sleep.h"
+
+#include "loglevels.h"
+#define __MODUUL__ "prof"
+#define __LOG_LEVEL__ LOG_MODULE_LEVEL(prof)
+#include "log.h"
+
+#define PROF_RECORD_MAX 192
+
+typedef struct prof_task
+{
+    TaskHandle_t handle;
+    const char *name;
+    const void *stack_base; // Matches the stack_mem of the table entry
+    uint32_t stack_size;    // From the table, 0 for the kernel tasks
+    uint32_t stack_free;    // Bytes never used
+    uint32_t run;           // Run time counter at the last sample
+    uint16_t permille;      // CPU of the last window, 0.1 %
+    bool warned;            // Stack nearly full, warned once
+} prof_task_t;
+
+static const task_def_t *m_table;
+static uint32_t m_table_count;
+
+static prof_task_t m_tasks[PROF_TASKS];
+static uint32_t m_count;
+static uint32_t m_total;  // Run time counter total at the last sample
+static uint32_t m_window; // Cycles of the last window
+static uint32_t m_cost;   // Cycles the last sample took
+static bool m_cpu;        // The port keeps run time counters, see prof_sample
+static bool m_overflow;   // More tasks than PROF_TASKS, warned once
+
+static TaskStatus_t m_status[PROF_TASKS];
+
+static void prof_command(int argc, char **argv);
+
+void prof_init(const task_def_t *table, uint32_t count)
+{
+    // The kernel reads CYCCNT from here on, it is never reset
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    m_table = table;
+    m_table_count = count;
+    m_count = 0;
+    m_total = sleep_run_time();
+    console_register("prof", prof_command, "task CPU and stack use");
+}
+
+static uint32_t prof_stack_size(const void *stack_base)
+{
+    for (uint32_t i = 0; i < m_table_count; i++)
+    {
+        if ((NULL != stack_base) && (m_table[i].attr.stack_mem == stack_base))
+        {
+            return m_table[i].attr.stack_size;
+        }
+    }
+    return 0;
+}
+
+static prof_task_t *prof_find(TaskHandle_t handle)
+{
+    for (uint32_t i = 0; i < m_count; i++)
+    {
+        if (m_tasks[i].handle == handle)
+        {
+            return &m_tasks[i];
+        }
+    }
+    if (m_count < PROF_TASKS)
+    {
+        m_tasks[m_count] = (prof_task_t){.handle = handle};
+        return &m_tasks[m_count++];
+    }
+    return NULL;
+}
+
+void prof_sample(void)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint32_t total;
+    UBaseType_t n = uxTaskGetSystemState(m_status, PROF_TASKS, &total);
+
+    if (0 == n)
+    {
+        if (!m_overflow)
+        {
+            warn1("more than %u tasks", PROF_TASKS);
+            m_overflow = true;
+        }
+        return;
+    }
+
+    uint32_t window = total - m_total;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    // A port without run time stats, or the host in virtual time, reports no total
+    m_cpu = (0 != total);
+    for (UBaseType_t i = 0; i < n; i++)
+    {
+        const TaskStatus_t *st = &m_status[i];
+        prof_task_t *t = prof_find(st->xHandle);
+
+        if (NULL == t)
+        {
+            continue;
+        }
+        if (NULL == t->name)
+        {
+            // A new task, all of its run time falls in this window
+            t->name = st->pcTaskName;
+            t->stack_base = st->pxStackBase;
+            t->stack_size = prof_stack_size(st->pxStackBase);
+            t->run = 0;
+        }
+        t->permille = (0 != window) ? (uint16_t)((uint64_t)(st->ulRunTimeCounter - t->run) * 1000 / window) : 0;
+        t->run = st->ulRunTimeCounter;
+        t->stack_free = st->usStackHighWaterMark * sizeof(StackType_t);
+    }
+    m_total = total;
+    m_window = window;
+    CORE_EXIT_ATOMIC();
+
+    m_cost = DWT->CYCCNT - start;
+}
+
+static uint32_t prof_stack_used(const prof_task_t *t)
+{
+    return (t->stack_free < t->stack_size) ? t->stack_size - t->stack_free : t->stack_size;
+}
+
+// High water mark and a quarter, rounded up.
+static uint32_t prof_stack_recommend(const prof_task_t *t)
+{
+    uint32_t used = prof_stack_used(t);
+
+    return (used + used / 4 + PROF_STACK_ROUND - 1) / PROF_STACK_ROUND * PROF_STACK_ROUND;
+}
+
+static const prof_task_t *prof_by_stack(const void *stack_base)
+{
+    for (uint32_t i = 0; i < m_count; i++)
+    {
+        if (m_tasks[i].stack_base == stack_base)
+        {
+            return &m_tasks[i];
+        }
+    }
+    return NULL;
+}
+
+static const prof_task_t *prof_by_name(const char *name)
+{
+    for (uint32_t i = 0; i < m_count; i++)
+    {
+        if (0 == strcmp(m_tasks[i].name, name))
+        {
+            return &m_tasks[i];
+        }
+    }
+    return NULL;
+}
+
+// CPU % and stack bytes used of t as far as they are known, nothing if neither is
+static int prof_fields(char *buf, size_t size, const prof_task_t *t)
+{
+    if (m_cpu && PROF_STACK_WATCH)
+    {
+        return snprintf(buf, size, " %u.%u/%" PRIu32, t->permille / 10, t->permille % 10, prof_stack_used(t));
+    }
+    if (m_cpu)
+    {
+        return snprintf(buf, size, " %u.%u", t->permille / 10, t->permille % 10);
+    }
+    if (PROF_STACK_WATCH)
+    {
+        return snprintf(buf, size, " %" PRIu32, prof_stack_used(t));
+    }
+    return 0;
+}
+
+void prof_heartbeat(void)
+{
+    char record[PROF_RECORD_MAX] = "";
+    int len = 0;
+
+    // Tasks of the table in table order with their full names, none if neither field is known
+    for (uint32_t i = 0; (m_cpu || PROF_STACK_WATCH) && (i < m_table_count) && (len < (int)sizeof(record)); i++)
+    {
+        const prof_task_t *t = prof_by_stack(m_table[i].attr.stack_mem);
+
+        if (NULL != t)
+        {
+            len += snprintf(&record[len], sizeof(record) - len, " %s", t->name);
+        }
+        if ((NULL != t) && (len < (int)sizeof(record)))
+        {
+            len += prof_fields(&record[len], sizeof(record) - len, t);
+        }
+    }
+
+    const prof_task_t *idle = prof_by_name("IDLE");
+
+    if (m_cpu && (NULL != idle) && (len < (int)sizeof(record)))
+    {
+        len += snprintf(&record[len], sizeof(record) - len, " | idle %u.%u", idle->permille / 10, idle->permille % 10);
+    }
+    info1("Heartbeat%s", record);
+
+    for (uint32_t i = 0; PROF_STACK_WATCH && (i < m_count); i++)
+    {
+        prof_task_t *t = &m_tasks[i];
+
+        if ((0 != t->stack_size) && !t->warned && (prof_stack_used(t) > t->stack_size / 8 * 7))
+        {
+            warn1("%s stack %" PRIu32 " of %" PRIu32 " bytes used", t->name, prof_stack_used(t), t->stack_size);
+            t->warned = true;
+        }
+    }
+}
+
+static void prof_command(int argc, char **argv)
+{
+    prof_task_t tasks[PROF_TASKS];
+    uint32_t count;
+    uint32_t window;
+    uint32_t cost;
+    bool cpu;
+
+    // Consistent with one sample, prof_sample runs in a higher priority thread
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    count = m_count;
+    window = m_window;
+    cost = m_cost;
+    cpu = m_cpu;
+    memcpy(tasks, m_tasks, count * sizeof(prof_task_t));
+    CORE_EXIT_ATOMIC();
+
+    console_printf("%-22s cpu %%  stack  used  free   rec", "task");
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const prof_task_t *t = &tasks[i];
+        char load[8] = "    -";
+
+        if (cpu)
+        {
+            snprintf(load, sizeof(load), "%3u.%u", t->permille / 10, t->permille % 10);
+        }
+
+        if (!PROF_STACK_WATCH)
+        {
+            // Not the device stacks, only the size is worth showing
+            console_printf("%-22s %s  %5" PRIu32 "     -     -     -", t->name, load, t->stack_size);
+        }
+        else if ((0 != t->stack_size) && (0 == t->stack_free))
+        {
+            // Used to the last word, possibly beyond, the real need is not known
+            console_printf("%-22s %s  %5" PRIu32 "  full     0  over", t->name, load, t->stack_size);
+        }
+        else if (0 != t->stack_size)
+        {
+            console_printf("%-22s %s  %5" PRIu32 " %5" PRIu32 " %5" PRIu32 " %5" PRIu32, t->name, load,
+                           t->stack_size, prof_stack_used(t), t->stack_free, prof_stack_recommend(t));
+        }
+        else
+        {
+            console_printf("%-22s %s      -     - %5" PRIu32 "     -", t->name, load, t->stack_free);
+        }
+    }
+    console_printf("window %" PRIu32 " cycles, last sample %" PRIu32 " cycles", window, cost);
+}
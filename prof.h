@@ -0,0 +1,60 @@
+/**
+ * @brief Per-task CPU time and stack high water marks, from the FreeRTOS
+ * run time stats.
+ *
+ * The kernel adds the DWT cycle counter difference to the task it switches
+ * out (configGENERATE_RUN_TIME_STATS with portGET_RUN_TIME_COUNTER_VALUE
+ * on CYCCNT, set in the Makefile), two register reads per context switch.
+ * CYCCNT stops while the core sleeps, the counter the kernel reads is
+ * sleep_run_time with the slept time added, see sleep.h.
+ * prof_sample takes the counters and the stack high water marks of all
+ * tasks with one uxTaskGetSystemState call and keeps the difference to the
+ * previous sample as the CPU use of the window, once per heartbeat.
+ *
+ * The heartbeat record has the CPU % of the window and the stack bytes
+ * used so far for the tasks of the table, then the idle time:
+ *
+ *   Heartbeat hp 0.1/1104 button 0.0/620 console 0.0/488 | idle 99.8
+ *
+ * Fields that are not measured are left out. The CPU % and the idle time
+ * need a run time total from the port, which a kernel without run time
+ * stats and the host in virtual time report as 0. The stack bytes need
+ * PROF_STACK_WATCH, which the host build clears.
+ *
+ * The prof console command lists every task with its stack size and the
+ * size it recommends, the high water mark with a quarter on top, rounded
+ * up to PROF_STACK_ROUND, and the cost of the last sample. A task that has
+ * used more than 7/8 of its stack is warned about in the heartbeat, one
+ * that has used all of it is shown as full, how much more it needed is not
+ * known.
+ *
+ * The 32 bit counter wraps in 111 s at 38.4 MHz, windows must be shorter.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef PROF_H_
+#define PROF_H_
+
+#include <stdint.h>
+
+#include "tasks.h"
+
+#define PROF_TASKS       12 // Tasks sampled, the kernel ones included
+#define PROF_STACK_ROUND 64 // Stack recommendations are multiples of this, bytes
+
+// 0 where the stacks are not the device ones
+#ifndef PROF_STACK_WATCH
+#define PROF_STACK_WATCH 1
+#endif
+
+// Start the cycle counter, before osKernelStart. The table gives the stack sizes.
+void prof_init(const task_def_t *table, uint32_t count);
+
+// Close the current window and start the next one.
+void prof_sample(void);
+
+// Log the heartbeat record of the last window.
+void prof_heartbeat(void);
+
+#endif//PROF_H_
@@ -0,0 +1,333 @@
+/**
+ * @brief Tickless idle in EM1 and EM2, see sleep.h.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "sleep.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "em_device.h"
+#include "em_core.h"
+#include "em_cmu.h"
+#include "em_emu.h"
+#include "em_ldma.h"
+#include "em_rtcc.h"
+#include "cmsis_os2.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "console.h"
+
+#define SLEEP_RTCC_HZ      32768 // LFXO, RTCC not prescaled
+#define SLEEP_RTCC_CH      1     // Compare channel of the wakeup
+#define SLEEP_MIN_COUNTS   2     // A compare closer than this may be missed
+
+typedef struct sleep_state
+{
+    sleep_stats_t stats[SLEEP_MODES];
+    uint32_t aborted;     // Idle ended before the sleep, by a ready task or a tick
+    uint32_t tick_hz;
+    uint32_t frac;        // Time since the last kernel tick not yet stepped, 1/(32768*tick_hz) s
+    bool em2;             // EM2 allowed
+    uint32_t em2_min;     // Shortest idle time for EM2, ticks
+    uint32_t hold_until;  // EM1 only up to this tick
+    uint32_t wake_stamp;  // DWT cycles when the core was back
+    uint8_t wake_mode;
+    bool armed;           // A wakeup waits for its thread
+    uint32_t core_hz;
+    uint32_t lost;        // Cycles slept that CYCCNT did not count, it stops with the core clock
+    uint32_t lost_frac;   // Remainder of the conversion from RTCC counts, 1/32768 cycles
+} sleep_state_t;
+
+static sleep_state_t m;
+
+static void sleep_command(int argc, char **argv);
+
+void sleep_init(void)
+{
+    RTCC_Init_TypeDef init = RTCC_INIT_DEFAULT;
+    RTCC_CCChConf_TypeDef compare = RTCC_CH_INIT_COMPARE_DEFAULT;
+
+    m.tick_hz = osKernelGetTickFreq();
+    m.core_hz = osKernelGetSysTimerFreq();
+    m.em2 = true;
+    m.em2_min = SLEEP_EM2_MIN_TICKS;
+
+    // The RTCC keeps counting in EM2, free running over all 32 bits
+    CMU_ClockSelectSet(cmuClock_LFE, cmuSelect_LFXO);
+    CMU_ClockEnable(cmuClock_RTCC, true);
+    init.enable = false;
+    init.presc = rtccCntPresc_1;
+    RTCC_Init(&init);
+    RTCC_ChannelInit(SLEEP_RTCC_CH, &compare);
+    RTCC_IntClear(RTCC_IF_CC1);
+    NVIC_ClearPendingIRQ(RTCC_IRQn);
+    NVIC_EnableIRQ(RTCC_IRQn);
+    RTCC_Enable(true);
+
+    console_register("sleep", sleep_command, "idle sleep counts and wakeup latency");
+}
+
+// Only wakes the core, the compare interrupt is disabled again right after the sleep.
+void RTCC_IRQHandler(void)
+{
+    RTCC_IntClear(RTCC_IntGet());
+}
+
+static void sleep_add(sleep_stats_t *s, uint32_t cycles)
+{
+    uint32_t bucket = (0 == cycles) ? 0 : 32 - __CLZ(cycles);
+
+    if (bucket >= SLEEP_BUCKETS)
+    {
+        bucket = SLEEP_BUCKETS - 1;
+    }
+    s->buckets[bucket]++;
+    s->wakes++;
+    if (cycles > s->max)
+    {
+        s->max = cycles;
+    }
+}
+
+void sleep_thread_wake(void)
+{
+    uint32_t wake = DWT->CYCCNT;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    if (m.armed)
+    {
+        m.armed = false;
+        sleep_add(&m.stats[m.wake_mode], wake - m.wake_stamp);
+    }
+    CORE_EXIT_ATOMIC();
+}
+
+uint32_t sleep_run_time(void)
+{
+    return DWT->CYCCNT + __atomic_load_n(&m.lost, __ATOMIC_RELAXED);
+}
+
+void sleep_em2_hold(uint32_t ms)
+{
+    uint32_t until = osKernelGetTickCount() + ms * m.tick_hz / 1000;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    // Holds only get longer
+    if ((int32_t)(until - m.hold_until) > 0)
+    {
+        m.hold_until = until;
+    }
+    CORE_EXIT_ATOMIC();
+}
+
+void sleep_get(sleep_mode_t mode, sleep_stats_t *out)
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    *out = m.stats[mode];
+    CORE_EXIT_ATOMIC();
+}
+
+#if 2 == configUSE_TICKLESS_IDLE
+
+// EM2 stops the HF clocks, anything running on them keeps the core in EM1.
+static sleep_mode_t sleep_mode(TickType_t expected)
+{
+    if (!m.em2 || (expected < m.em2_min) || ((int32_t)(m.hold_until - osKernelGetTickCount()) > 0))
+    {
+        return SLEEP_EM1;
+    }
+    for (int ch = 0; ch < LDMA_CH_NUM; ch++)
+    {
+        if (LDMA_ChannelEnabled(ch))
+        {
+            return SLEEP_EM1;
+        }
+    }
+    if ((TIMER0->STATUS & TIMER_STATUS_RUNNING) || (TIMER1->STATUS & TIMER_STATUS_RUNNING))
+    {
+        return SLEEP_EM1;
+    }
+    // The last log byte is still going out
+    if (!(USART0->STATUS & USART_STATUS_TXC))
+    {
+        return SLEEP_EM1;
+    }
+    return SLEEP_EM2;
+}
+
+// Called by the idle task with the scheduler suspended, for the time no task is due.
+void vPortSuppressTicksAndSleep(TickType_t expected)
+{
+    uint32_t per_tick = SysTick->LOAD + 1;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    m.armed = false;
+
+    if (expected > SLEEP_MAX_TICKS)
+    {
+        expected = SLEEP_MAX_TICKS;
+    }
+    if (eAbortSleep == eTaskConfirmSleepModeStatus())
+    {
+        m.aborted++;
+        CORE_EXIT_ATOMIC();
+        return;
+    }
+
+    // A tick that came in meanwhile is taken first, the sleep is tried again after it
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+    {
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        m.aborted++;
+        CORE_EXIT_ATOMIC();
+        return;
+    }
+
+    // Time is counted in 1/(32768 * tick_hz) s, a tick and an RTCC count are both whole
+    uint64_t tick = SLEEP_RTCC_HZ;
+    uint64_t done = m.frac + (uint64_t)(per_tick - 1 - SysTick->VAL) * tick / per_tick;
+    uint64_t left = expected * tick;
+    uint32_t counts = (done < left) ? (uint32_t)((left - done + m.tick_hz - 1) / m.tick_hz) : 0;
+
+    if (counts < SLEEP_MIN_COUNTS)
+    {
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        m.aborted++;
+        CORE_EXIT_ATOMIC();
+        return;
+    }
+
+    sleep_mode_t mode = sleep_mode(expected);
+    uint32_t start = RTCC_CounterGet();
+    uint32_t cycles = DWT->CYCCNT;
+
+    RTCC_ChannelCCVSet(SLEEP_RTCC_CH, start + counts);
+    RTCC_IntClear(RTCC_IF_CC1);
+    RTCC_IntEnable(RTCC_IF_CC1);
+
+    // Wakes on any enabled interrupt, masked, the handler runs after the tick is set right
+    if (SLEEP_EM2 == mode)
+    {
+        EMU_EnterEM2(true);
+    }
+    else
+    {
+        EMU_EnterEM1();
+    }
+    m.wake_stamp = DWT->CYCCNT;
+    m.wake_mode = mode;
+
+    uint32_t slept = RTCC_CounterGet() - start;
+    bool timed = (0 != (RTCC_IntGet() & RTCC_IF_CC1));
+
+    // The run time stats go on where CYCCNT stopped, the sleep is idle time
+    uint64_t asleep = (uint64_t)slept * m.core_hz + m.lost_frac;
+    uint32_t counted = m.wake_stamp - cycles;
+
+    m.lost_frac = (uint32_t)(asleep % SLEEP_RTCC_HZ);
+    if (asleep / SLEEP_RTCC_HZ > counted)
+    {
+        __atomic_store_n(&m.lost, m.lost + (uint32_t)(asleep / SLEEP_RTCC_HZ - counted), __ATOMIC_RELAXED);
+    }
+
+    RTCC_IntDisable(RTCC_IF_CC1);
+    RTCC_IntClear(RTCC_IF_CC1);
+    NVIC_ClearPendingIRQ(RTCC_IRQn);
+
+    // Whole ticks go to the kernel, the rest is carried to the next sleep. The last tick
+    // is pended so the task it is due for runs right away, the SysTick restarts in phase.
+    done += (uint64_t)slept * m.tick_hz;
+    uint32_t ticks = (done / tick < expected) ? (uint32_t)(done / tick) : expected;
+    uint64_t frac = done - ticks * tick;
+
+    m.frac = (frac < tick) ? (uint32_t)frac : (uint32_t)tick - 1;
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    if (0 != ticks)
+    {
+        vTaskStepTick(ticks - 1);
+        SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+    }
+
+    sleep_stats_t *s = &m.stats[mode];
+
+    s->sleeps++;
+    s->early += timed ? 0 : 1;
+    s->rtcc += slept;
+    m.armed = true;
+    CORE_EXIT_ATOMIC();
+}
+
+#endif//configUSE_TICKLESS_IDLE
+
+static void sleep_print(const char *name, const sleep_stats_t *s)
+{
+    char line[120];
+    int len;
+
+    console_printf("%s sleeps %" PRIu32 " early %" PRIu32 " asleep %" PRIu32 " ms",
+                   name, s->sleeps, s->early, (uint32_t)(s->rtcc * 1000 / SLEEP_RTCC_HZ));
+    len = snprintf(line, sizeof(line), "%s wakes %" PRIu32 " max %" PRIu32 " |", name, s->wakes, s->max);
+
+    // Only non-empty buckets, as <2^n:count
+    for (uint8_t b = 0; (b < SLEEP_BUCKETS) && (len > 0) && (len < (int)sizeof(line)); b++)
+    {
+        if (0 != s->buckets[b])
+        {
+            len += snprintf(&line[len], sizeof(line) - len, " <2^%u:%" PRIu32, b, s->buckets[b]);
+        }
+    }
+    console_printf("%s", line);
+}
+
+static void sleep_command(int argc, char **argv)
+{
+    static const char * const names[SLEEP_MODES] = {"em1", "em2"};
+
+    if ((3 == argc) && (0 == strcmp(argv[1], "em2")) && (0 == strcmp(argv[2], "on")))
+    {
+        m.em2 = true;
+    }
+    else if ((3 == argc) && (0 == strcmp(argv[1], "em2")) && (0 == strcmp(argv[2], "off")))
+    {
+        m.em2 = false;
+    }
+    else if ((3 == argc) && (0 == strcmp(argv[1], "min")))
+    {
+        m.em2_min = strtoul(argv[2], NULL, 10);
+    }
+    else if ((2 == argc) && (0 == strcmp(argv[1], "clear")))
+    {
+        CORE_DECLARE_IRQ_STATE;
+        CORE_ENTER_ATOMIC();
+        memset(m.stats, 0, sizeof(m.stats));
+        m.aborted = 0;
+        CORE_EXIT_ATOMIC();
+    }
+    else if (1 != argc)
+    {
+        console_printf("usage: sleep [em2 on|off | min ticks | clear]");
+        return;
+    }
+
+    for (uint8_t i = 0; i < SLEEP_MODES; i++)
+    {
+        sleep_stats_t s;
+
+        sleep_get((sleep_mode_t)i, &s);
+        sleep_print(names[i], &s);
+    }
+    console_printf("aborted %" PRIu32 ", em2 %s from %" PRIu32 " ticks%s", m.aborted, m.em2 ? "on" : "off",
+                   m.em2_min, (2 == configUSE_TICKLESS_IDLE) ? "" : ", tickless idle not built");
+}
@@ -0,0 +1,79 @@
+/**
+ * @brief Tickless idle in EM1 and EM2 with wakeup latency histograms.
+ *
+ * With configUSE_TICKLESS_IDLE 2 the idle task calls
+ * vPortSuppressTicksAndSleep when no thread is due for a while. It stops
+ * the SysTick, sets an RTCC compare for the next deadline and sleeps in
+ * EM2, or in EM1 when something needs the high frequency clocks: an LDMA
+ * channel, a running TIMER, the USART still sending, EM2 switched off or
+ * held off, or a deadline closer than the EM2 minimum. Any interrupt wakes
+ * it early, the PF4 button included, GPIO edge interrupts work in EM2.
+ * After the wakeup the kernel tick is moved on by the time slept, the
+ * part of a tick left over is carried to the next sleep so kernel time
+ * does not drift.
+ *
+ * The DWT cycle counter is stamped when the core is back with its clocks,
+ * and the first thread that calls sleep_thread_wake afterwards adds the
+ * time since to the log2 histogram of the mode slept in (bucket n counts
+ * 2^(n-1) .. 2^n - 1 cycles). The sleep console command prints them with
+ * the time spent in each mode and sets the EM2 policy:
+ *
+ *   sleep                  counts, time and wakeup histograms
+ *   sleep em2 off          EM1 only, the fastest wakeup
+ *   sleep min 20           EM2 only for at least 20 idle ticks
+ *   sleep clear            start the counts over
+ *
+ * The USART can not receive in EM2, serial input that arrives while asleep
+ * there is lost. sleep_em2_hold keeps the device in EM1 for a while after
+ * console input, so only the start of the first line can be lost.
+ *
+ * CYCCNT stops with the core clock in EM1 and EM2. The RTCC time of each
+ * sleep that it did not count is added to sleep_run_time, which the run
+ * time stats of prof.h are kept on, so slept time shows as idle time.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef SLEEP_H_
+#define SLEEP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SLEEP_BUCKETS       24    // Wakeup histogram buckets, 2^23 cycles is 218 ms
+#define SLEEP_EM2_MIN_TICKS 5     // Default shortest idle time that goes to EM2
+#define SLEEP_MAX_TICKS     60000 // Longest sleep, the next one follows right away
+
+typedef enum sleep_mode
+{
+    SLEEP_EM1,
+    SLEEP_EM2,
+    SLEEP_MODES
+} sleep_mode_t;
+
+typedef struct sleep_stats
+{
+    uint32_t sleeps;  // Times entered
+    uint32_t early;   // Woken by another interrupt before the deadline
+    uint64_t rtcc;    // Time asleep, RTCC counts at 32768 Hz
+    uint32_t wakes;   // Wakeups measured to a thread
+    uint32_t max;     // Longest of them, cycles
+    uint32_t buckets[SLEEP_BUCKETS];
+} sleep_stats_t;
+
+// Set up the RTCC and the console command, before osKernelStart.
+void sleep_init(void);
+
+// In a thread after it has been woken, records the latency of a pending wakeup.
+void sleep_thread_wake(void);
+
+// DWT cycles with the time slept added, the clock of the run time stats.
+uint32_t sleep_run_time(void);
+
+// Sleep no deeper than EM1 for ms from now.
+void sleep_em2_hold(uint32_t ms);
+
+// Copy the counters of one mode out.
+void sleep_get(sleep_mode_t mode, sleep_stats_t *out);
+
+#endif//SLEEP_H_
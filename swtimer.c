@@ -0,0 +1,396 @@
+/**
+ * @brief Timer service on a hierarchical timing wheel, see swtimer.h.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "swtimer.h"
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include "em_device.h"
+#include "em_core.h"
+#include "cmsis_os2.h"
+
+#include "console.h"
+
+#define SWTIMER_FLAG_KICK 0x00000001U // An earlier expiry than the dispatch thread waits for
+
+typedef struct swtimer_wheel
+{
+    swtimer_t *slots[SWTIMER_LEVELS][SWTIMER_SLOTS];
+    uint32_t occupied[SWTIMER_LEVELS]; // One bit per non-empty slot
+    swtimer_t *due;                    // Expired on the last tick visited, callbacks not run yet
+    uint32_t now;                      // Next tick to visit
+    uint32_t wake_at;                  // Tick the dispatch thread sleeps until
+    bool sleeping;                     // A start before wake_at has to kick it
+    bool forever;                      // Any start has to kick it
+    osThreadId_t thread;
+    swtimer_stats_t stats;
+} swtimer_wheel_t;
+
+static swtimer_wheel_t m;
+
+static void swtimer_command(int argc, char **argv);
+
+void swtimer_init(void)
+{
+    console_register("timers", swtimer_command, "timer service counters");
+}
+
+void swtimer_setup(swtimer_t *t, swtimer_f func, void *user)
+{
+    t->next = NULL;
+    t->pprev = NULL;
+    t->func = func;
+    t->user = user;
+}
+
+// Into the slot of its expiry on the lowest level that reaches it, an expiry already
+// passed goes to the next tick.
+static void swtimer_link(swtimer_t *t)
+{
+    uint32_t at = ((int32_t)(t->expires - m.now) > 0) ? t->expires : m.now;
+    uint32_t bits = 32 - __CLZ(at - m.now);
+    uint32_t level = (0 == bits) ? 0 : (bits - 1) / SWTIMER_SLOT_BITS;
+    uint32_t slot = (at >> (SWTIMER_SLOT_BITS * level)) & (SWTIMER_SLOTS - 1);
+    swtimer_t **head = &m.slots[level][slot];
+
+    t->next = *head;
+    if (NULL != t->next)
+    {
+        t->next->pprev = &t->next;
+    }
+    *head = t;
+    t->pprev = head;
+    m.occupied[level] |= 1UL << slot;
+}
+
+static void swtimer_unlink(swtimer_t *t)
+{
+    *t->pprev = t->next;
+    if (NULL != t->next)
+    {
+        t->next->pprev = t->pprev;
+    }
+    else if ((t->pprev >= &m.slots[0][0]) && (t->pprev <= &m.slots[SWTIMER_LEVELS - 1][SWTIMER_SLOTS - 1])
+             && (NULL == *t->pprev))
+    {
+        // Was the last one of a slot
+        uint32_t index = t->pprev - &m.slots[0][0];
+
+        m.occupied[index / SWTIMER_SLOTS] &= ~(1UL << (index % SWTIMER_SLOTS));
+    }
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+// Distance in slots from the hand of level to its first occupied slot, SWTIMER_SLOTS
+// for the slot under the hand when that has turned already, UINT32_MAX if empty.
+static uint32_t swtimer_first(uint32_t level)
+{
+    uint32_t shift = SWTIMER_SLOT_BITS * level;
+    uint32_t hand = (m.now >> shift) & (SWTIMER_SLOTS - 1);
+    uint32_t bits = m.occupied[level];
+
+    if (0 == bits)
+    {
+        return UINT32_MAX;
+    }
+
+    // One bit per slot, rotated so that bit 0 is the slot under the hand
+    bits = (0 == hand) ? bits : (bits >> hand) | (bits << (SWTIMER_SLOTS - hand));
+
+    // Above level 0 the slot under the hand was moved down when the hand got there,
+    // unless that is the tick about to be visited, what is in it now is a turn ahead
+    if ((0 != level) && (0 != (m.now & ((1UL << shift) - 1))))
+    {
+        return (bits > 1) ? (uint32_t)__builtin_ctz(bits & ~1U) : SWTIMER_SLOTS;
+    }
+    return (uint32_t)__builtin_ctz(bits);
+}
+
+// Next tick with anything to do, an expiry on level 0 or a slot moved down from above.
+static uint32_t swtimer_next_visit(void)
+{
+    uint32_t next = m.now + SWTIMER_MAX_TICKS;
+
+    for (uint32_t level = 0; level < SWTIMER_LEVELS; level++)
+    {
+        uint32_t k = swtimer_first(level);
+        uint32_t shift = SWTIMER_SLOT_BITS * level;
+
+        if (UINT32_MAX != k)
+        {
+            uint32_t at = ((m.now >> shift) + k) << shift;
+
+            if ((int32_t)(at - next) < 0)
+            {
+                next = at;
+            }
+        }
+    }
+    return next;
+}
+
+// Earliest expiry of all pending timers, false if there is none. Each level's first
+// occupied slot holds its earliest timers, above level 0 the slot is searched.
+static bool swtimer_next_expiry(uint32_t *at)
+{
+    bool found = false;
+    uint32_t best = 0;
+
+    for (uint32_t level = 0; level < SWTIMER_LEVELS; level++)
+    {
+        uint32_t k = swtimer_first(level);
+        uint32_t shift = SWTIMER_SLOT_BITS * level;
+
+        if (UINT32_MAX == k)
+        {
+            continue;
+        }
+        if (0 == level)
+        {
+            if (!found || ((int32_t)(m.now + k - best) < 0))
+            {
+                best = m.now + k;
+            }
+            found = true;
+            continue;
+        }
+
+        uint32_t slot = ((m.now >> shift) + k) & (SWTIMER_SLOTS - 1);
+
+        for (swtimer_t *t = m.slots[level][slot]; NULL != t; t = t->next)
+        {
+            if (!found || ((int32_t)(t->expires - best) < 0))
+            {
+                best = t->expires;
+            }
+            found = true;
+        }
+    }
+    *at = best;
+    return found;
+}
+
+// Move a slot down, every timer in it is within one slot of the level above now.
+static void swtimer_cascade(uint32_t level, uint32_t slot)
+{
+    swtimer_t *t = m.slots[level][slot];
+
+    m.slots[level][slot] = NULL;
+    m.occupied[level] &= ~(1UL << slot);
+    while (NULL != t)
+    {
+        swtimer_t *next = t->next;
+
+        swtimer_link(t);
+        m.stats.cascaded++;
+        t = next;
+    }
+}
+
+// Visit the ticks up to now until one has expired timers, they go to the due list.
+static void swtimer_advance(uint32_t now)
+{
+    while ((NULL == m.due) && ((int32_t)(now - m.now) >= 0))
+    {
+        uint32_t slot = m.now & (SWTIMER_SLOTS - 1);
+
+        // A turn of a level moves the next slot of the level above down
+        for (uint32_t level = 1; level < SWTIMER_LEVELS; level++)
+        {
+            if (0 != ((m.now >> (SWTIMER_SLOT_BITS * (level - 1))) & (SWTIMER_SLOTS - 1)))
+            {
+                break;
+            }
+            swtimer_cascade(level, (m.now >> (SWTIMER_SLOT_BITS * level)) & (SWTIMER_SLOTS - 1));
+        }
+
+        if (NULL != m.slots[0][slot])
+        {
+            m.due = m.slots[0][slot];
+            m.due->pprev = &m.due;
+            m.slots[0][slot] = NULL;
+            m.occupied[0] &= ~(1UL << slot);
+        }
+
+        // Straight on to the next tick with work, or past now
+        m.now++;
+        uint32_t next = swtimer_next_visit();
+
+        m.now = ((int32_t)(next - (now + 1)) < 0) ? next : now + 1;
+    }
+}
+
+void swtimer_loop(void *argument)
+{
+    m.thread = osThreadGetId();
+
+    for (;;)
+    {
+        uint32_t now = osKernelGetTickCount();
+        uint32_t timeout = osWaitForever;
+        uint32_t at;
+
+        // Callbacks run one at a time outside the critical section, they may start
+        // and cancel timers, the due ones included
+        for (;;)
+        {
+            swtimer_f func = NULL;
+            void *user = NULL;
+
+            CORE_DECLARE_IRQ_STATE;
+            CORE_ENTER_ATOMIC();
+            swtimer_advance(now);
+            swtimer_t *t = m.due;
+            if (NULL != t)
+            {
+                uint32_t late = now - t->expires;
+
+                swtimer_unlink(t);
+                func = t->func;
+                user = t->user;
+                m.stats.fired++;
+                m.stats.max_late = (late > m.stats.max_late) ? late : m.stats.max_late;
+                if (0 != t->period)
+                {
+                    t->expires += t->period;
+                    swtimer_link(t);
+                }
+                else
+                {
+                    m.stats.pending--;
+                }
+            }
+            CORE_EXIT_ATOMIC();
+
+            if (NULL == t)
+            {
+                break;
+            }
+            if (NULL != func)
+            {
+                func(user);
+            }
+        }
+
+        CORE_DECLARE_IRQ_STATE;
+        CORE_ENTER_ATOMIC();
+        now = osKernelGetTickCount();
+        if (swtimer_next_expiry(&at))
+        {
+            if ((int32_t)(at - now) <= 0)
+            {
+                // The callbacks took long enough for the next one to be due
+                CORE_EXIT_ATOMIC();
+                continue;
+            }
+            timeout = ((at - now) < SWTIMER_MAX_TICKS) ? (at - now) : SWTIMER_MAX_TICKS;
+        }
+        m.wake_at = now + timeout;
+        m.forever = (osWaitForever == timeout);
+        m.sleeping = true;
+        CORE_EXIT_ATOMIC();
+
+        osThreadFlagsWait(SWTIMER_FLAG_KICK, osFlagsWaitAny, timeout);
+
+        CORE_ENTER_ATOMIC();
+        m.sleeping = false;
+        m.stats.wakeups++;
+        CORE_EXIT_ATOMIC();
+    }
+}
+
+bool swtimer_start(swtimer_t *t, uint32_t delay, uint32_t period)
+{
+    bool kick;
+
+    if ((delay > SWTIMER_MAX_TICKS) || (period > SWTIMER_MAX_TICKS))
+    {
+        return false;
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    uint32_t now = osKernelGetTickCount();
+
+    if (NULL != t->pprev)
+    {
+        swtimer_unlink(t);
+        m.stats.pending--;
+    }
+
+    // An empty wheel is not visited, its hand catches up here
+    if ((0 == m.stats.pending) && ((int32_t)(now - m.now) > 0))
+    {
+        m.now = now;
+    }
+
+    t->expires = now + delay;
+    t->period = period;
+    swtimer_link(t);
+    m.stats.started++;
+    m.stats.pending++;
+    m.stats.max_pending = (m.stats.pending > m.stats.max_pending) ? m.stats.pending : m.stats.max_pending;
+
+    // One kick is enough, the thread looks at all timers when it wakes
+    kick = m.sleeping && (m.forever || ((int32_t)(t->expires - m.wake_at) < 0));
+    m.sleeping = m.sleeping && !kick;
+    CORE_EXIT_ATOMIC();
+
+    if (kick)
+    {
+        osThreadFlagsSet(m.thread, SWTIMER_FLAG_KICK);
+    }
+    return true;
+}
+
+bool swtimer_cancel(swtimer_t *t)
+{
+    bool pending;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    pending = (NULL != t->pprev);
+    if (pending)
+    {
+        swtimer_unlink(t);
+        m.stats.pending--;
+        m.stats.cancelled++;
+    }
+    CORE_EXIT_ATOMIC();
+    return pending;
+}
+
+bool swtimer_pending(const swtimer_t *t)
+{
+    bool pending;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    pending = (NULL != t->pprev);
+    CORE_EXIT_ATOMIC();
+    return pending;
+}
+
+void swtimer_get_stats(swtimer_stats_t *out)
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    *out = m.stats;
+    CORE_EXIT_ATOMIC();
+}
+
+static void swtimer_command(int argc, char **argv)
+{
+    swtimer_stats_t s;
+
+    swtimer_get_stats(&s);
+    console_printf("timers pending %u max %u started %" PRIu32 " cancelled %" PRIu32 " fired %" PRIu32,
+                   s.pending, s.max_pending, s.started, s.cancelled, s.fired);
+    console_printf("timers cascaded %" PRIu32 " wakeups %" PRIu32 " late max %" PRIu32 " ticks",
+                   s.cascaded, s.wakeups, s.max_late);
+}
@@ -0,0 +1,90 @@
+/**
+ * @brief Timer service on a hierarchical timing wheel, one dispatch thread
+ * for any number of one-shot and periodic timers.
+ *
+ * The wheel has SWTIMER_LEVELS levels of SWTIMER_SLOTS slots. Level 0 has
+ * a slot per kernel tick, every level above a slot per whole turn of the
+ * one below. A timer goes into the slot of its expiry tick on the lowest
+ * level that reaches that far, each slot is a list linked through the
+ * timers themselves. Starting a timer is a slot index and a list insert,
+ * cancelling it an unlink, both O(1) and without any search. When the
+ * level 0 hand crosses a turn, the next slot of the level above is moved
+ * down, so a timer is touched at most once per level on its way to
+ * expiry.
+ *
+ * swtimer_loop is the dispatch thread. It sleeps until the earliest
+ * expiry, found from a bitmap of the occupied slots per level, runs every
+ * callback that is due and sleeps again. A start that is due before the
+ * thread would wake kicks it with a thread flag. Nothing ticks while no
+ * timer is due, the tickless idle can sleep through.
+ *
+ * Callbacks run in the dispatch thread one after the other, they must not
+ * block. Periodic timers are re-armed at their previous expiry plus the
+ * period before their callback runs, late dispatch does not shift them.
+ * Timers can be started and cancelled from threads, interrupts and
+ * callbacks, a timer cancelled after its expiry but before its callback
+ * ran does not run. The timer structures belong to the caller and nothing
+ * comes from the heap.
+ *
+ * The timers console command prints the counters below.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef SWTIMER_H_
+#define SWTIMER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SWTIMER_SLOT_BITS 5
+#define SWTIMER_SLOTS     (1UL << SWTIMER_SLOT_BITS)
+#define SWTIMER_LEVELS    4
+#define SWTIMER_MAX_TICKS (1UL << (SWTIMER_SLOT_BITS * SWTIMER_LEVELS - 2)) // Longest delay and period, a quarter of the wheel
+
+// Called from the dispatch thread when the timer expires.
+typedef void (*swtimer_f)(void *user);
+
+typedef struct swtimer
+{
+    struct swtimer *next;
+    struct swtimer **pprev; // Link pointing here, NULL when not pending
+    uint32_t expires;       // Kernel tick
+    uint32_t period;        // Ticks, 0 for one-shot
+    swtimer_f func;
+    void *user;
+} swtimer_t;
+
+typedef struct swtimer_stats
+{
+    uint32_t started;
+    uint32_t cancelled; // Pending timers stopped
+    uint32_t fired;     // Callbacks run
+    uint32_t cascaded;  // Timers moved down a level
+    uint32_t wakeups;   // Dispatch thread runs
+    uint32_t max_late;  // Longest time from expiry to callback, ticks
+    uint16_t pending;
+    uint16_t max_pending;
+} swtimer_stats_t;
+
+// Register the console command.
+void swtimer_init(void);
+
+// The dispatch thread, give it the highest priority of the periodic work.
+void swtimer_loop(void *argument);
+
+// Set up t with its callback, before the first start.
+void swtimer_setup(swtimer_t *t, swtimer_f func, void *user);
+
+// Expire delay ticks from now, 0 is the next tick, and then every period ticks, 0 for once.
+// A pending timer is restarted. False if delay or period is too long.
+bool swtimer_start(swtimer_t *t, uint32_t delay, uint32_t period);
+
+// Stop t, false if it was not pending.
+bool swtimer_cancel(swtimer_t *t);
+
+bool swtimer_pending(const swtimer_t *t);
+
+void swtimer_get_stats(swtimer_stats_t *out);
+
+#endif//SWTIMER_H_
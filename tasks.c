@@ -0,0 +1,51 @@
+/**
+ * @brief Compile-time task table, see tasks.h.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "tasks.h"
+
+#include <inttypes.h>
+
+#include "loglevels.h"
+#define __MODUUL__ "task"
+#define __LOG_LEVEL__ LOG_MODULE_LEVEL(tasks)
+#include "log.h"
+
+bool tasks_start(const task_def_t *table, uint32_t count)
+{
+    bool ok = true;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        osThreadId_t id = osThreadNew(table[i].entry, NULL, &table[i].attr);
+
+        if (NULL == id)
+        {
+            err1("%s not created", table[i].attr.name);
+            ok = false;
+        }
+        if (NULL != table[i].id)
+        {
+            *table[i].id = id;
+        }
+    }
+    return ok;
+}
+
+void tasks_report(const task_def_t *table, uint32_t count)
+{
+    uint32_t stack = 0;
+    uint32_t cb = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const osThreadAttr_t *a = &table[i].attr;
+
+        info1("%-22s prio %2d stack %5" PRIu32 " cb %4" PRIu32, a->name, (int)a->priority, a->stack_size, a->cb_size);
+        stack += a->stack_size;
+        cb += a->cb_size;
+    }
+    info1("%" PRIu32 " tasks stack %" PRIu32 " cb %" PRIu32 " total %" PRIu32 " bytes", count, stack, cb, stack + cb);
+}
@@ -0,0 +1,64 @@
+/**
+ * @brief Compile-time task table, every thread with statically allocated
+ * control block and stack.
+ *
+ * Each task gets its storage from TASK_STORAGE and an entry in a const
+ * table from TASK_DEF, both at file scope:
+ *
+ *   TASK_STORAGE(button, 1536);
+ *
+ *   static const task_def_t m_tasks[] = {
+ *       TASK_DEF(button, "button", button_loop, osPriorityNormal, &button_task_id),
+ *   };
+ *
+ * The buffers are named objects in .bss, so the map file shows every byte
+ * the tasks reserve and creating them takes nothing from the heap. The
+ * wrapper only uses the static memory when cb_size covers StaticTask_t and
+ * configSUPPORT_STATIC_ALLOCATION is set, otherwise osThreadNew fails
+ * instead of falling back to the heap.
+ *
+ * osTimers take their control block from TASK_TIMER_CB in the same way.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef TASKS_H_
+#define TASKS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cmsis_os2.h"
+#include "FreeRTOS.h" // StaticTask_t and StaticTimer_t
+
+typedef struct task_def
+{
+    osThreadAttr_t attr; // Name, priority and the static memory
+    osThreadFunc_t entry;
+    osThreadId_t *id;    // Where the thread id goes, NULL if nobody needs it
+} task_def_t;
+
+// Stack of bytes and control block of task var, bytes a multiple of 8.
+#define TASK_STORAGE(var, bytes)                                \
+    static uint64_t var##_stack[(bytes) / sizeof(uint64_t)];    \
+    static StaticTask_t var##_cb
+
+// Table entry of task var, its TASK_STORAGE must come first.
+#define TASK_DEF(var, task_name, func, prio, id_ptr)                                        \
+    {                                                                                       \
+        .attr = {.name = (task_name), .priority = (prio),                                   \
+                 .cb_mem = &var##_cb, .cb_size = sizeof(var##_cb),                          \
+                 .stack_mem = var##_stack, .stack_size = sizeof(var##_stack)},              \
+        .entry = (func), .id = (id_ptr)                                                     \
+    }
+
+// Control block of an osTimer, for .cb_mem = &var, .cb_size = sizeof(var) of its attributes.
+#define TASK_TIMER_CB(var) static StaticTimer_t var
+
+// Create the count tasks of table in order, false if any of them failed.
+bool tasks_start(const task_def_t *table, uint32_t count);
+
+// Log the memory each task reserves and the total.
+void tasks_report(const task_def_t *table, uint32_t count);
+
+#endif//TASKS_H_
@@ -0,0 +1,147 @@
+/**
+ * @brief Hardware tone generator for the buzzer pin, see tone.h.
+ *
+ * EFR32MG12 TIMER0 is a 16-bit timer, so the prescaler is chosen as the
+ * smallest power of two that makes the period fit into TOP. A frequency
+ * change that keeps the prescaler is written to TOPB/CCVB and applied by
+ * hardware on overflow, otherwise the timer is briefly stopped.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#include "tone.h"
+
+#include "em_cmu.h"
+#include "em_gpio.h"
+#include "em_timer.h"
+
+#define TONE_TIMER        TIMER0
+#define TONE_TIMER_CLOCK  cmuClock_TIMER0
+#define TONE_CC           0
+#define TONE_PORT         gpioPortA
+#define TONE_PIN          0
+#define TONE_TOP_MAX      0xFFFFUL
+#define TONE_PRESCALE_MAX 10 // timerPrescale1024
+
+static bool m_active;
+static uint32_t m_prescale;
+static uint32_t m_frequency;
+
+// Find prescaler exponent and TOP value for freq_hz, false if it does not fit.
+static bool tone_period(uint32_t freq_hz, uint32_t *prescale, uint32_t *top)
+{
+    uint32_t clock = CMU_ClockFreqGet(TONE_TIMER_CLOCK);
+
+    if ((freq_hz < TONE_FREQ_MIN) || (freq_hz > TONE_FREQ_MAX))
+    {
+        return false;
+    }
+
+    for (uint32_t p = 0; p <= TONE_PRESCALE_MAX; p++)
+    {
+        uint32_t counts = (clock >> p) / freq_hz;
+
+        if ((counts >= 2) && (counts - 1 <= TONE_TOP_MAX))
+        {
+            *prescale = p;
+            *top = counts - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void tone_configure(uint32_t prescale, uint32_t top)
+{
+    TIMER_Init_TypeDef init = TIMER_INIT_DEFAULT;
+
+    init.enable = false;
+    init.prescale = (TIMER_Prescale_TypeDef)prescale;
+    TIMER_Init(TONE_TIMER, &init);
+
+    TIMER_TopSet(TONE_TIMER, top);
+    TIMER_CompareSet(TONE_TIMER, TONE_CC, (top + 1) / 2);
+    // A change buffered before a stop would otherwise latch over this tone at its first overflow
+    TIMER_TopBufSet(TONE_TIMER, top);
+    TIMER_CompareBufSet(TONE_TIMER, TONE_CC, (top + 1) / 2);
+    TIMER_CounterSet(TONE_TIMER, 0);
+    m_prescale = prescale;
+}
+
+void tone_init(void)
+{
+    TIMER_InitCC_TypeDef cc = TIMER_INITCC_DEFAULT;
+
+    CMU_ClockEnable(TONE_TIMER_CLOCK, true);
+
+    cc.mode = timerCCModePWM;
+    TIMER_InitCC(TONE_TIMER, TONE_CC, &cc);
+
+    TONE_TIMER->ROUTELOC0 = (TONE_TIMER->ROUTELOC0 & ~_TIMER_ROUTELOC0_CC0LOC_MASK)
+                            | TIMER_ROUTELOC0_CC0LOC_LOC0;
+
+    GPIO_PinModeSet(TONE_PORT, TONE_PIN, gpioModePushPull, 0);
+    m_active = false;
+    m_frequency = 0;
+}
+
+bool tone_start(uint32_t freq_hz)
+{
+    uint32_t prescale;
+    uint32_t top;
+
+    if (!tone_period(freq_hz, &prescale, &top))
+    {
+        return false;
+    }
+
+    TIMER_Enable(TONE_TIMER, false);
+    tone_configure(prescale, top);
+    TONE_TIMER->ROUTEPEN |= TIMER_ROUTEPEN_CC0PEN;
+    TIMER_Enable(TONE_TIMER, true);
+
+    m_frequency = CMU_ClockFreqGet(TONE_TIMER_CLOCK) / ((top + 1) << prescale);
+    m_active = true;
+    return true;
+}
+
+bool tone_set_frequency(uint32_t freq_hz)
+{
+    uint32_t prescale;
+    uint32_t top;
+
+    if (!m_active || !tone_period(freq_hz, &prescale, &top))
+    {
+        return false;
+    }
+
+    if (prescale != m_prescale)
+    {
+        return tone_start(freq_hz);
+    }
+
+    // Buffered values are latched on the next overflow, no partial periods
+    TIMER_TopBufSet(TONE_TIMER, top);
+    TIMER_CompareBufSet(TONE_TIMER, TONE_CC, (top + 1) / 2);
+
+    m_frequency = CMU_ClockFreqGet(TONE_TIMER_CLOCK) / ((top + 1) << prescale);
+    return true;
+}
+
+void tone_stop(void)
+{
+    TIMER_Enable(TONE_TIMER, false);
+    TONE_TIMER->ROUTEPEN &= ~TIMER_ROUTEPEN_CC0PEN;
+    GPIO_PinOutClear(TONE_PORT, TONE_PIN);
+    m_active = false;
+}
+
+bool tone_active(void)
+{
+    return m_active;
+}
+
+uint32_t tone_frequency(void)
+{
+    return m_frequency;
+}
@@ -0,0 +1,39 @@
+/**
+ * @brief Hardware tone generator for the buzzer pin.
+ *
+ * TIMER0 runs in PWM mode with compare channel 0 routed to PA0, so the
+ * square wave is produced entirely by the timer once started. Frequency
+ * changes go through the buffered TOP/CCV registers and take effect on the
+ * next timer overflow, which keeps the output free of runt pulses.
+ *
+ * Copyright ProLab TTÜ 2022
+ * @license MIT
+ */
+#ifndef TONE_H_
+#define TONE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TONE_FREQ_MIN 20UL    // Lowest supported frequency, Hz
+#define TONE_FREQ_MAX 20000UL // Highest supported frequency, Hz
+
+// Enable the timer clock and configure the compare channel, output stays idle.
+void tone_init(void);
+
+// Start a square wave of freq_hz on the buzzer pin, false if out of range.
+bool tone_start(uint32_t freq_hz);
+
+// Change the frequency of a running tone, false if stopped or out of range.
+bool tone_set_frequency(uint32_t freq_hz);
+
+// Stop the timer and drive the buzzer pin low.
+void tone_stop(void);
+
+// Check if a tone is currently being generated.
+bool tone_active(void);
+
+// Frequency actually produced for the last accepted request, Hz.
+uint32_t tone_frequency(void);
+
+#endif//TONE_H_
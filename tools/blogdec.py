@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+"""
+Decode a binary log capture of a LOG_BINARY=1 build back into lll lines.
+
+The dictionary is the blog_fmt section of the ELF of the same build, every
+entry is 'level|module|line|format'. A record is 0xFE, its length, the
+offset of the entry in the section as 16 bits little endian, the ticks
+since the previous record and the arguments as LEB128 varints, see blog.c.
+Bytes outside of records are passed through as text, a record that does
+not match its entry is taken as text too. Time starts from 0 at the start
+of the capture, from boot when the capture starts with the firmware.
+"""
+import argparse
+import re
+import struct
+import sys
+
+MARK = 0xFE
+ID_DROPPED = 0xFFFF
+SECTION = "blog_fmt"
+CONV_RE = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(?:hh|h|ll|l|j|z|t)?([diouxXc%])")
+
+
+class BlogError(Exception):
+    pass
+
+
+def read_section(path, name):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF":
+        raise BlogError("not an ELF file")
+    e = "<" if data[5] == 1 else ">"
+    if data[4] == 1:
+        shoff, = struct.unpack_from(e + "I", data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(e + "HHH", data, 0x2E)
+        header = e + "IIIIII"
+    else:
+        shoff, = struct.unpack_from(e + "Q", data, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(e + "HHH", data, 0x3A)
+        header = e + "IIQQQQ"
+
+    sections = [struct.unpack_from(header, data, shoff + i * shentsize) for i in range(shnum)]
+    names = sections[shstrndx][4]
+    for sh_name, _, _, _, offset, size in sections:
+        end = data.index(b"\0", names + sh_name)
+        if data[names + sh_name:end].decode() == name:
+            return data[offset:offset + size]
+    raise BlogError("no %s section, not a LOG_BINARY=1 build" % name)
+
+
+def parse_entries(section):
+    """Offset to (level, module, line, format, argument count)."""
+    entries = {}
+    start = 0
+    for raw in section.split(b"\0"):
+        if raw:
+            parts = raw.decode(errors="replace").split("|", 3)
+            if len(parts) == 4:
+                level, module, line, fmt = parts
+                count = sum(1 for m in CONV_RE.finditer(fmt) if m.group(4) != "%")
+                entries[start] = (level, module, int(line), fmt, count)
+        start += len(raw) + 1
+    return entries
+
+
+def render(fmt, args):
+    values = iter(args)
+
+    def conversion(m):
+        flags, width, precision, conv = m.groups()
+        if conv == "%":
+            return "%"
+        value = next(values)
+        if conv in "di":
+            value = value - (1 << 32) if value & 0x80000000 else value
+        if conv in "diu":
+            conv = "d"
+        spec = "%" + flags + width + ("." + precision if precision else "") + conv
+        return spec % value
+
+    return CONV_RE.sub(conversion, fmt)
+
+
+def varints(data):
+    values = []
+    value = 0
+    shift = 0
+    for b in data:
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            values.append(value & 0xFFFFFFFF)
+            value = 0
+            shift = 0
+    if shift:
+        return None
+    return values
+
+
+class Decoder:
+    def __init__(self, entries, tick_hz, out):
+        self.entries = entries
+        self.tick_hz = tick_hz
+        self.out = out
+        self.ticks = 0
+        self.text = bytearray()  # Text not queued yet, at most a partial line once a record is decoded
+        self.queue = []  # Output in stream order
+        self.records = 0
+        self.dropped = 0
+
+    def record(self, body):
+        """Decode one record body, False if it is not one."""
+        if len(body) < 3:
+            return False
+        values = varints(body[2:])
+        if not values:
+            return False
+        ident = body[0] | body[1] << 8
+        delta, args = values[0], values[1:]
+        if ident == ID_DROPPED:
+            if len(args) != 1:
+                return False
+            self.dropped += args[0]
+            self.emit("-- %d records dropped --\n" % args[0])
+            return True
+        entry = self.entries.get(ident)
+        if entry is None or entry[4] != len(args):
+            return False
+        level, module, line, fmt, _ = entry
+        self.ticks += delta
+        ms = self.ticks * 1000 // self.tick_hz
+        self.emit("%02u:%02u:%02u.%03u %s|%4s:%4d|%s\n" % (
+            ms // 3600000 % 100, ms // 60000 % 60, ms // 1000 % 60, ms % 1000,
+            level, module, line, render(fmt, args)))
+        self.records += 1
+        return True
+
+    def queue_text(self, final=False):
+        end = len(self.text) if final else self.text.rfind(b"\n") + 1
+        if end:
+            self.queue.append(self.text[:end].decode(errors="replace"))
+            del self.text[:end]
+
+    def emit(self, line):
+        # After the text before it, a partial text line it interrupted is held back and goes after it
+        self.queue_text()
+        self.queue.append(line)
+
+    def flush(self, final=False):
+        self.queue_text(final)
+        self.out.write("".join(self.queue))
+        self.queue = []
+
+    def feed(self, data, final=False):
+        """Decode data, returns the bytes of an incomplete record at the end."""
+        i = 0
+        while i < len(data):
+            j = data.find(MARK, i)
+            if j < 0:
+                self.text += data[i:]
+                i = len(data)
+                break
+            self.text += data[i:j]
+            if j + 2 > len(data) or j + 2 + data[j + 1] > len(data):
+                if not final:
+                    i = j
+                    break
+                self.text += data[j:j + 1]
+                i = j + 1
+                continue
+            end = j + 2 + data[j + 1]
+            if self.record(data[j + 2:end]):
+                i = end
+            else:
+                self.text += data[j:j + 1]
+                i = j + 1
+        self.flush(final)
+        return data[i:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("elf", help="ELF of the build that produced the capture")
+    parser.add_argument("capture", nargs="?", default="-", help="serial capture, - for stdin")
+    parser.add_argument("--tick-hz", type=int, default=1000, help="RTOS tick frequency, default 1000")
+    args = parser.parse_args()
+
+    try:
+        entries = parse_entries(read_section(args.elf, SECTION))
+    except (OSError, BlogError) as e:
+        sys.exit("%s: %s" % (args.elf, e))
+
+    f = sys.stdin.buffer if args.capture == "-" else open(args.capture, "rb")
+    decoder = Decoder(entries, args.tick_hz, sys.stdout)
+    rest = b""
+    try:
+        while True:
+            chunk = f.read(65536)
+            if not chunk:
+                break
+            rest = decoder.feed(rest + chunk)
+        decoder.feed(rest, final=True)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if f is not sys.stdin.buffer:
+            f.close()
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
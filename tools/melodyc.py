@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Compile a text score into the binary melody format read by melody.c.
+
+Score syntax, one or more tokens per line, '#' starts a comment:
+    tempo 120       quarter notes per minute, 1..255
+    C4/4  F#5/8.    note name, octave and length, '.' makes it dotted
+    Eb3/16          flats are written with 'b'
+    r/2             rest
+    repeat 2        start a block played 2 times, 0 repeats forever
+    end             end of the innermost repeat block
+
+Lengths are 1, 2, 4, 8 or 16 (whole to sixteenth), C4 is MIDI note 60.
+Notes must be within the range of the tone generator, E0 (20.6 Hz) and up.
+"""
+import argparse
+import re
+import sys
+
+VERSION = 1
+MAX_DEPTH = 4
+
+OP_END = 0x00
+OP_TEMPO = 0x01
+OP_REST = 0x02
+OP_REPEAT = 0x03
+OP_LOOP = 0x04
+OP_NOTE = 0x80
+
+# TONE_FREQ_MIN and TONE_FREQ_MAX of tone.h, Hz
+FREQ_MIN = 20
+FREQ_MAX = 20000
+
+# Octave of MIDI notes 120..131 in Hz, as melody_note_frequency in melody.c
+TOP_OCTAVE = (8372, 8870, 9397, 9956, 10548, 11175, 11840, 12544, 13290, 14080, 14917, 15804)
+
+SEMITONES = {"C": 0, "D": 2, "E": 4, "F": 5, "G": 7, "A": 9, "B": 11}
+NOTE_RE = re.compile(r"^([A-Ga-g])([#b]?)(-?\d+)/(\d+)(\.?)$")
+REST_RE = re.compile(r"^[rR]/(\d+)(\.?)$")
+
+
+class ScoreError(Exception):
+    pass
+
+
+def note_frequency(note):
+    shift = 10 - note // 12
+    freq = TOP_OCTAVE[note % 12]
+    if shift == 0:
+        return freq
+    return (freq + (1 << (shift - 1))) >> shift
+
+
+def sixteenths(denominator, dotted):
+    if denominator not in ("1", "2", "4", "8", "16"):
+        raise ScoreError("bad length /%s" % denominator)
+    length = 16 // int(denominator)
+    if dotted:
+        if length < 2:
+            raise ScoreError("a dotted sixteenth can not be represented")
+        length += length // 2
+    return length
+
+
+def compile_score(text):
+    out = bytearray(b"MEL" + bytes([VERSION]))
+    depth = 0
+    timed = [False]  # Per open block, whether it plays a note or rest, like melody_validate
+    for lineno, line in enumerate(text.splitlines(), 1):
+        tokens = line.split("#", 1)[0].split()
+        i = 0
+        try:
+            while i < len(tokens):
+                tok = tokens[i]
+                if tok in ("tempo", "repeat"):
+                    if i + 1 >= len(tokens):
+                        raise ScoreError("%s needs a value" % tok)
+                    value = int(tokens[i + 1])
+                    i += 1
+                    if tok == "tempo":
+                        if not 1 <= value <= 255:
+                            raise ScoreError("tempo out of range")
+                        out += bytes([OP_TEMPO, value])
+                    else:
+                        if not 0 <= value <= 255:
+                            raise ScoreError("repeat count out of range")
+                        if depth >= MAX_DEPTH:
+                            raise ScoreError("repeat blocks nested too deep")
+                        depth += 1
+                        timed.append(False)
+                        out += bytes([OP_REPEAT, value])
+                elif tok == "end":
+                    if depth == 0:
+                        raise ScoreError("end without repeat")
+                    if not timed.pop():
+                        raise ScoreError("repeat block without a note or rest")
+                    depth -= 1
+                    timed[-1] = True
+                    out.append(OP_LOOP)
+                elif REST_RE.match(tok):
+                    m = REST_RE.match(tok)
+                    out += bytes([OP_REST, sixteenths(m.group(1), m.group(2))])
+                    timed[-1] = True
+                elif NOTE_RE.match(tok):
+                    m = NOTE_RE.match(tok)
+                    note = SEMITONES[m.group(1).upper()] + (int(m.group(3)) + 1) * 12
+                    note += {"#": 1, "b": -1, "": 0}[m.group(2)]
+                    if not 0 <= note <= 127:
+                        raise ScoreError("note %s out of MIDI range" % tok)
+                    freq = note_frequency(note)
+                    if not FREQ_MIN <= freq <= FREQ_MAX:
+                        raise ScoreError("note %s is %d Hz, out of the tone range %d..%d Hz"
+                                         % (tok, freq, FREQ_MIN, FREQ_MAX))
+                    out += bytes([OP_NOTE | note, sixteenths(m.group(4), m.group(5))])
+                    timed[-1] = True
+                else:
+                    raise ScoreError("unknown token '%s'" % tok)
+                i += 1
+        except (ScoreError, ValueError) as e:
+            raise ScoreError("line %d: %s" % (lineno, e))
+    if depth != 0:
+        raise ScoreError("unterminated repeat block")
+    out.append(OP_END)
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("score", help="text score")
+    parser.add_argument("output", help="binary melody file")
+    args = parser.parse_args()
+
+    with open(args.score) as f:
+        text = f.read()
+    try:
+        data = compile_score(text)
+    except ScoreError as e:
+        sys.exit("%s: %s" % (args.score, e))
+    with open(args.output, "wb") as f:
+        f.write(data)
+
+
+if __name__ == "__main__":
+    main()
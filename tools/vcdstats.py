@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+"""
+Report period, duty cycle and jitter of every pin in a VCD file.
+
+Reads the VCD written by the host build (esw-gpio-host -v) or a serial
+capture of a PIN_RECORD=1 firmware, log lines mixed into the capture are
+skipped. Periods are measured between rising edges, the high time between
+a rising and the next falling edge. Jitter is the standard deviation and
+the peak-to-peak spread of the period. A '$comment dropped N $end' from the
+recorder breaks the measurement, no period spans the gap.
+
+Statistics are kept as running sums, a recording of any length is read in
+constant memory.
+"""
+import argparse
+import json
+import math
+import re
+import sys
+
+LOG_RE = re.compile(r"^\d\d:\d\d:\d\d\.\d{3} [DIWE]\|")
+DROPPED_RE = re.compile(r"\$comment\s+dropped\s+(\d+)\s+\$end")
+UNITS = {"s": 1.0, "ms": 1e-3, "us": 1e-6, "ns": 1e-9, "ps": 1e-12, "fs": 1e-15}
+
+
+class VcdError(Exception):
+    pass
+
+
+class Stat:
+    """Count, mean, deviation and range, updated one sample at a time."""
+
+    def __init__(self):
+        self.count = 0
+        self.mean = 0.0
+        self.m2 = 0.0
+        self.min = None
+        self.max = None
+
+    def add(self, value):
+        self.count += 1
+        delta = value - self.mean
+        self.mean += delta / self.count
+        self.m2 += delta * (value - self.mean)
+        self.min = value if self.min is None else min(self.min, value)
+        self.max = value if self.max is None else max(self.max, value)
+
+    def stddev(self):
+        return math.sqrt(self.m2 / self.count) if self.count else 0.0
+
+    def as_dict(self, scale):
+        if not self.count:
+            return None
+        return {
+            "count": self.count,
+            "mean": self.mean * scale,
+            "min": self.min * scale,
+            "max": self.max * scale,
+            "stddev": self.stddev() * scale,
+        }
+
+
+class Pin:
+    def __init__(self, name):
+        self.name = name
+        self.transitions = 0
+        self.level = None
+        self.last_rise = None
+        self.period = Stat()
+        self.high = Stat()
+        self.duty = Stat()
+        self.pending_high = None
+
+    def change(self, time, level):
+        if level == self.level:
+            return
+        if level in ("0", "1") and self.level in ("0", "1"):
+            self.transitions += 1
+        if level == "1":
+            if self.last_rise is not None and self.pending_high is not None:
+                period = time - self.last_rise
+                if period > 0:
+                    self.period.add(period)
+                    self.high.add(self.pending_high)
+                    self.duty.add(self.pending_high / period)
+            self.last_rise = time
+            self.pending_high = None
+        elif level == "0" and self.level == "1" and self.last_rise is not None:
+            self.pending_high = time - self.last_rise
+        else:
+            self.gap()
+        self.level = level
+
+    def gap(self):
+        self.last_rise = None
+        self.pending_high = None
+
+
+def parse(lines):
+    scale = 1e-9
+    pins = {}
+    time = 0
+    dropped = 0
+    header = []
+    in_header = True
+
+    for line in lines:
+        line = line.strip()
+        if not line or LOG_RE.match(line):
+            continue
+        m = DROPPED_RE.search(line)
+        if m:
+            dropped += int(m.group(1))
+            for pin in pins.values():
+                pin.gap()
+            continue
+        if in_header:
+            header.append(line)
+            if "$enddefinitions" in line:
+                text = " ".join(header)
+                m = re.search(r"\$timescale\s+(\d+)\s*(s|ms|us|ns|ps|fs)\s+\$end", text)
+                if m:
+                    scale = int(m.group(1)) * UNITS[m.group(2)]
+                for var in re.finditer(r"\$var\s+\S+\s+1\s+(\S+)\s+(\S+)(?:\s+\[[^\]]*\])?\s+\$end", text):
+                    pins[var.group(1)] = Pin(var.group(2))
+                in_header = False
+            continue
+        if line.startswith("#"):
+            try:
+                t = int(line[1:])
+            except ValueError:
+                raise VcdError("bad time %r" % line)
+            if t < time:
+                raise VcdError("time goes back at %r" % line)
+            time = t
+        elif line[0] in "01xXzZ":
+            pin = pins.get(line[1:])
+            if pin is not None:
+                pin.change(time, line[0].lower())
+        # Vectors, reals and the remaining keywords do not carry pin levels
+
+    if in_header:
+        raise VcdError("no $enddefinitions, not a VCD")
+    return pins, scale, dropped
+
+
+def report(pins, scale, dropped):
+    us = scale * 1e6
+    out = {"dropped": dropped, "pins": {}}
+    for pin in sorted(pins.values(), key=lambda p: p.name):
+        if not pin.transitions:
+            continue
+        period = pin.period.as_dict(us)
+        out["pins"][pin.name] = {
+            "transitions": pin.transitions,
+            "period_us": period,
+            "high_us": pin.high.as_dict(us),
+            "duty": pin.duty.as_dict(1.0),
+            "jitter_us": None if period is None else {
+                "stddev": period["stddev"], "peak_to_peak": period["max"] - period["min"]},
+        }
+    return out
+
+
+def print_table(result):
+    print("%-6s %10s %12s %12s %12s %8s %12s %12s" % (
+        "pin", "changes", "period us", "min us", "max us", "duty %", "jitter sd", "jitter p-p"))
+    for name, p in result["pins"].items():
+        if p["period_us"] is None:
+            print("%-6s %10d %12s" % (name, p["transitions"], "-"))
+            continue
+        print("%-6s %10d %12.3f %12.3f %12.3f %8.2f %12.3f %12.3f" % (
+            name, p["transitions"], p["period_us"]["mean"], p["period_us"]["min"], p["period_us"]["max"],
+            p["duty"]["mean"] * 100, p["jitter_us"]["stddev"], p["jitter_us"]["peak_to_peak"]))
+    if result["dropped"]:
+        print("%d records dropped by the recorder, no period spans a gap" % result["dropped"])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("vcd", nargs="?", default="-", help="VCD file or serial capture, - for stdin")
+    parser.add_argument("--json", action="store_true", help="machine-readable output")
+    args = parser.parse_args()
+
+    f = sys.stdin if args.vcd == "-" else open(args.vcd, errors="replace")
+    try:
+        pins, scale, dropped = parse(f)
+    except VcdError as e:
+        sys.exit("%s: %s" % (args.vcd, e))
+    finally:
+        if f is not sys.stdin:
+            f.close()
+
+    result = report(pins, scale, dropped)
+    if args.json:
+        json.dump(result, sys.stdout, indent=2)
+        print()
+    else:
+        print_table(result)
+
+
+if __name__ == "__main__":
+    main()